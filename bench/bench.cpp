@@ -0,0 +1,101 @@
+// bench.cpp : runs the hdf5pp benchmarks
+// usage: bench <name> [--option=value ...]; without a name, all benchmarks are run with their defaults
+//
+
+#include "pch.h"
+#include "bench.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+
+namespace bench {
+
+	Summary Summarize(std::vector<double> samples)
+	{
+		Summary s;
+		if (samples.empty()) {
+			return s;
+		}
+		std::sort(samples.begin(), samples.end());
+		auto at = [&samples](double q) { return samples[(size_t)(q * (samples.size() - 1) + 0.5)]; };
+		s.count = samples.size();
+		s.min = samples.front();
+		s.median = at(0.5);
+		s.p90 = at(0.9);
+		s.p99 = at(0.99);
+		double sum{ 0 };
+		for (auto v : samples) {
+			sum += v;
+		}
+		s.mean = sum / samples.size();
+		return s;
+	}
+
+	void PrintSummary(const char* label, const Summary& s)
+	{
+		printf("%-40s n=%-6zu min=%10.1f  median=%10.1f  p90=%10.1f  p99=%10.1f  mean=%10.1f us\n",
+			label, s.count, s.min, s.median, s.p90, s.p99, s.mean);
+	}
+
+	long GetOption(int argc, char** argv, const char* name, long def)
+	{
+		auto val = GetOptionString(argc, argv, name, nullptr);
+		return val != nullptr ? strtol(val, nullptr, 10) : def;
+	}
+
+	const char* GetOptionString(int argc, char** argv, const char* name, const char* def)
+	{
+		auto len = strlen(name);
+		for (int i = 1; i < argc; ++i) {
+			if (strncmp(argv[i], "--", 2) == 0 && strncmp(argv[i] + 2, name, len) == 0 && argv[i][2 + len] == '=') {
+				return argv[i] + 3 + len;
+			}
+		}
+		return def;
+	}
+}
+
+namespace {
+
+	struct Benchmark {
+		const char* name;
+		int (*run)(int argc, char** argv);
+		const char* description;
+	};
+
+	const Benchmark Benchmarks[] = {
+		{ "delta", bench::Delta, "delta and delta-of-delta coding of timestamps and counters, and datasets filtered with it" },
+		{ "mdc-image", bench::MDCImage, "open and first read of a metadata heavy file, with and without a metadata cache image" },
+		{ "overhead", bench::Overhead, "time added by the wrapper to common operations, against the raw C API calls" },
+		{ "shuffle", bench::Shuffle, "byte and bit shuffle kernels, and datasets filtered with them or the library's shuffle" },
+		{ "throughput", bench::Throughput, "write/read MB/s and latency over layouts, filters, chunk cache sizes, drivers and access patterns" },
+		{ "vds", bench::VDS, "building, opening and reading a virtual dataset stitched from many source datasets" },
+		{ "vfd", bench::VFD, "conformance and throughput of the C++ file drivers, next to the library's sec2 driver" },
+	};
+}
+
+int main(int argc, char** argv)
+{
+	const char* name = (argc > 1 && strncmp(argv[1], "--", 2) != 0) ? argv[1] : nullptr;
+
+	int rv{ 0 };
+	bool found{ false };
+	for (auto& b : Benchmarks) {
+		if (name == nullptr || strcmp(name, b.name) == 0) {
+			found = true;
+			printf("== %s: %s\n", b.name, b.description);
+			rv |= b.run(argc, argv);
+		}
+	}
+
+	if (!found) {
+		printf("usage: bench [name] [--option=value ...]\n");
+		for (auto& b : Benchmarks) {
+			printf("  %-16s %s\n", b.name, b.description);
+		}
+		return 1;
+	}
+	return rv;
+}
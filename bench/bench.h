@@ -0,0 +1,49 @@
+// bench.h
+// helpers shared by the hdf5pp benchmarks
+//
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+	using Clock = std::chrono::steady_clock;
+
+	// microseconds elapsed since start
+	inline double ElapsedUs(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+	}
+
+	struct Summary {
+		size_t count{ 0 };
+		double min{ 0 };
+		double median{ 0 };
+		double p90{ 0 };
+		double p99{ 0 };
+		double mean{ 0 };
+	};
+
+	// order statistics of a set of samples
+	Summary Summarize(std::vector<double> samples);
+
+	// prints one result line: label, then the summary in microseconds
+	void PrintSummary(const char* label, const Summary& s);
+
+	// returns the integer value of --name=value, or def if absent
+	long GetOption(int argc, char** argv, const char* name, long def);
+
+	// returns the text of --name=value, or def if absent
+	const char* GetOptionString(int argc, char** argv, const char* name, const char* def);
+
+	// benchmarks; each returns the process exit code
+	int Delta(int argc, char** argv);
+	int MDCImage(int argc, char** argv);
+	int Overhead(int argc, char** argv);
+	int Shuffle(int argc, char** argv);
+	int Throughput(int argc, char** argv);
+	int VDS(int argc, char** argv);
+	int VFD(int argc, char** argv);
+}
@@ -0,0 +1,251 @@
+// bench_delta.cpp
+// throughput and size of HDF5::DeltaFilter on integer series: packing and unpacking alone for each order and
+// packing, then chunked datasets written and read in memory (core driver, no backing store) with deflate or LZ4
+// alone and after the delta filters
+// the series are 64-bit timestamps of a 1 kHz clock with a little jitter, and 32-bit counters that mostly step by
+// small amounts; Pack and Unpack are timed on their own, best of --repeat runs; datasets include the whole pipeline
+// options: --mb=N (megabytes of each series), --repeat=N
+//
+
+#include "pch.h"
+#include "bench.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <hdf5pp.h>
+
+namespace {
+
+	const char* const FileName = "bench_delta.h5";
+
+	typedef HDF5::DeltaFilter::Order Order;
+	typedef HDF5::DeltaFilter::Packing Packing;
+
+	const struct {
+		const char* name;
+		Order order;
+		Packing packing;
+	} Codings[] = {
+		{ "delta varint", Order::Delta, Packing::Varint },
+		{ "delta packed", Order::Delta, Packing::FrameOfReference },
+		{ "dod varint", Order::DeltaOfDelta, Packing::Varint },
+		{ "dod packed", Order::DeltaOfDelta, Packing::FrameOfReference },
+	};
+
+	enum class Delta { None, Delta, DeltaOfDelta };
+	enum class Codec { None, Deflate, LZ4 };
+
+	struct Pipeline {
+		const char* name;
+		Delta delta;
+		Codec codec;
+	};
+
+	const Pipeline Pipelines[] = {
+		{ "deflate", Delta::None, Codec::Deflate },
+		{ "lz4", Delta::None, Codec::LZ4 },
+		{ "delta", Delta::Delta, Codec::None },
+		{ "delta+deflate", Delta::Delta, Codec::Deflate },
+		{ "delta+lz4", Delta::Delta, Codec::LZ4 },
+		{ "dod", Delta::DeltaOfDelta, Codec::None },
+		{ "dod+deflate", Delta::DeltaOfDelta, Codec::Deflate },
+		{ "dod+lz4", Delta::DeltaOfDelta, Codec::LZ4 },
+	};
+
+	const hsize_t ChunkElements = 64 * 1024;
+
+	struct Series {
+		const char* name;
+		std::vector<uint8_t> data;
+		size_t elem_size;
+		const HDF5::IntegerPDT* dtype;
+
+		size_t Count() const { return data.size() / elem_size; }
+	};
+
+	// microseconds of a 1 kHz clock, off by up to 3 us
+	void Timestamps(size_t count, Series& s)
+	{
+		s.data.resize(count * sizeof(int64_t));
+		uint32_t seed{ 11 };
+		for (size_t i = 0; i < count; ++i) {
+			seed = seed * 1664525 + 1013904223;
+			int64_t t = 1700000000000000 + 1000 * (int64_t)i + (seed >> 30);
+			memcpy(s.data.data() + i * sizeof(t), &t, sizeof(t));
+		}
+	}
+
+	// counters that mostly step by small amounts, with an occasional jump
+	void Counters(size_t count, Series& s)
+	{
+		s.data.resize(count * sizeof(uint32_t));
+		uint32_t seed{ 7 };
+		uint32_t value{ 100000 };
+		for (size_t i = 0; i < count; ++i) {
+			seed = seed * 1664525 + 1013904223;
+			value += (seed >> 28) == 0 ? (seed >> 16) : (seed >> 29);
+			memcpy(s.data.data() + i * sizeof(value), &value, sizeof(value));
+		}
+	}
+
+	double MBps(size_t bytes, double us)
+	{
+		return us > 0 ? bytes / us : 0;
+	}
+
+	int TimeCodings(const Series& s, long repeat)
+	{
+		std::vector<uint8_t> packed;
+		std::vector<uint8_t> back(s.data.size());
+		for (auto& c : Codings) {
+			double pack_us{ 0 };
+			double unpack_us{ 0 };
+			for (long r = 0; r < repeat; ++r) {
+				auto start = bench::Clock::now();
+				if (!HDF5::DeltaFilter::Pack(s.data.data(), s.Count(), s.elem_size, c.order, c.packing, packed)) {
+					printf("%s: %s failed to pack\n", s.name, c.name);
+					return 1;
+				}
+				auto us = bench::ElapsedUs(start);
+				pack_us = r == 0 ? us : std::min(pack_us, us);
+				start = bench::Clock::now();
+				if (!HDF5::DeltaFilter::Unpack(packed.data(), packed.size(), s.elem_size, c.order, c.packing, back.data(), s.Count())) {
+					printf("%s: %s failed to unpack\n", s.name, c.name);
+					return 1;
+				}
+				us = bench::ElapsedUs(start);
+				unpack_us = r == 0 ? us : std::min(unpack_us, us);
+			}
+			if (back != s.data) {
+				printf("%s: %s does not give the data back\n", s.name, c.name);
+				return 1;
+			}
+			printf("%-12s %-14s %12.1f %12.1f %10.2f\n", s.name, c.name, MBps(s.data.size(), pack_us), MBps(s.data.size(), unpack_us),
+				packed.empty() ? 0.0 : (double)s.data.size() / packed.size());
+		}
+		return 0;
+	}
+
+	bool MakeDcpl(const Pipeline& p, HDF5::DatasetCreationPropertyList& dcpl)
+	{
+		if (!dcpl.SetChunk({ ChunkElements })) {
+			return false;
+		}
+		switch (p.delta) {
+		case Delta::None:
+			break;
+		case Delta::Delta:
+			if (!dcpl.SetDelta()) {
+				return false;
+			}
+			break;
+		case Delta::DeltaOfDelta:
+			if (!dcpl.SetDeltaOfDelta()) {
+				return false;
+			}
+			break;
+		}
+		switch (p.codec) {
+		case Codec::None:
+			break;
+		case Codec::Deflate:
+			return dcpl.SetDeflate(1);
+		case Codec::LZ4:
+			return dcpl.SetLZ4();
+		}
+		return true;
+	}
+
+	int TimePipelines(const Series& s)
+	{
+		HDF5::FileAccessPropertyList fapl;
+		if (!fapl.SetCoreDriver(64 << 20, false)) {
+			printf("failed to set the core driver\n");
+			return 1;
+		}
+		std::vector<uint8_t> back(s.data.size());
+		for (auto& p : Pipelines) {
+			if (p.codec == Codec::LZ4 && !HDF5::LZ4Filter::IsAvailable()) {
+				continue;
+			}
+			HDF5::File f;
+			HDF5::DatasetCreationPropertyList dcpl;
+			if (!f.Create(FileName, H5F_ACC_TRUNC, HDF5::PropertyList(), fapl) || !MakeDcpl(p, dcpl)) {
+				printf("%s: failed to set up\n", p.name);
+				return 1;
+			}
+			HDF5::Dataspace dspace(std::vector<hsize_t>{ s.Count() });
+			auto start = bench::Clock::now();
+			auto dset = f.CreateDataset("data", *s.dtype, dspace, HDF5::PropertyList(), dcpl);
+			if (!dset.IsValid() || !dset.Write(*s.dtype, dspace, dspace, s.data.data()) || !dset.Flush()) {
+				printf("%s: failed to write\n", p.name);
+				return 1;
+			}
+			auto written = bench::ElapsedUs(start);
+			auto stored = dset.GetStorageSize();
+
+			// reopened so that the chunk cache is empty
+			start = bench::Clock::now();
+			dset = f.OpenDataset("data");
+			if (!dset.Read(*s.dtype, dspace, dspace, back.data())) {
+				printf("%s: failed to read\n", p.name);
+				return 1;
+			}
+			auto read = bench::ElapsedUs(start);
+			if (back != s.data) {
+				printf("%s: data read back differs\n", p.name);
+				return 1;
+			}
+			printf("%-12s %-14s %12.1f %12.1f %10.2f\n", s.name, p.name, MBps(s.data.size(), written), MBps(s.data.size(), read),
+				stored > 0 ? (double)s.data.size() / stored : 0.0);
+		}
+		return 0;
+	}
+}
+
+namespace bench {
+
+	int Delta(int argc, char** argv)
+	{
+		auto mb = GetOption(argc, argv, "mb", 32);
+		auto repeat = GetOption(argc, argv, "repeat", 5);
+		if (mb < 1 || repeat < 1) {
+			printf("mb and repeat must be >= 1\n");
+			return 1;
+		}
+		if (!HDF5::Library::RegisterFilter(std::make_shared<HDF5::DeltaFilter>()) ||
+			(HDF5::LZ4Filter::IsAvailable() && !HDF5::Library::RegisterFilter(std::make_shared<HDF5::LZ4Filter>()))) {
+			printf("failed to register the filters\n");
+			return 1;
+		}
+
+		auto bytes = (size_t)mb * 1024 * 1024;
+		Series series[] = {
+			{ "timestamps", {}, sizeof(int64_t), &HDF5::IntegerPDT::Native_INT64 },
+			{ "counters", {}, sizeof(uint32_t), &HDF5::IntegerPDT::Native_UINT32 },
+		};
+		Timestamps(bytes / sizeof(int64_t), series[0]);
+		Counters(bytes / sizeof(uint32_t), series[1]);
+
+		printf("%-12s %-14s %12s %12s %10s\n", "series", "coding", "pack MB/s", "unpack MB/s", "ratio");
+		for (auto& s : series) {
+			auto rv = TimeCodings(s, repeat);
+			if (rv != 0) {
+				return rv;
+			}
+		}
+		printf("%-12s %-14s %12s %12s %10s\n", "series", "filters", "write MB/s", "read MB/s", "ratio");
+		for (auto& s : series) {
+			auto rv = TimePipelines(s);
+			if (rv != 0) {
+				return rv;
+			}
+		}
+		return 0;
+	}
+}
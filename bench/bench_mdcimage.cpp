@@ -0,0 +1,140 @@
+// bench_mdcimage.cpp
+// measures opening a metadata heavy file and reading from it, with and without a metadata cache image
+// options: --groups=N (objects in the file), --repeats=N (opens per file)
+//
+
+#include "pch.h"
+#include "bench.h"
+
+#include <cstdio>
+
+#include <hdf5pp.h>
+
+namespace {
+
+	const char* const PlainFileName = "bench_mdc_plain.h5";
+	const char* const ImageFileName = "bench_mdc_image.h5";
+
+	// number of groups touched by the first read after open
+	const long TouchedGroups = 16;
+
+	bool BuildFile(const char* filename, const HDF5::FileAccessPropertyList& fapl, long groups)
+	{
+		HDF5::File f;
+		if (!f.Create(filename, H5F_ACC_TRUNC, HDF5::PropertyList(), fapl)) {
+			return false;
+		}
+		std::vector<double> data(64, 1.0);
+		char name[32];
+		for (long i = 0; i < groups; ++i) {
+			snprintf(name, sizeof(name), "g%06ld", i);
+			auto grp = f.CreateGroup(name);
+			if (!grp.IsValid() || !grp.AddDataset("data", data.data(), data.size())) {
+				return false;
+			}
+			if (!grp.AddAttribute("index", (double)i) || !grp.AddAttribute("scale", 1.0) || !grp.AddAttribute("offset", 0.0)) {
+				return false;
+			}
+		}
+		// the cache image, if enabled, is written here
+		return f.Close();
+	}
+
+	// opens the file, reads an attribute from groups spread over the file and one dataset, closes the file
+	bool OpenAndRead(const char* filename, long groups, double& elapsed)
+	{
+		auto start = bench::Clock::now();
+		HDF5::File f;
+		if (!f.Open(filename, H5F_ACC_RDONLY)) {
+			return false;
+		}
+		char name[48];
+		double val{ 0 };
+		for (long i = 0; i < TouchedGroups; ++i) {
+			snprintf(name, sizeof(name), "g%06ld", i * (groups / TouchedGroups));
+			auto grp = f.OpenGroup(name);
+			if (!grp.ReadAttribute("index", val)) {
+				return false;
+			}
+		}
+		{
+			snprintf(name, sizeof(name), "g%06ld/data", groups - 1);
+			auto dset = f.OpenDataset(name);
+			auto dspace = dset.GetDataspace();
+			std::vector<double> data(64);
+			if (!dset.Read(HDF5::FloatPDT::Native_DOUBLE, dspace, dspace, data.data())) {
+				return false;
+			}
+		}
+		if (!f.Close()) {
+			return false;
+		}
+		elapsed = bench::ElapsedUs(start);
+		return true;
+	}
+}
+
+namespace bench {
+
+	int MDCImage(int argc, char** argv)
+	{
+		auto groups = GetOption(argc, argv, "groups", 20000);
+		auto repeats = GetOption(argc, argv, "repeats", 50);
+		if (groups < TouchedGroups || repeats < 1) {
+			printf("groups must be >= %ld and repeats >= 1\n", TouchedGroups);
+			return 1;
+		}
+
+		HDF5::FileAccessPropertyList plain_fapl;
+		plain_fapl.SetLibraryVersionBounds(H5F_LIBVER_V110, H5F_LIBVER_LATEST);	// same file format for both files
+		HDF5::FileAccessPropertyList image_fapl;
+		image_fapl.EnableMDCImage();
+
+		printf("building %ld groups per file\n", groups);
+		if (!BuildFile(PlainFileName, plain_fapl, groups) || !BuildFile(ImageFileName, image_fapl, groups)) {
+			printf("failed to build the test files\n");
+			return 1;
+		}
+
+		{
+			haddr_t image_addr{ HADDR_UNDEF };
+			hsize_t image_len{ 0 };
+			HDF5::File f;
+			if (!f.Open(ImageFileName, H5F_ACC_RDONLY) || !f.GetMDCImageInfo(image_addr, image_len) || image_len == 0) {
+				printf("no metadata cache image found in %s\n", ImageFileName);
+				return 1;
+			}
+			printf("metadata cache image: %llu bytes\n", (unsigned long long)image_len);
+		}
+
+		// alternate between the files so both see the same system state; the first open of each is
+		// the coldest one this process can observe (the OS page cache is not dropped)
+		std::vector<double> plain, image;
+		double first_plain{ 0 }, first_image{ 0 };
+		for (long r = 0; r < repeats; ++r) {
+			double t;
+			if (!OpenAndRead(PlainFileName, groups, t)) {
+				printf("failed to read %s\n", PlainFileName);
+				return 1;
+			}
+			if (r == 0) {
+				first_plain = t;
+			}
+			plain.push_back(t);
+			if (!OpenAndRead(ImageFileName, groups, t)) {
+				printf("failed to read %s\n", ImageFileName);
+				return 1;
+			}
+			if (r == 0) {
+				first_image = t;
+			}
+			image.push_back(t);
+		}
+
+		printf("first open, no image:   %10.1f us\n", first_plain);
+		printf("first open, with image: %10.1f us\n", first_image);
+		PrintSummary("open + first read, no image", Summarize(plain));
+		PrintSummary("open + first read, with image", Summarize(image));
+		return 0;
+	}
+}
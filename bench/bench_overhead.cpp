@@ -0,0 +1,365 @@
+// bench_overhead.cpp
+// measures the time the wrapper adds to common operations, against the equivalent raw HDF5 C API calls
+// every case runs in batches of --ops operations, alternating raw and wrapped batches; the first batch of
+// each is a warm-up and is not counted
+// options: --ops=N (operations per batch), --batches=N
+//
+
+#include "pch.h"
+#include "bench.h"
+
+#include <cstdio>
+#include <string>
+
+#include <hdf5pp.h>
+
+namespace {
+
+	const char* const FileName = "bench_overhead.h5";
+
+	// elements read by one hyperslab read, and in the dataset read from
+	const hsize_t SliceSize = 16;
+	const hsize_t SlabSize = 1 << 20;
+
+	// elements of the datasets added by AddDataset, strings in the string datasets
+	const size_t SmallDatasetSize = 16;
+
+	struct Fixture {
+		Fixture(HDF5::File& f, long ops);
+
+		HDF5::File file;
+		HDF5::Group group;		// copied by the handle case; holds the attribute read back
+		HDF5::Group target;		// a new, empty group for every batch
+		HDF5::Dataset slab;
+		std::vector<hsize_t> dims;
+		std::vector<hsize_t> slice;
+		std::vector<hsize_t> offsets;
+		std::vector<std::string> names;
+		std::vector<double> values;
+		std::vector<std::string> strings;
+		std::vector<const char*> cstrings;
+		long batch{ 0 };
+	};
+
+	typedef bool (*Run)(Fixture& fx, long ops);
+
+	struct Case {
+		const char* name;
+		Run raw;
+		Run wrapped;
+	};
+
+	bool RawHandleCopy(Fixture& fx, long ops)
+	{
+		auto id = (hid_t)fx.group;
+		for (long i = 0; i < ops; ++i) {
+			if (H5Iinc_ref(id) < 0 || H5Idec_ref(id) < 0) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool WrappedHandleCopy(Fixture& fx, long ops)
+	{
+		for (long i = 0; i < ops; ++i) {
+			HDF5::Group copy(fx.group);
+		}
+		return true;
+	}
+
+	bool RawDataspace(Fixture& fx, long ops)
+	{
+		for (long i = 0; i < ops; ++i) {
+			auto sid = H5Screate_simple((int)fx.dims.size(), fx.dims.data(), nullptr);
+			if (sid < 0 || H5Sclose(sid) < 0) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool WrappedDataspace(Fixture& fx, long ops)
+	{
+		for (long i = 0; i < ops; ++i) {
+			HDF5::Dataspace dspace(fx.dims);
+			if (!dspace.IsValid()) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool RawAddAttribute(Fixture& fx, long ops)
+	{
+		auto gid = (hid_t)fx.target;
+		double val{ 1.0 };
+		for (long i = 0; i < ops; ++i) {
+			auto sid = H5Screate(H5S_SCALAR);
+			auto aid = H5Acreate2(gid, fx.names[i].c_str(), H5T_NATIVE_DOUBLE, sid, H5P_DEFAULT, H5P_DEFAULT);
+			auto ok = aid >= 0 && H5Awrite(aid, H5T_NATIVE_DOUBLE, &val) >= 0;
+			if (aid >= 0) {
+				H5Aclose(aid);
+			}
+			H5Sclose(sid);
+			if (!ok) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool WrappedAddAttribute(Fixture& fx, long ops)
+	{
+		for (long i = 0; i < ops; ++i) {
+			if (!fx.target.AddAttribute(fx.names[i].c_str(), 1.0)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool RawReadAttribute(Fixture& fx, long ops)
+	{
+		auto gid = (hid_t)fx.group;
+		double val{ 0 };
+		for (long i = 0; i < ops; ++i) {
+			auto aid = H5Aopen(gid, "value", H5P_DEFAULT);
+			auto ok = aid >= 0 && H5Aread(aid, H5T_NATIVE_DOUBLE, &val) >= 0;
+			if (aid >= 0) {
+				H5Aclose(aid);
+			}
+			if (!ok) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool WrappedReadAttribute(Fixture& fx, long ops)
+	{
+		double val{ 0 };
+		for (long i = 0; i < ops; ++i) {
+			if (!fx.group.ReadAttribute("value", val)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool RawAddDataset(Fixture& fx, long ops)
+	{
+		auto gid = (hid_t)fx.target;
+		hsize_t dim = fx.values.size();
+		for (long i = 0; i < ops; ++i) {
+			auto sid = H5Screate_simple(1, &dim, nullptr);
+			auto did = H5Dcreate2(gid, fx.names[i].c_str(), H5T_NATIVE_DOUBLE, sid, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+			auto ok = did >= 0 && H5Dwrite(did, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, fx.values.data()) >= 0;
+			if (did >= 0) {
+				H5Dclose(did);
+			}
+			H5Sclose(sid);
+			if (!ok) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool WrappedAddDataset(Fixture& fx, long ops)
+	{
+		for (long i = 0; i < ops; ++i) {
+			if (!fx.target.AddDataset(fx.names[i].c_str(), fx.values.data(), fx.values.size())) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool RawHyperslabRead(Fixture& fx, long ops)
+	{
+		auto did = (hid_t)fx.slab;
+		double buf[SliceSize];
+		hsize_t count = SliceSize;
+		for (long i = 0; i < ops; ++i) {
+			auto fsid = H5Dget_space(did);
+			auto msid = H5Screate_simple(1, &count, nullptr);
+			auto ok = fsid >= 0 && msid >= 0 &&
+				H5Sselect_hyperslab(fsid, H5S_SELECT_SET, &fx.offsets[i], nullptr, &count, nullptr) >= 0 &&
+				H5Dread(did, H5T_NATIVE_DOUBLE, msid, fsid, H5P_DEFAULT, buf) >= 0;
+			H5Sclose(msid);
+			H5Sclose(fsid);
+			if (!ok) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool WrappedHyperslabRead(Fixture& fx, long ops)
+	{
+		double buf[SliceSize];
+		hsize_t count = SliceSize;
+		for (long i = 0; i < ops; ++i) {
+			auto fspace = fx.slab.GetDataspace();
+			HDF5::Dataspace mspace(fx.slice);
+			if (!fspace.SelectHyperslab(HDF5::Dataspace::SelectionOperation::Set, &fx.offsets[i], nullptr, &count, nullptr) ||
+				!fx.slab.Read(HDF5::FloatPDT::Native_DOUBLE, mspace, fspace, buf)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool RawStringDataset(Fixture& fx, long ops)
+	{
+		auto gid = (hid_t)fx.target;
+		hsize_t dim = fx.cstrings.size();
+		for (long i = 0; i < ops; ++i) {
+			auto tid = H5Tcopy(H5T_C_S1);
+			auto sid = H5Screate_simple(1, &dim, nullptr);
+			auto ok = tid >= 0 && sid >= 0 && H5Tset_size(tid, H5T_VARIABLE) >= 0;
+			auto did = ok ? H5Dcreate2(gid, fx.names[i].c_str(), tid, sid, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT) : H5I_INVALID_HID;
+			ok = did >= 0 && H5Dwrite(did, tid, H5S_ALL, H5S_ALL, H5P_DEFAULT, fx.cstrings.data()) >= 0;
+			if (did >= 0) {
+				H5Dclose(did);
+			}
+			H5Sclose(sid);
+			H5Tclose(tid);
+			if (!ok) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool WrappedStringDataset(Fixture& fx, long ops)
+	{
+		for (long i = 0; i < ops; ++i) {
+			if (!fx.target.AddDataset(fx.names[i].c_str(), fx.strings)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	const Case Cases[] = {
+		{ "handle copy + destroy", RawHandleCopy, WrappedHandleCopy },
+		{ "dataspace create + close", RawDataspace, WrappedDataspace },
+		{ "AddAttribute (double)", RawAddAttribute, WrappedAddAttribute },
+		{ "ReadAttribute (double)", RawReadAttribute, WrappedReadAttribute },
+		{ "AddDataset (16 doubles)", RawAddDataset, WrappedAddDataset },
+		{ "hyperslab read (16 doubles)", RawHyperslabRead, WrappedHyperslabRead },
+		{ "string dataset (16 strings)", RawStringDataset, WrappedStringDataset },
+	};
+
+	// the library's default layout while the benchmark runs, so that AddDataset stores its datasets as the raw
+	// calls do (H5P_DEFAULT, contiguous) rather than as the default LayoutPolicy would (compact)
+	struct LibraryLayout {
+		LibraryLayout() : saved(HDF5::LayoutPolicy::GetDefault()) { HDF5::LayoutPolicy::SetDefault(nullptr); }
+		~LibraryLayout() { HDF5::LayoutPolicy::SetDefault(saved); }
+
+		std::shared_ptr<const HDF5::LayoutPolicy> saved;
+	};
+
+	// creates the file with the group holding the attribute read back and the dataset read from
+	bool CreateFixtureFile(HDF5::File& file)
+	{
+		if (!file.Create(FileName, H5F_ACC_TRUNC)) {
+			return false;
+		}
+		auto grp = file.CreateGroup("fixture");
+		if (!grp.IsValid() || !grp.AddAttribute("value", 1.0)) {
+			return false;
+		}
+		std::vector<double> slab(SlabSize);
+		for (hsize_t i = 0; i < SlabSize; ++i) {
+			slab[i] = (double)i;
+		}
+		return file.AddDataset("slab", slab.data(), slab.size());
+	}
+
+	Fixture::Fixture(HDF5::File& f, long ops)
+		: file(f), group(f.OpenGroup("fixture")), slab(f.OpenDataset("slab")), dims({ 64, 64 }), slice({ SliceSize })
+	{
+		// the same scattered offsets for both variants
+		uint32_t seed{ 12345 };
+		char name[32];
+		for (long i = 0; i < ops; ++i) {
+			seed = seed * 1664525 + 1013904223;
+			offsets.push_back(seed % (SlabSize - SliceSize));
+			snprintf(name, sizeof(name), "n%06ld", i);
+			names.push_back(name);
+		}
+		values.assign(SmallDatasetSize, 1.0);
+		for (size_t i = 0; i < SmallDatasetSize; ++i) {
+			strings.push_back("string value " + std::to_string(i));
+		}
+		for (auto& s : strings) {
+			cstrings.push_back(s.c_str());
+		}
+	}
+
+	// runs one batch into a fresh target group; returns nanoseconds per operation, or a negative value on failure
+	double RunBatch(Fixture& fx, Run run, long ops)
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "batch%06ld", fx.batch++);
+		fx.target = fx.file.CreateGroup(name);
+		if (!fx.target.IsValid()) {
+			return -1;
+		}
+		auto start = bench::Clock::now();
+		if (!run(fx, ops)) {
+			return -1;
+		}
+		return bench::ElapsedUs(start) * 1000.0 / ops;
+	}
+}
+
+namespace bench {
+
+	int Overhead(int argc, char** argv)
+	{
+		auto ops = GetOption(argc, argv, "ops", 1000);
+		auto batches = GetOption(argc, argv, "batches", 20);
+		if (ops < 1 || batches < 1) {
+			printf("ops and batches must be >= 1\n");
+			return 1;
+		}
+
+		LibraryLayout layout;
+		HDF5::File file;
+		if (!CreateFixtureFile(file)) {
+			printf("failed to create %s\n", FileName);
+			return 1;
+		}
+		Fixture fx(file, ops);
+		if (!fx.group.IsValid() || !fx.slab.IsValid()) {
+			printf("failed to open the fixture objects in %s\n", FileName);
+			return 1;
+		}
+
+		printf("%ld batches of %ld operations, median ns per operation\n", batches, ops);
+		printf("%-32s %12s %12s %12s %10s\n", "operation", "raw", "wrapped", "overhead", "");
+		for (auto& c : Cases) {
+			std::vector<double> raw, wrapped;
+			for (long b = 0; b <= batches; ++b) {
+				auto r = RunBatch(fx, c.raw, ops);
+				auto w = RunBatch(fx, c.wrapped, ops);
+				if (r < 0 || w < 0) {
+					printf("%s failed\n", c.name);
+					return 1;
+				}
+				if (b > 0) {
+					raw.push_back(r);
+					wrapped.push_back(w);
+				}
+			}
+			auto r = Summarize(raw).median;
+			auto w = Summarize(wrapped).median;
+			printf("%-32s %12.1f %12.1f %12.1f %+9.1f%%\n", c.name, r, w, w - r, 100.0 * (w - r) / r);
+		}
+		return 0;
+	}
+}
@@ -0,0 +1,245 @@
+// bench_shuffle.cpp
+// throughput of the byte and bit transpositions of HDF5::ShuffleFilter, per kernel, then of chunked datasets
+// written and read in memory (core driver, no backing store) with the library's shuffle filter and with the
+// byte and bit shuffle filters, alone and in front of a compressor; the data are slowly changing 32-bit
+// counters, as from sensors
+// kernels are timed on their own, best of --repeat runs; datasets include the whole filter pipeline
+// options: --mb=N (megabytes of data), --repeat=N
+//
+
+#include "pch.h"
+#include "bench.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include <hdf5pp.h>
+
+namespace {
+
+	const char* const FileName = "bench_shuffle.h5";
+
+	typedef HDF5::ShuffleFilter::Kernel Kernel;
+
+	const struct {
+		const char* name;
+		Kernel kernel;
+	} Kernels[] = {
+		{ "scalar", Kernel::Scalar },
+		{ "sse2", Kernel::SSE2 },
+		{ "avx2", Kernel::AVX2 },
+	};
+
+	const struct {
+		const char* name;
+		bool (*run)(const void* in, void* out, size_t count, size_t elem_size, Kernel kernel);
+		bool bits;
+	} Transforms[] = {
+		{ "byte shuffle", HDF5::ShuffleFilter::ByteShuffle, false },
+		{ "byte unshuffle", HDF5::ShuffleFilter::ByteUnshuffle, false },
+		{ "bit shuffle", HDF5::ShuffleFilter::BitShuffle, true },
+		{ "bit unshuffle", HDF5::ShuffleFilter::BitUnshuffle, true },
+	};
+
+	enum class Transposition { None, Library, Byte, Bit };
+	enum class Codec { None, Deflate, LZ4 };
+
+	struct Pipeline {
+		const char* name;
+		Transposition transposition;
+		Codec codec;
+	};
+
+	const Pipeline Pipelines[] = {
+		{ "none", Transposition::None, Codec::None },
+		{ "shuffle (library)", Transposition::Library, Codec::None },
+		{ "byte shuffle", Transposition::Byte, Codec::None },
+		{ "bit shuffle", Transposition::Bit, Codec::None },
+		{ "deflate", Transposition::None, Codec::Deflate },
+		{ "shuffle (library)+deflate", Transposition::Library, Codec::Deflate },
+		{ "byte shuffle+deflate", Transposition::Byte, Codec::Deflate },
+		{ "bit shuffle+deflate", Transposition::Bit, Codec::Deflate },
+		{ "lz4", Transposition::None, Codec::LZ4 },
+		{ "shuffle (library)+lz4", Transposition::Library, Codec::LZ4 },
+		{ "byte shuffle+lz4", Transposition::Byte, Codec::LZ4 },
+		{ "bit shuffle+lz4", Transposition::Bit, Codec::LZ4 },
+	};
+
+	const hsize_t ChunkElements = 64 * 1024;
+
+	// counters that mostly step by small amounts, with an occasional jump
+	void Generate(size_t count, std::vector<uint32_t>& data)
+	{
+		data.resize(count);
+		uint32_t seed{ 7 };
+		uint32_t value{ 100000 };
+		for (auto& v : data) {
+			seed = seed * 1664525 + 1013904223;
+			value += (seed >> 28) == 0 ? (seed >> 16) : (seed >> 29);
+			v = value;
+		}
+	}
+
+	double MBps(size_t bytes, double us)
+	{
+		return us > 0 ? bytes / us : 0;
+	}
+
+	int TimeKernels(const std::vector<uint32_t>& data, long repeat)
+	{
+		auto bytes = data.size() * sizeof(uint32_t);
+		std::vector<uint8_t> in(bytes), out(bytes), check(bytes);
+		printf("%-16s %-6s %-8s %12s\n", "transform", "elem", "kernel", "MB/s");
+		for (size_t elem_size : { 2, 4, 8 }) {
+			auto count = bytes / elem_size / 8 * 8;
+			for (auto& t : Transforms) {
+				// the unshuffles start from shuffled data, as when reading
+				memcpy(in.data(), data.data(), count * elem_size);
+				if (t.run == HDF5::ShuffleFilter::ByteUnshuffle) {
+					HDF5::ShuffleFilter::ByteShuffle(data.data(), in.data(), count, elem_size);
+				}
+				else if (t.run == HDF5::ShuffleFilter::BitUnshuffle) {
+					HDF5::ShuffleFilter::BitShuffle(data.data(), in.data(), count, elem_size);
+				}
+				bool reference{ false };
+				for (auto& k : Kernels) {
+					if (!HDF5::ShuffleFilter::IsSupported(k.kernel)) {
+						continue;
+					}
+					double best{ 0 };
+					for (long r = 0; r < repeat; ++r) {
+						auto start = bench::Clock::now();
+						if (!t.run(in.data(), out.data(), count, elem_size, k.kernel)) {
+							printf("%s failed with the %s kernel\n", t.name, k.name);
+							return 1;
+						}
+						auto us = bench::ElapsedUs(start);
+						best = r == 0 ? us : std::min(best, us);
+					}
+					// every kernel must give the scalar result
+					if (!reference) {
+						check.assign(out.begin(), out.begin() + count * elem_size);
+						reference = true;
+					}
+					else if (!std::equal(check.begin(), check.end(), out.begin())) {
+						printf("%s: the %s kernel does not match the scalar one\n", t.name, k.name);
+						return 1;
+					}
+					printf("%-16s %-6zu %-8s %12.1f\n", t.name, elem_size, k.name, MBps(count * elem_size, best));
+				}
+			}
+		}
+		return 0;
+	}
+
+	bool MakeDcpl(const Pipeline& p, HDF5::DatasetCreationPropertyList& dcpl)
+	{
+		if (!dcpl.SetChunk({ ChunkElements })) {
+			return false;
+		}
+		switch (p.transposition) {
+		case Transposition::None:
+			break;
+		case Transposition::Library:
+			if (!dcpl.SetShuffle()) {
+				return false;
+			}
+			break;
+		case Transposition::Byte:
+			if (!dcpl.SetByteShuffle()) {
+				return false;
+			}
+			break;
+		case Transposition::Bit:
+			if (!dcpl.SetBitShuffle()) {
+				return false;
+			}
+			break;
+		}
+		switch (p.codec) {
+		case Codec::None:
+			break;
+		case Codec::Deflate:
+			return dcpl.SetDeflate(1);
+		case Codec::LZ4:
+			return dcpl.SetLZ4();
+		}
+		return true;
+	}
+
+	int TimePipelines(const std::vector<uint32_t>& data)
+	{
+		auto bytes = data.size() * sizeof(uint32_t);
+		HDF5::FileAccessPropertyList fapl;
+		if (!fapl.SetCoreDriver(64 << 20, false)) {
+			printf("failed to set the core driver\n");
+			return 1;
+		}
+		printf("%-28s %12s %12s %10s\n", "filters", "write MB/s", "read MB/s", "ratio");
+		std::vector<uint32_t> back(data.size());
+		for (auto& p : Pipelines) {
+			if (p.codec == Codec::LZ4 && !HDF5::LZ4Filter::IsAvailable()) {
+				continue;
+			}
+			HDF5::File f;
+			HDF5::DatasetCreationPropertyList dcpl;
+			if (!f.Create(FileName, H5F_ACC_TRUNC, HDF5::PropertyList(), fapl) || !MakeDcpl(p, dcpl)) {
+				printf("%s: failed to set up\n", p.name);
+				return 1;
+			}
+			HDF5::Dataspace dspace(std::vector<hsize_t>{ data.size() });
+			auto start = bench::Clock::now();
+			auto dset = f.CreateDataset("data", HDF5::IntegerPDT::Native_UINT32, dspace, HDF5::PropertyList(), dcpl);
+			if (!dset.IsValid() || !dset.Write(HDF5::IntegerPDT::Native_UINT32, dspace, dspace, data.data()) || !dset.Flush()) {
+				printf("%s: failed to write\n", p.name);
+				return 1;
+			}
+			auto written = bench::ElapsedUs(start);
+			auto stored = dset.GetStorageSize();
+
+			// reopened so that the chunk cache is empty
+			start = bench::Clock::now();
+			dset = f.OpenDataset("data");
+			if (!dset.Read(HDF5::IntegerPDT::Native_UINT32, dspace, dspace, back.data())) {
+				printf("%s: failed to read\n", p.name);
+				return 1;
+			}
+			auto read = bench::ElapsedUs(start);
+			if (back != data) {
+				printf("%s: data read back differs\n", p.name);
+				return 1;
+			}
+			printf("%-28s %12.1f %12.1f %10.2f\n", p.name, MBps(bytes, written), MBps(bytes, read), stored > 0 ? (double)bytes / stored : 0.0);
+		}
+		return 0;
+	}
+}
+
+namespace bench {
+
+	int Shuffle(int argc, char** argv)
+	{
+		auto mb = GetOption(argc, argv, "mb", 64);
+		auto repeat = GetOption(argc, argv, "repeat", 5);
+		if (mb < 1 || repeat < 1) {
+			printf("mb and repeat must be >= 1\n");
+			return 1;
+		}
+		if (!HDF5::Library::RegisterFilter(std::make_shared<HDF5::ShuffleFilter>(HDF5::ShuffleFilter::Mode::Byte)) ||
+			!HDF5::Library::RegisterFilter(std::make_shared<HDF5::ShuffleFilter>(HDF5::ShuffleFilter::Mode::Bit)) ||
+			(HDF5::LZ4Filter::IsAvailable() && !HDF5::Library::RegisterFilter(std::make_shared<HDF5::LZ4Filter>()))) {
+			printf("failed to register the filters\n");
+			return 1;
+		}
+
+		std::vector<uint32_t> data;
+		Generate((size_t)mb * 1024 * 1024 / sizeof(uint32_t), data);
+		printf("%ld MB, best kernel %s\n", mb, Kernels[(int)HDF5::ShuffleFilter::GetBestKernel() - 1].name);
+		auto rv = TimeKernels(data, repeat);
+		return rv != 0 ? rv : TimePipelines(data);
+	}
+}
@@ -0,0 +1,471 @@
+// bench_throughput.cpp
+// end-to-end I/O matrix: writes a synthetic 2-D dataset of doubles and reads it back with several access
+// patterns, for every combination of dataset size, layout, filters, chunk cache size and file driver
+// (LZ4 and Zstandard filters only when the library is built with HDF5PP_WITH_LZ4 / HDF5PP_WITH_ZSTD; the round14
+// filters round the values to 14 significant bits first, which is lossy)
+// per combination and pattern it reports MB/s (bytes over the wall time of the phase, including file open
+// and close), the latency percentiles of the individual reads/writes, and the file size
+// data and random positions are generated from fixed seeds, so runs are comparable between builds; the
+// OS page cache is not dropped between phases
+// options: --rows=N --cols=N (large dataset), --band=N (rows per sequential write/read),
+//          --stride=N (strided pattern), --lines=N (random rows / columns read), --points=N (random points read),
+//          --only=text (only combinations whose label contains text), --csv=file (also write the results as CSV)
+//
+
+#include "pch.h"
+#include "bench.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include <hdf5pp.h>
+
+namespace {
+
+	const char* const FileName = "bench_throughput.h5";
+	const char* const DatasetName = "data";
+
+	// the small dataset fits in a compact layout
+	const hsize_t SmallRows = 64;
+	const hsize_t SmallCols = 64;
+	const hsize_t CompactLimit = 64000;
+
+	enum class LayoutKind { Compact, Contiguous, Chunked };
+
+	struct LayoutOption {
+		const char* name;
+		LayoutKind kind;
+		hsize_t chunk_rows;		// 0: all rows
+		hsize_t chunk_cols;		// 0: all columns
+	};
+
+	const LayoutOption Layouts[] = {
+		{ "compact", LayoutKind::Compact, 0, 0 },
+		{ "contiguous", LayoutKind::Contiguous, 0, 0 },
+		{ "chunk-64x64", LayoutKind::Chunked, 64, 64 },
+		{ "chunk-rows", LayoutKind::Chunked, 16, 0 },
+		{ "chunk-cols", LayoutKind::Chunked, 0, 16 },
+	};
+
+	enum class Codec { None, Deflate, LZ4, Zstd };
+
+	struct FilterOption {
+		const char* name;
+		bool shuffle;
+		Codec codec;
+		int level;
+		unsigned int nsb;		// significant bits kept by bit rounding (lossy), 0 for none
+	};
+
+	// LZ4 and Zstandard only when the library is built with them
+	const FilterOption Filters[] = {
+		{ "none", false, Codec::None, 0, 0 },
+		{ "deflate", false, Codec::Deflate, 1, 0 },
+		{ "shuffle+deflate", true, Codec::Deflate, 1, 0 },
+		{ "lz4", false, Codec::LZ4, 0, 0 },
+		{ "shuffle+lz4", true, Codec::LZ4, 0, 0 },
+		{ "zstd", false, Codec::Zstd, 3, 0 },
+		{ "shuffle+zstd", true, Codec::Zstd, 3, 0 },
+		{ "round14+shuffle+deflate", true, Codec::Deflate, 1, 14 },
+		{ "round14+shuffle+zstd", true, Codec::Zstd, 3, 14 },
+	};
+
+	struct CacheOption {
+		const char* name;
+		size_t nslots;
+		size_t nbytes;
+	};
+
+	const CacheOption Caches[] = {
+		{ "cache-1M", H5D_CHUNK_CACHE_NSLOTS_DEFAULT, H5D_CHUNK_CACHE_NBYTES_DEFAULT },
+		{ "cache-64M", 12421, 64 << 20 },
+	};
+
+	enum class Driver { Sec2, Stdio, Core };
+
+	struct DriverOption {
+		const char* name;
+		Driver driver;
+	};
+
+	const DriverOption Drivers[] = {
+		{ "sec2", Driver::Sec2 },
+		{ "stdio", Driver::Stdio },
+		{ "core", Driver::Core },
+	};
+
+	enum class Pattern { Sequential, Strided, Rows, Columns, Points };
+
+	const struct {
+		const char* name;
+		Pattern pattern;
+	} Patterns[] = {
+		{ "sequential", Pattern::Sequential },
+		{ "strided", Pattern::Strided },
+		{ "rows", Pattern::Rows },
+		{ "columns", Pattern::Columns },
+		{ "points", Pattern::Points },
+	};
+
+	struct Options {
+		hsize_t band;
+		hsize_t stride;
+		long lines;
+		long points;
+	};
+
+	struct Config {
+		std::string label;
+		bool small;
+		hsize_t rows;
+		hsize_t cols;
+		const LayoutOption* layout;
+		const FilterOption* filter;
+		const CacheOption* cache;
+		const DriverOption* driver;
+	};
+
+	struct Result {
+		double mbps{ 0 };
+		bench::Summary latency;
+	};
+
+	// deterministic, moderately compressible values
+	void Generate(hsize_t rows, hsize_t cols, std::vector<double>& data)
+	{
+		data.resize(rows * cols);
+		uint32_t seed{ 42 };
+		for (hsize_t r = 0; r < rows; ++r) {
+			for (hsize_t c = 0; c < cols; ++c) {
+				seed = seed * 1664525 + 1013904223;
+				data[r * cols + c] = std::floor(1000.0 * std::sin(r * 0.01) * std::cos(c * 0.01)) + (seed >> 24) / 256.0;
+			}
+		}
+	}
+
+	HDF5::FileAccessPropertyList MakeFapl(const Config& cfg)
+	{
+		HDF5::FileAccessPropertyList fapl;
+		switch (cfg.driver->driver) {
+		case Driver::Sec2:
+			fapl.SetSec2Driver();
+			break;
+		case Driver::Stdio:
+			fapl.SetStdioDriver();
+			break;
+		case Driver::Core:
+			fapl.SetCoreDriver(64 << 20, true);
+			break;
+		}
+		return fapl;
+	}
+
+	HDF5::DatasetAccessPropertyList MakeDapl(const Config& cfg)
+	{
+		HDF5::DatasetAccessPropertyList dapl;
+		dapl.SetChunkCache(cfg.cache->nslots, cfg.cache->nbytes, H5D_CHUNK_CACHE_W0_DEFAULT);
+		return dapl;
+	}
+
+	bool MakeDcpl(const Config& cfg, HDF5::DatasetCreationPropertyList& dcpl)
+	{
+		switch (cfg.layout->kind) {
+		case LayoutKind::Compact:
+			return dcpl.SetLayout(HDF5::DatasetCreationPropertyList::Layout::Compact);
+		case LayoutKind::Contiguous:
+			return dcpl.SetLayout(HDF5::DatasetCreationPropertyList::Layout::Contiguous);
+		case LayoutKind::Chunked:
+			break;
+		}
+		auto chunk_rows = cfg.layout->chunk_rows == 0 ? cfg.rows : std::min(cfg.layout->chunk_rows, cfg.rows);
+		auto chunk_cols = cfg.layout->chunk_cols == 0 ? cfg.cols : std::min(cfg.layout->chunk_cols, cfg.cols);
+		if (!dcpl.SetChunk({ chunk_rows, chunk_cols })) {
+			return false;
+		}
+		if (cfg.filter->nsb != 0 && !dcpl.SetBitRound(cfg.filter->nsb)) {
+			return false;
+		}
+		if (cfg.filter->shuffle && !dcpl.SetShuffle()) {
+			return false;
+		}
+		switch (cfg.filter->codec) {
+		case Codec::None:
+			break;
+		case Codec::Deflate:
+			return dcpl.SetDeflate((unsigned int)cfg.filter->level);
+		case Codec::LZ4:
+			return dcpl.SetLZ4();
+		case Codec::Zstd:
+			return dcpl.SetZstd(cfg.filter->level);
+		}
+		return true;
+	}
+
+	uint64_t GetFileSize(const char* filename)
+	{
+		std::ifstream is(filename, std::ios::binary | std::ios::ate);
+		return is ? (uint64_t)is.tellg() : 0;
+	}
+
+	// writes the dataset in bands of rows
+	bool Write(const Config& cfg, const Options& opt, const std::vector<double>& data, Result& result)
+	{
+		std::vector<double> latency;
+		auto start = bench::Clock::now();
+		{
+			HDF5::File f;
+			HDF5::DatasetCreationPropertyList dcpl;
+			if (!f.Create(FileName, H5F_ACC_TRUNC, HDF5::PropertyList(), MakeFapl(cfg)) || !MakeDcpl(cfg, dcpl)) {
+				return false;
+			}
+			HDF5::Dataspace fspace(std::vector<hsize_t>{ cfg.rows, cfg.cols });
+			auto dset = f.CreateDataset(DatasetName, HDF5::FloatPDT::Native_DOUBLE, fspace, HDF5::PropertyList(), dcpl, MakeDapl(cfg));
+			if (!dset.IsValid()) {
+				return false;
+			}
+			for (hsize_t row = 0; row < cfg.rows; row += opt.band) {
+				hsize_t offset[2] = { row, 0 };
+				hsize_t count[2] = { std::min(opt.band, cfg.rows - row), cfg.cols };
+				auto op = bench::Clock::now();
+				HDF5::Dataspace mspace(std::vector<hsize_t>{ count[0], count[1] });
+				if (!fspace.SelectHyperslab(HDF5::Dataspace::SelectionOperation::Set, offset, nullptr, count, nullptr) ||
+					!dset.Write(HDF5::FloatPDT::Native_DOUBLE, mspace, fspace, data.data() + row * cfg.cols)) {
+					return false;
+				}
+				latency.push_back(bench::ElapsedUs(op));
+			}
+			if (!f.Close()) {
+				return false;
+			}
+		}
+		auto elapsed = bench::ElapsedUs(start);
+		result.mbps = (double)(cfg.rows * cfg.cols * sizeof(double)) / elapsed;
+		result.latency = bench::Summarize(latency);
+		return true;
+	}
+
+	// reopens the file and reads with one access pattern
+	bool Read(const Config& cfg, const Options& opt, Pattern pattern, Result& result)
+	{
+		std::vector<double> latency;
+		std::vector<double> buf(std::max(opt.band, cfg.rows) * cfg.cols);	// a band, or a column
+		uint64_t bytes{ 0 };
+		uint32_t seed{ 7 };
+		auto random = [&seed](hsize_t n) { seed = seed * 1664525 + 1013904223; return (hsize_t)(seed >> 8) % n; };
+
+		auto start = bench::Clock::now();
+		{
+			HDF5::File f;
+			if (!f.Open(FileName, H5F_ACC_RDONLY, MakeFapl(cfg))) {
+				return false;
+			}
+			auto dset = f.OpenDataset(DatasetName, MakeDapl(cfg));
+			if (!dset.IsValid()) {
+				return false;
+			}
+			auto fspace = dset.GetDataspace();
+
+			// one read of count elements at offset, or of one point if count is null
+			auto read = [&](const hsize_t* offset, const hsize_t* count) {
+				auto op = bench::Clock::now();
+				bool ok;
+				if (count != nullptr) {
+					HDF5::Dataspace mspace(std::vector<hsize_t>{ count[0], count[1] });
+					ok = fspace.SelectHyperslab(HDF5::Dataspace::SelectionOperation::Set, offset, nullptr, count, nullptr) &&
+						dset.Read(HDF5::FloatPDT::Native_DOUBLE, mspace, fspace, buf.data());
+					bytes += count[0] * count[1] * sizeof(double);
+				}
+				else {
+					HDF5::Dataspace mspace(std::vector<hsize_t>{ 1 });
+					ok = fspace.SelectElements(HDF5::Dataspace::SelectionOperation::Set, 1, offset) &&
+						dset.Read(HDF5::FloatPDT::Native_DOUBLE, mspace, fspace, buf.data());
+					bytes += sizeof(double);
+				}
+				latency.push_back(bench::ElapsedUs(op));
+				return ok;
+			};
+
+			switch (pattern) {
+			case Pattern::Sequential:
+				for (hsize_t row = 0; row < cfg.rows; row += opt.band) {
+					hsize_t offset[2] = { row, 0 };
+					hsize_t count[2] = { std::min(opt.band, cfg.rows - row), cfg.cols };
+					if (!read(offset, count)) {
+						return false;
+					}
+				}
+				break;
+			case Pattern::Strided:
+				for (hsize_t row = 0; row < cfg.rows; row += opt.stride) {
+					hsize_t offset[2] = { row, 0 };
+					hsize_t count[2] = { 1, cfg.cols };
+					if (!read(offset, count)) {
+						return false;
+					}
+				}
+				break;
+			case Pattern::Rows:
+				for (long i = 0; i < opt.lines; ++i) {
+					hsize_t offset[2] = { random(cfg.rows), 0 };
+					hsize_t count[2] = { 1, cfg.cols };
+					if (!read(offset, count)) {
+						return false;
+					}
+				}
+				break;
+			case Pattern::Columns:
+				for (long i = 0; i < opt.lines; ++i) {
+					hsize_t offset[2] = { 0, random(cfg.cols) };
+					hsize_t count[2] = { cfg.rows, 1 };
+					if (!read(offset, count)) {
+						return false;
+					}
+				}
+				break;
+			case Pattern::Points:
+				for (long i = 0; i < opt.points; ++i) {
+					hsize_t point[2] = { random(cfg.rows), random(cfg.cols) };
+					if (!read(point, nullptr)) {
+						return false;
+					}
+				}
+				break;
+			}
+			if (!f.Close()) {
+				return false;
+			}
+		}
+		auto elapsed = bench::ElapsedUs(start);
+		result.mbps = (double)bytes / elapsed;
+		result.latency = bench::Summarize(latency);
+		return true;
+	}
+
+	// the combinations that make sense: compact only where the data fits, filters and chunk cache only for chunked layouts
+	void BuildMatrix(hsize_t rows, hsize_t cols, std::vector<Config>& configs)
+	{
+		const struct {
+			const char* name;
+			hsize_t rows;
+			hsize_t cols;
+		} Sizes[] = { { "small", SmallRows, SmallCols }, { "large", rows, cols } };
+
+		for (auto& size : Sizes) {
+			for (auto& layout : Layouts) {
+				if (layout.kind == LayoutKind::Compact && size.rows * size.cols * sizeof(double) > CompactLimit) {
+					continue;
+				}
+				auto chunked = layout.kind == LayoutKind::Chunked;
+				for (auto& filter : Filters) {
+					if ((!chunked && filter.codec != Codec::None) ||
+						(filter.codec == Codec::LZ4 && !HDF5::LZ4Filter::IsAvailable()) ||
+						(filter.codec == Codec::Zstd && !HDF5::ZstdFilter::IsAvailable())) {
+						continue;
+					}
+					for (auto& cache : Caches) {
+						if (!chunked && &cache != &Caches[0]) {
+							continue;
+						}
+						for (auto& driver : Drivers) {
+							Config cfg;
+							cfg.label = std::string(size.name) + "/" + layout.name + "/" + filter.name + "/" + cache.name + "/" + driver.name;
+							cfg.small = &size == &Sizes[0];
+							cfg.rows = size.rows;
+							cfg.cols = size.cols;
+							cfg.layout = &layout;
+							cfg.filter = &filter;
+							cfg.cache = &cache;
+							cfg.driver = &driver;
+							configs.push_back(cfg);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	void Report(std::ofstream& csv, const Config& cfg, const char* pattern, const Result& r, uint64_t file_size)
+	{
+		printf("%-50s %-10s %10.1f %10.1f %10.1f %10.1f %10.2f\n", cfg.label.c_str(), pattern, r.mbps,
+			r.latency.median, r.latency.p90, r.latency.p99, file_size / 1e6);
+		if (csv.is_open()) {
+			csv << cfg.label << "," << pattern << "," << r.mbps << "," << r.latency.median << "," << r.latency.p90 << ","
+				<< r.latency.p99 << "," << file_size << "\n";
+		}
+	}
+}
+
+namespace bench {
+
+	int Throughput(int argc, char** argv)
+	{
+		auto rows = GetOption(argc, argv, "rows", 1024);
+		auto cols = GetOption(argc, argv, "cols", 1024);
+		Options opt;
+		opt.band = (hsize_t)GetOption(argc, argv, "band", 64);
+		opt.stride = (hsize_t)GetOption(argc, argv, "stride", 16);
+		opt.lines = GetOption(argc, argv, "lines", 32);
+		opt.points = GetOption(argc, argv, "points", 1000);
+		auto only = GetOptionString(argc, argv, "only", "");
+		auto csv_name = GetOptionString(argc, argv, "csv", nullptr);
+		if (rows < 1 || cols < 1 || opt.band < 1 || opt.stride < 1 || opt.lines < 1 || opt.points < 1) {
+			printf("rows, cols, band, stride, lines and points must be >= 1\n");
+			return 1;
+		}
+
+		if ((HDF5::LZ4Filter::IsAvailable() && !HDF5::Library::RegisterFilter(std::make_shared<HDF5::LZ4Filter>())) ||
+			(HDF5::ZstdFilter::IsAvailable() && !HDF5::Library::RegisterFilter(std::make_shared<HDF5::ZstdFilter>())) ||
+			!HDF5::Library::RegisterFilter(std::make_shared<HDF5::QuantizeFilter>())) {
+			printf("failed to register the LZ4 / Zstandard / quantization filters\n");
+			return 1;
+		}
+
+		std::vector<Config> configs;
+		BuildMatrix((hsize_t)rows, (hsize_t)cols, configs);
+
+		std::ofstream csv;
+		if (csv_name != nullptr) {
+			csv.open(csv_name, std::ios::trunc);
+			if (!csv) {
+				printf("cannot write %s\n", csv_name);
+				return 1;
+			}
+			csv << "config,pattern,mb_per_s,p50_us,p90_us,p99_us,file_bytes\n";
+		}
+
+		std::vector<double> small_data, large_data;
+		Generate(SmallRows, SmallCols, small_data);
+		Generate((hsize_t)rows, (hsize_t)cols, large_data);
+
+		printf("%-50s %-10s %10s %10s %10s %10s %10s\n", "size/layout/filters/cache/driver", "pattern", "MB/s", "p50 us", "p90 us", "p99 us", "file MB");
+		int rv{ 0 };
+		for (auto& cfg : configs) {
+			if (strstr(cfg.label.c_str(), only) == nullptr) {
+				continue;
+			}
+			auto& data = cfg.small ? small_data : large_data;
+			Result r;
+			if (!Write(cfg, opt, data, r)) {
+				printf("%-50s write failed\n", cfg.label.c_str());
+				rv = 1;
+				continue;
+			}
+			auto file_size = GetFileSize(FileName);
+			Report(csv, cfg, "write", r, file_size);
+			for (auto& p : Patterns) {
+				if (!Read(cfg, opt, p.pattern, r)) {
+					printf("%-50s %s read failed\n", cfg.label.c_str(), p.name);
+					rv = 1;
+					continue;
+				}
+				Report(csv, cfg, p.name, r, file_size);
+			}
+		}
+		return rv;
+	}
+}
@@ -0,0 +1,122 @@
+// bench_vds.cpp
+// measures building a virtual dataset over many source datasets, opening it and reading it back
+// options: --sources=N (source datasets, one row each), --columns=N (elements per source)
+//
+
+#include "pch.h"
+#include "bench.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include <hdf5pp.h>
+
+namespace {
+
+	const char* const SourceFileName = "bench_vds_src.h5";
+	const char* const VirtualFileName = "bench_vds.h5";
+
+	bool BuildSources(long sources, long columns)
+	{
+		HDF5::File f;
+		if (!f.Create(SourceFileName, H5F_ACC_TRUNC)) {
+			return false;
+		}
+		std::vector<double> row((size_t)columns);
+		char name[32];
+		for (long i = 0; i < sources; ++i) {
+			std::fill(row.begin(), row.end(), (double)i);
+			snprintf(name, sizeof(name), "s%06ld", i);
+			if (!f.AddDataset(name, row.data(), row.size())) {
+				return false;
+			}
+		}
+		return f.Close();
+	}
+}
+
+namespace bench {
+
+	int VDS(int argc, char** argv)
+	{
+		auto sources = GetOption(argc, argv, "sources", 10000);
+		auto columns = GetOption(argc, argv, "columns", 256);
+		if (sources < 1 || columns < 1) {
+			printf("sources and columns must be >= 1\n");
+			return 1;
+		}
+
+		printf("building %ld source datasets of %ld elements\n", sources, columns);
+		if (!BuildSources(sources, columns)) {
+			printf("failed to build %s\n", SourceFileName);
+			return 1;
+		}
+
+		std::vector<hsize_t> vdims{ (hsize_t)sources, (hsize_t)columns };
+		std::vector<hsize_t> src_dims{ (hsize_t)columns };
+
+		// source i is row i of the virtual dataset
+		auto start = Clock::now();
+		HDF5::DatasetCreationPropertyList dcpl;
+		char name[32];
+		for (long i = 0; i < sources; ++i) {
+			snprintf(name, sizeof(name), "s%06ld", i);
+			if (!dcpl.AddVirtualMapping(vdims, { (hsize_t)i, 0 }, SourceFileName, name, src_dims)) {
+				printf("failed to add mapping %ld\n", i);
+				return 1;
+			}
+		}
+		auto mapped = ElapsedUs(start);
+
+		start = Clock::now();
+		{
+			HDF5::File f;
+			if (!f.Create(VirtualFileName, H5F_ACC_TRUNC)) {
+				printf("failed to create %s\n", VirtualFileName);
+				return 1;
+			}
+			auto dset = f.CreateDataset("vds", HDF5::FloatPDT::Native_DOUBLE, HDF5::Dataspace(vdims), HDF5::PropertyList(), dcpl);
+			if (!dset.IsValid() || !f.Close()) {
+				printf("failed to create the virtual dataset\n");
+				return 1;
+			}
+		}
+		auto created = ElapsedUs(start);
+
+		start = Clock::now();
+		HDF5::File f;
+		if (!f.Open(VirtualFileName, H5F_ACC_RDONLY)) {
+			printf("failed to open %s\n", VirtualFileName);
+			return 1;
+		}
+		auto dset = f.OpenDataset("vds");
+		auto read_dcpl = dset.GetCreationPropertyList();
+		size_t count{ 0 };
+		if (!read_dcpl.GetVirtualCount(count) || count != (size_t)sources) {
+			printf("expected %ld mappings, found %zu\n", sources, count);
+			return 1;
+		}
+		auto opened = ElapsedUs(start);
+
+		start = Clock::now();
+		auto dspace = dset.GetDataspace();
+		std::vector<double> data((size_t)(sources * columns));
+		if (!dset.Read(HDF5::FloatPDT::Native_DOUBLE, dspace, dspace, data.data())) {
+			printf("failed to read the virtual dataset\n");
+			return 1;
+		}
+		auto read = ElapsedUs(start);
+		for (long i = 0; i < sources; ++i) {
+			if (data[(size_t)(i * columns)] != (double)i || data[(size_t)(i * columns + columns - 1)] != (double)i) {
+				printf("row %ld does not match its source\n", i);
+				return 1;
+			}
+		}
+
+		printf("add %ld mappings:       %12.1f us\n", sources, mapped);
+		printf("create virtual dataset: %12.1f us\n", created);
+		printf("open + list mappings:   %12.1f us\n", opened);
+		printf("read all sources:       %12.1f us\n", read);
+		return 0;
+	}
+}
@@ -0,0 +1,262 @@
+// bench_vfd.cpp
+// test harness for the C++ file drivers (hdf5pp_vfd.h), run next to the library's own sec2 driver
+// every driver writes a file with groups, attributes, a contiguous and a chunked, compressed dataset; the file
+// is then checked through the driver, through the default driver and with two opens of the same file
+// through the driver, and compared byte for byte with the file written by the library's sec2 driver (object
+// times are not recorded, so the files are the same); reported times cover the write and the read back through
+// the driver; the direct variant of the coalescing driver needs a file system that supports O_DIRECT
+// options: --mb=N (megabytes per dataset), --groups=N, --only=name
+//
+
+#include "pch.h"
+#include "bench.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include <hdf5pp.h>
+
+namespace {
+
+	const char* const FileName = "bench_vfd.h5";
+	const char* const ReferenceName = "bench_vfd_ref.h5";
+
+	struct Driver {
+		const char* name;
+		bool (*set)(HDF5::FileAccessPropertyList& fapl);
+		void (*report)();	// prints the driver's counters after the checks, may be null
+	};
+
+	bool SetNative(HDF5::FileAccessPropertyList& fapl)
+	{
+		return fapl.SetSec2Driver();
+	}
+
+	bool SetSec2(HDF5::FileAccessPropertyList& fapl)
+	{
+		return fapl.SetDriver(HDF5::Sec2DriverFactory());
+	}
+
+	// the property lists keep copies of the factory, which share its counters
+	HDF5::BlockCacheDriverFactory g_blockCache;
+
+	bool SetBlockCache(HDF5::FileAccessPropertyList& fapl)
+	{
+		g_blockCache.ResetStats();
+		return fapl.SetDriver(g_blockCache);
+	}
+
+	void ReportBlockCache()
+	{
+		auto s = g_blockCache.GetStats();
+		printf("%-24s hits %llu, misses %llu, read ahead %llu (%llu used), bypassed %llu, %llu reads of %.1f KB on average\n", "",
+			(unsigned long long)s.hits, (unsigned long long)s.misses, (unsigned long long)s.read_ahead, (unsigned long long)s.read_ahead_hits,
+			(unsigned long long)s.bypassed, (unsigned long long)s.file_reads, s.file_reads > 0 ? s.file_bytes / 1024.0 / s.file_reads : 0.0);
+	}
+
+	HDF5::CoalescingDriverFactory g_coalescing;
+	HDF5::CoalescingDriverFactory g_coalescingDirect([] {
+		HDF5::CoalescingDriverFactory::Config cfg;
+		cfg.direct = true;
+		return cfg;
+	}());
+
+	bool SetCoalescing(HDF5::FileAccessPropertyList& fapl)
+	{
+		g_coalescing.ResetStats();
+		return fapl.SetDriver(g_coalescing);
+	}
+
+	bool SetCoalescingDirect(HDF5::FileAccessPropertyList& fapl)
+	{
+		g_coalescingDirect.ResetStats();
+		return fapl.SetDriver(g_coalescingDirect);
+	}
+
+	void ReportCoalescing(const HDF5::CoalescingDriverFactory& factory)
+	{
+		auto s = factory.GetStats();
+		printf("%-24s %llu writes of %.1f KB merged into %llu of %.1f KB on average, %llu blocks read back\n", "",
+			(unsigned long long)s.writes, s.writes > 0 ? s.write_bytes / 1024.0 / s.writes : 0.0,
+			(unsigned long long)s.extents, s.extents > 0 ? s.extent_bytes / 1024.0 / s.extents : 0.0, (unsigned long long)s.read_backs);
+	}
+
+	void ReportCoalescing()
+	{
+		ReportCoalescing(g_coalescing);
+	}
+
+	void ReportCoalescingDirect()
+	{
+		ReportCoalescing(g_coalescingDirect);
+	}
+
+	const Driver Drivers[] = {
+		{ "native-sec2", SetNative, nullptr },
+		{ "hdf5pp-sec2", SetSec2, nullptr },
+		{ "hdf5pp-block-cache", SetBlockCache, ReportBlockCache },
+		{ "hdf5pp-coalescing", SetCoalescing, ReportCoalescing },
+		{ "hdf5pp-coalescing-direct", SetCoalescingDirect, ReportCoalescingDirect },
+	};
+
+	struct Options {
+		hsize_t elements;
+		long groups;
+	};
+
+	bool WriteFile(const char* file_name, const Driver& driver, const Options& opt, const std::vector<double>& data)
+	{
+		HDF5::File f;
+		HDF5::FileAccessPropertyList fapl;
+		if (!driver.set(fapl) || !f.Create(file_name, H5F_ACC_TRUNC, HDF5::PropertyList(), fapl)) {
+			return false;
+		}
+		HDF5::GroupCreationPropertyList gcpl;
+		if (!gcpl.SetTrackTimes(false)) {
+			return false;
+		}
+		char name[32];
+		for (long g = 0; g < opt.groups; ++g) {
+			snprintf(name, sizeof(name), "group%05ld", g);
+			auto grp = f.CreateGroup(name, HDF5::PropertyList(), gcpl);
+			if (!grp.IsValid() || !grp.AddAttribute("index", (int32_t)g)) {
+				return false;
+			}
+		}
+		HDF5::DatasetCreationPropertyList dcpl;
+		if (!dcpl.SetTrackTimes(false)) {
+			return false;
+		}
+		HDF5::Dataspace fspace(std::vector<hsize_t>{ opt.elements });
+		auto dset = f.CreateDataset("contiguous", HDF5::FloatPDT::Native_DOUBLE, fspace, HDF5::PropertyList(), dcpl);
+		if (!dset.IsValid() || !dset.Write(HDF5::FloatPDT::Native_DOUBLE, fspace, fspace, data.data())) {
+			return false;
+		}
+		if (!dcpl.SetChunk({ std::min(opt.elements, (hsize_t)65536) }) || !dcpl.SetDeflate(1)) {
+			return false;
+		}
+		dset = f.CreateDataset("chunked", HDF5::FloatPDT::Native_DOUBLE, fspace, HDF5::PropertyList(), dcpl);
+		return dset.IsValid() && dset.Write(HDF5::FloatPDT::Native_DOUBLE, fspace, fspace, data.data()) && f.Close();
+	}
+
+	bool CheckDataset(HDF5::File& f, const char* name, const std::vector<double>& data)
+	{
+		auto dset = f.OpenDataset(name);
+		if (!dset.IsValid()) {
+			return false;
+		}
+		auto space = dset.GetDataspace();
+		std::vector<double> buf(data.size());
+		return space.GetSimpleExtentElementsCount() == (hssize_t)data.size() &&
+			dset.Read(HDF5::FloatPDT::Native_DOUBLE, space, space, buf.data()) &&
+			memcmp(buf.data(), data.data(), data.size() * sizeof(double)) == 0;
+	}
+
+	// reads everything back through fapl and compares
+	bool CheckFile(const HDF5::PropertyList& fapl, const Options& opt, const std::vector<double>& data)
+	{
+		HDF5::File f;
+		if (!f.Open(FileName, H5F_ACC_RDONLY, fapl)) {
+			return false;
+		}
+		char name[32];
+		for (long g = 0; g < opt.groups; ++g) {
+			snprintf(name, sizeof(name), "group%05ld", g);
+			int32_t index{ -1 };
+			auto grp = f.OpenGroup(name);
+			if (!grp.IsValid() || !grp.ReadAttribute("index", index) || index != g) {
+				return false;
+			}
+		}
+		return CheckDataset(f, "contiguous", data) && CheckDataset(f, "chunked", data) && f.Close();
+	}
+
+	// opens the file twice; the driver must tell the library both are the same file
+	bool CheckTwoOpens(const HDF5::PropertyList& fapl, const std::vector<double>& data)
+	{
+		HDF5::File f1, f2;
+		if (!f1.Open(FileName, H5F_ACC_RDONLY, fapl) || !f2.Open(FileName, H5F_ACC_RDONLY, fapl)) {
+			return false;
+		}
+		unsigned long fileno1{ 0 }, fileno2{ 0 };
+		return f1.GetFileno(fileno1) && f2.GetFileno(fileno2) && fileno1 == fileno2 &&
+			CheckDataset(f2, "contiguous", data);
+	}
+
+	// compares the file with the one written by the library's sec2 driver
+	bool CheckSameBytes()
+	{
+		std::ifstream f1(FileName, std::ios::binary), f2(ReferenceName, std::ios::binary);
+		return f1.is_open() && f2.is_open() &&
+			std::equal(std::istreambuf_iterator<char>(f1), std::istreambuf_iterator<char>(),
+				std::istreambuf_iterator<char>(f2), std::istreambuf_iterator<char>());
+	}
+}
+
+namespace bench {
+
+	int VFD(int argc, char** argv)
+	{
+		Options opt;
+		opt.elements = (hsize_t)GetOption(argc, argv, "mb", 64) * (1 << 20) / sizeof(double);
+		opt.groups = GetOption(argc, argv, "groups", 1000);
+		auto only = GetOptionString(argc, argv, "only", nullptr);
+		if (opt.elements == 0 || opt.groups < 0) {
+			printf("mb must be >= 1 and groups >= 0\n");
+			return 1;
+		}
+
+		std::vector<double> data(opt.elements);
+		for (hsize_t i = 0; i < opt.elements; ++i) {
+			data[i] = (double)(i % 4096) * 0.25;
+		}
+		auto mb = 2.0 * opt.elements * sizeof(double) / (1 << 20);
+
+		if (!WriteFile(ReferenceName, Drivers[0], opt, data)) {
+			printf("failed to write the reference file\n");
+			return 1;
+		}
+
+		printf("%-24s %8s %8s %8s %8s %10s %10s\n", "driver", "driver", "default", "2 opens", "= sec2", "write MB/s", "read MB/s");
+		int rv{ 0 };
+		for (auto& driver : Drivers) {
+			if (only != nullptr && strcmp(only, driver.name) != 0) {
+				continue;
+			}
+			HDF5::FileAccessPropertyList fapl;
+			if (!driver.set(fapl)) {
+				printf("%-24s failed to set the driver\n", driver.name);
+				rv = 1;
+				continue;
+			}
+
+			auto start = Clock::now();
+			if (!WriteFile(FileName, driver, opt, data)) {
+				printf("%-24s write failed\n", driver.name);
+				rv = 1;
+				continue;
+			}
+			auto write_s = ElapsedUs(start) / 1e6;
+			start = Clock::now();
+			auto driver_ok = CheckFile(fapl, opt, data);
+			auto read_s = ElapsedUs(start) / 1e6;
+			auto default_ok = CheckFile(HDF5::PropertyList(), opt, data);
+			auto twice_ok = CheckTwoOpens(fapl, data);
+			auto same_ok = CheckSameBytes();
+
+			printf("%-24s %8s %8s %8s %8s %10.1f %10.1f\n", driver.name, driver_ok ? "ok" : "FAIL", default_ok ? "ok" : "FAIL",
+				twice_ok ? "ok" : "FAIL", same_ok ? "ok" : "FAIL", mb / write_s, mb / read_s);
+			if (driver.report != nullptr) {
+				driver.report();
+			}
+			if (!driver_ok || !default_ok || !twice_ok || !same_ok) {
+				rv = 1;
+			}
+		}
+		return rv;
+	}
+}
@@ -1,6 +1,8 @@
 // dllmain.cpp : Defines the entry point for the DLL application.
 #include "pch.h"
 
+#ifdef _WIN32
+
 BOOL APIENTRY DllMain( HMODULE /*hModule*/,
                        DWORD  ul_reason_for_call,
                        LPVOID /*lpReserved*/
@@ -17,3 +19,4 @@ BOOL APIENTRY DllMain( HMODULE /*hModule*/,
     return TRUE;
 }
 
+#endif
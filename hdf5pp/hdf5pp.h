@@ -14,5 +14,22 @@
 #include "hdf5pp_group.h"
 #include "hdf5pp_file.h"
 #include "hdf5pp_dtypeof.h"
+#include "hdf5pp_catalog.h"
+#include "hdf5pp_metrics.h"
+#include "hdf5pp_trace.h"
+#include "hdf5pp_filemetrics.h"
+#include "hdf5pp_vfd.h"
+#include "hdf5pp_vfd_sec2.h"
+#include "hdf5pp_vfd_cache.h"
+#include "hdf5pp_vfd_coalesce.h"
+#include "hdf5pp_shard.h"
+#include "hdf5pp_tail.h"
+#include "hdf5pp_appender.h"
+#include "hdf5pp_layout.h"
+#include "hdf5pp_chunkplan.h"
+#include "hdf5pp_filter.h"
+#include "hdf5pp_shuffle.h"
+#include "hdf5pp_quantize.h"
+#include "hdf5pp_delta.h"
 
 
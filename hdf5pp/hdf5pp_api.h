@@ -6,13 +6,25 @@
 // HDF5PP_API functions as being imported from a DLL, whereas this DLL sees symbols
 // defined with this macro as being exported.
 
+#ifdef _WIN32
 #ifdef HDF5PP_EXPORTS
 #define HDF5PP_API __declspec(dllexport)
 #else
 #define HDF5PP_API __declspec(dllimport)
 #endif
+#else
+// shared objects export all symbols by default
+#define HDF5PP_API
+#endif
+
+// on LP64 platforms other than macOS int64_t/uint64_t are long/unsigned long, so the separate
+// long overloads are left out
+#if defined(__LP64__) && !defined(__APPLE__)
+#define HDF5PP_LONG_IS_INT64
+#endif
 
 #include <cassert>
+#include <map>
 #include <string>
 #include <vector>
 
@@ -0,0 +1,242 @@
+#include "pch.h"
+#include "hdf5pp_appender.h"
+#include "hdf5pp_dspace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace HDF5 {
+
+	namespace {
+
+		double ElapsedUs(std::chrono::steady_clock::time_point start)
+		{
+			return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+		}
+	}
+
+	BufferedAppender::BufferedAppender(const Dataset& dset, const Datatype& mem_dtype, const Config& cfg /*= Config()*/)
+		: m_dset(dset), m_memDtype(mem_dtype), m_cfg(cfg)
+	{
+	}
+
+	BufferedAppender::~BufferedAppender()
+	{
+		Stop();
+	}
+
+	bool BufferedAppender::Start()
+	{
+		if (m_thread.joinable() || m_cfg.buffers < 2 || m_cfg.buffer_rows == 0) {
+			return false;
+		}
+		auto dspace = m_dset.GetDataspace();
+		auto rank = dspace.GetSimpleExtentDimsCount();
+		if (rank <= 0) {
+			return false;
+		}
+		m_dims.resize((size_t)rank);
+		if (dspace.GetSimpleExtentDims(m_dims.data()) < 0) {
+			return false;
+		}
+		m_rowBytes = m_memDtype.GetSize();
+		for (int i = 1; i < rank; ++i) {
+			m_rowBytes *= (size_t)m_dims[i];
+		}
+		if (m_rowBytes == 0) {
+			return false;
+		}
+		auto dcpl = m_dset.GetCreationPropertyList();
+		DatasetCreationPropertyList::Layout layout;
+		std::vector<hsize_t> chunk;
+		m_chunkRows = 0;
+		if (m_cfg.chunk_aligned && dcpl.GetLayout(layout) && layout == DatasetCreationPropertyList::Layout::Chunked &&
+			dcpl.GetChunk(chunk) && !chunk.empty() && chunk[0] > 0) {
+			m_chunkRows = chunk[0];
+			m_cfg.buffer_rows = (size_t)std::max<hsize_t>(m_cfg.buffer_rows / chunk[0] * chunk[0], chunk[0]);
+		}
+
+		std::lock_guard<std::mutex> guard(m_lock);
+		m_buffers.assign(m_cfg.buffers, std::vector<char>(m_cfg.buffer_rows * m_rowBytes));
+		m_free.clear();
+		for (unsigned int b = m_cfg.buffers; b > 0; --b) {
+			m_free.push_back(b - 1);
+		}
+		m_full.clear();
+		m_writing = false;
+		m_hasCurrent = false;
+		m_fill = 0;
+		m_next = m_dims[0];
+		m_failed = false;
+		m_stop = false;
+		m_stats = Stats();
+		m_thread = std::thread(&BufferedAppender::Run, this);
+		return true;
+	}
+
+	bool BufferedAppender::NextBuffer(std::unique_lock<std::mutex>& lock)
+	{
+		if (m_free.empty()) {
+			if (m_cfg.policy == FullPolicy::DropNewest) {
+				return false;
+			}
+			if (m_cfg.policy == FullPolicy::DropOldest && !m_full.empty()) {
+				m_stats.rows_dropped += m_full.front().rows;
+				m_next -= m_full.front().rows;
+				m_free.push_back(m_full.front().buffer);
+				m_full.pop_front();
+			}
+			else {
+				auto start = std::chrono::steady_clock::now();
+				m_changed.wait(lock, [this] { return !m_free.empty() || m_hasCurrent; });
+				m_stats.blocked_us += ElapsedUs(start);
+				// another producer took a buffer while this one waited
+				if (m_hasCurrent) {
+					return true;
+				}
+			}
+		}
+		m_current = m_free.back();
+		m_free.pop_back();
+		m_hasCurrent = true;
+		m_fill = 0;
+		// a buffer starting inside a chunk ends with it; buffer_rows is a whole number of chunks
+		m_limit = m_cfg.buffer_rows;
+		if (m_chunkRows > 0 && m_next % m_chunkRows != 0) {
+			m_limit = (size_t)(m_chunkRows - m_next % m_chunkRows);
+		}
+		return true;
+	}
+
+	bool BufferedAppender::Append(const void* buf, size_t nrows)
+	{
+		std::unique_lock<std::mutex> lock(m_lock);
+		if (!m_thread.joinable() || m_failed) {
+			return false;
+		}
+		m_stats.rows_appended += nrows;
+		auto src = (const char*)buf;
+		while (nrows > 0) {
+			if (!m_hasCurrent && !NextBuffer(lock)) {
+				m_stats.rows_dropped += nrows;
+				return false;
+			}
+			auto n = std::min(nrows, m_limit - m_fill);
+			// copied with the lock held, so that neither another producer nor Flush sees the rows half copied
+			memcpy(m_buffers[m_current].data() + m_fill * m_rowBytes, src, n * m_rowBytes);
+			m_fill += n;
+			src += n * m_rowBytes;
+			nrows -= n;
+			if (m_fill == m_limit) {
+				m_full.push_back(Filled{ m_current, m_fill });
+				m_next += m_fill;
+				m_hasCurrent = false;
+				m_fill = 0;
+				m_stats.max_queued = std::max(m_stats.max_queued, (unsigned int)m_full.size());
+				m_changed.notify_all();
+			}
+		}
+		return !m_failed;
+	}
+
+	bool BufferedAppender::Flush()
+	{
+		std::unique_lock<std::mutex> lock(m_lock);
+		if (!m_thread.joinable()) {
+			return !m_failed;
+		}
+		if (m_hasCurrent && m_fill > 0) {
+			m_full.push_back(Filled{ m_current, m_fill });
+			m_next += m_fill;
+			m_hasCurrent = false;
+			m_fill = 0;
+			m_stats.max_queued = std::max(m_stats.max_queued, (unsigned int)m_full.size());
+			m_changed.notify_all();
+		}
+		m_changed.wait(lock, [this] { return m_full.empty() && !m_writing; });
+		return !m_failed;
+	}
+
+	bool BufferedAppender::Stop()
+	{
+		auto ok = Flush();
+		{
+			std::lock_guard<std::mutex> guard(m_lock);
+			m_stop = true;
+		}
+		m_changed.notify_all();
+		if (m_thread.joinable()) {
+			m_thread.join();
+		}
+		return ok;
+	}
+
+	BufferedAppender::Stats BufferedAppender::GetStats() const
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+		return m_stats;
+	}
+
+	bool BufferedAppender::WriteBuffer(const Filled& filled)
+	{
+		std::vector<hsize_t> start(m_dims.size(), 0), count = m_dims;
+		start[0] = m_dims[0];
+		count[0] = filled.rows;
+		m_dims[0] += filled.rows;
+		if (!m_dset.SetExtent(m_dims)) {
+			m_dims[0] = start[0];
+			return false;
+		}
+		auto file_dspace = m_dset.GetDataspace();
+		Dataspace mem_dspace(count);
+		return file_dspace.SelectHyperslab(Dataspace::SelectionOperation::Set, start.data(), nullptr, count.data(), nullptr) &&
+			m_dset.Write(m_memDtype, mem_dspace, file_dspace, m_buffers[filled.buffer].data());
+	}
+
+	void BufferedAppender::Run()
+	{
+		unsigned int unflushed{ 0 };
+		std::unique_lock<std::mutex> lock(m_lock);
+		for (;;) {
+			m_changed.wait(lock, [this] { return m_stop || !m_full.empty(); });
+			if (m_full.empty()) {
+				break;
+			}
+			auto filled = m_full.front();
+			m_full.pop_front();
+			m_writing = true;
+			// after a failure, the remaining buffers are dropped so that nobody waits for them
+			auto failed = m_failed;
+			lock.unlock();
+
+			auto start = std::chrono::steady_clock::now();
+			bool written{ false }, flushed{ true };
+			if (!failed) {
+				written = WriteBuffer(filled);
+				if (written && m_cfg.flush_every > 0 && ++unflushed >= m_cfg.flush_every) {
+					flushed = m_dset.Flush();
+					unflushed = 0;
+				}
+			}
+			auto elapsed = ElapsedUs(start);
+
+			lock.lock();
+			m_writing = false;
+			if (written) {
+				m_stats.rows_written += filled.rows;
+				++m_stats.buffers_written;
+				m_stats.max_write_us = std::max(m_stats.max_write_us, elapsed);
+			}
+			else {
+				m_stats.rows_dropped += filled.rows;
+			}
+			if (!failed && (!written || !flushed)) {
+				++m_stats.write_failures;
+				m_failed = true;
+			}
+			m_free.push_back(filled.buffer);
+			m_changed.notify_all();
+		}
+	}
+}
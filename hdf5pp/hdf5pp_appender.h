@@ -0,0 +1,117 @@
+// hdf5pp_appender.h
+// HDF5::BufferedAppender appends rows to a dataset that is extendible along its first dimension without making
+// the producer wait for the disk: Append copies rows into one of a few memory buffers, and a background thread
+// extends the dataset and writes each full buffer (SetExtent, Write, and Flush every flush_every buffers) while
+// the producer fills the next one
+// when every buffer is full or being written, the policy decides: wait for one (Block), drop the rows being
+// appended (DropNewest) or drop the oldest buffer still waiting (DropOldest); dropped rows are not written, so
+// the dataset holds the rows that were kept, in order
+// with chunk_aligned, buffers end on chunk boundaries of a chunked dataset, so that each chunk goes through the
+// filter pipeline once instead of being read back and filtered again when the next buffer completes it (e.g. with
+// DeltaFilter on timestamps); a buffer that starts inside a chunk, after an extent that is not a whole number of
+// chunks or a Flush, is cut short at the end of that chunk
+// several producer threads may call Append and Flush: rows are copied with the appender locked, so the rows of
+// one call stay together, except when it waits for a buffer (Block) and another call fills the next one first
+// while the appender runs, its thread is the one calling the HDF5 library for the dataset's file: other threads
+// may only call the library if it is a thread-safe build
+//
+#pragma once
+
+#include "hdf5pp_dset.h"
+#include "hdf5pp_dtype.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace HDF5 {
+
+	class HDF5PP_API BufferedAppender
+	{
+	public:
+		enum class FullPolicy {
+			Block,			// Append waits for a buffer to be written
+			DropNewest,		// Append drops the rows that do not fit and returns false
+			DropOldest		// the oldest full buffer not yet being written is dropped and reused
+		};
+
+		struct Config {
+			Config() : buffers(2), buffer_rows(65536), policy(FullPolicy::Block), flush_every(0), chunk_aligned(false) {}
+
+			unsigned int buffers;		// two at least
+			size_t buffer_rows;			// rows per buffer
+			FullPolicy policy;
+			unsigned int flush_every;	// flush the dataset after every flush_every written buffers; 0 never
+			bool chunk_aligned;			// end buffers on chunk boundaries, buffer_rows being rounded down to whole
+										// chunks (one at least)
+		};
+
+		struct Stats {
+			uint64_t rows_appended{ 0 };	// rows passed to Append
+			uint64_t rows_written{ 0 };
+			uint64_t rows_dropped{ 0 };		// by the policy, or lost in a failed write
+			uint64_t buffers_written{ 0 };
+			uint64_t write_failures{ 0 };
+			unsigned int max_queued{ 0 };	// high-water mark of full buffers waiting to be written
+			double max_write_us{ 0 };		// longest time taken to write (and flush) one buffer
+			double blocked_us{ 0 };			// total time Append waited for a buffer (Block)
+		};
+
+		// rows are appended after the current extent of dset, read from memory laid out as mem_dtype
+		BufferedAppender(const Dataset& dset, const Datatype& mem_dtype, const Config& cfg = Config());
+		BufferedAppender(const BufferedAppender&) = delete;
+		BufferedAppender& operator=(const BufferedAppender&) = delete;
+		virtual ~BufferedAppender();		// calls Stop
+
+		// Allocates the buffers and starts the background thread
+		bool Start();
+
+		// Copies nrows rows from buf; returns false if rows were dropped (DropNewest) or a write failed
+		bool Append(const void* buf, size_t nrows);
+
+		// Hands over the partly filled buffer and waits until every buffer is written; false if a write failed
+		bool Flush();
+
+		// Flushes and stops the background thread
+		bool Stop();
+
+		Stats GetStats() const;
+
+	protected:
+		struct Filled {
+			unsigned int buffer;
+			size_t rows;
+		};
+
+		// queues the current buffer and takes a free one, applying the policy; called with m_lock held
+		bool NextBuffer(std::unique_lock<std::mutex>& lock);
+
+		bool WriteBuffer(const Filled& filled);
+		void Run();
+
+		Dataset m_dset;
+		Datatype m_memDtype;
+		Config m_cfg;
+		size_t m_rowBytes{ 0 };
+		std::vector<hsize_t> m_dims;			// extent written so far
+
+		mutable std::mutex m_lock;				// guards everything below, with m_changed
+		std::condition_variable m_changed;
+		std::vector<std::vector<char>> m_buffers;
+		std::vector<unsigned int> m_free;
+		std::deque<Filled> m_full;				// waiting to be written, oldest first
+		bool m_writing{ false };				// the thread is writing a buffer taken from m_full
+		unsigned int m_current{ 0 };			// buffer being filled, if m_hasCurrent
+		bool m_hasCurrent{ false };
+		size_t m_fill{ 0 };						// rows in the current buffer
+		size_t m_limit{ 0 };					// rows the current buffer takes, buffer_rows unless chunk_aligned
+		hsize_t m_chunkRows{ 0 };				// rows per chunk with chunk_aligned, else 0
+		hsize_t m_next{ 0 };					// row of the dataset the next queued rows go to
+		bool m_failed{ false };
+		bool m_stop{ false };
+		Stats m_stats;
+		std::thread m_thread;
+	};
+}
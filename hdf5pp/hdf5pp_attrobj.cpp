@@ -4,9 +4,20 @@
 #include "hdf5pp_attribute.h"
 #include "hdf5pp_dtype.h"
 #include "hdf5pp_dspace.h"
+#include "hdf5pp_probe.h"
+
+#include <atomic>
 
 namespace HDF5 {
 
+	namespace {
+
+		// counts the attributes deleted or renamed through any object: an attribute deleted and created again under
+		// the same name through another object would be written through the cached identifier of the old one, with
+		// its old datatype, so the caches are only used while the count stays the same
+		std::atomic<uint64_t> g_attrGeneration{ 0 };
+	}
+
 	AttributedObject::AttributedObject(const AttributedObject& rhs)
 	{
 		m_hID = rhs.m_hID;
@@ -16,12 +27,13 @@ namespace HDF5 {
 	// let Location to its thing
 	AttributedObject::~AttributedObject()
 	{
-
+		ClearAttributeCache();
 	}
 
 	AttributedObject& AttributedObject::operator=(const AttributedObject& rhs)
 	{
 		if (this != &rhs) {
+			ClearAttributeCache();
 			DecrementReferenceCount();
 			m_hID = rhs.m_hID;
 			IncrementReferenceCount();
@@ -37,6 +49,7 @@ namespace HDF5 {
 			case H5I_DATASET:
 			case H5I_DATATYPE:
 			case H5I_FILE:
+				ClearAttributeCache();
 				DecrementReferenceCount();
 				m_hID = hid;
 				return true;
@@ -45,34 +58,53 @@ namespace HDF5 {
 			}
 		}
 		else {
+			ClearAttributeCache();
 			DecrementReferenceCount();
 			m_hID = InvalidHandle;
 			return true;
 		}
 	}
 
+	hid_t AttributedObject::Detach()
+	{
+		ClearAttributeCache();
+		return Location::Detach();
+	}
+
 	HDF5::Attribute AttributedObject::CreateAttribute(const char* attr_name, const Datatype& dtype, const Dataspace& dspace, const PropertyList& acpl /*= PropertyList()*/, const PropertyList& aapl /*= PropertyList()*/)
 	{
+		HDF5PP_PROBE_NAME(CreateAttribute, attr_name);
 		return Attribute(H5Acreate2(m_hID, attr_name, (hid_t)dtype, (hid_t)dspace, (hid_t)acpl, (hid_t)aapl));
 	}
 
 	HDF5::Attribute AttributedObject::CreateAttribute(const char* obj_name, const char* attr_name, const Datatype& dtype, const Dataspace& dspace, const PropertyList& acpl /*= PropertyList()*/, const PropertyList& aapl /*= PropertyList()*/, const PropertyList& lapl /*= PropertyList()*/)
 	{
+		HDF5PP_PROBE_NAME(CreateAttribute, attr_name);
 		return Attribute(H5Acreate_by_name(m_hID, obj_name, attr_name, (hid_t)dtype, (hid_t)dspace, (hid_t)acpl, (hid_t)aapl, (hid_t)lapl));
 	}
 
 	bool AttributedObject::DeleteAttribute(const char* attr_name)
 	{
+		auto it = m_attrCache.find(attr_name);
+		if (it != m_attrCache.end()) {
+			it->second.Close();
+			m_attrCache.erase(it);
+		}
+		++g_attrGeneration;
 		return H5Adelete(m_hID, attr_name) >= 0;
 	}
 
 	bool AttributedObject::DeleteAttribute(const char* obj_name, IndexType tIndex, OrderType tOrder, hsize_t nOffset, const PropertyList& lapl /*= PropertyList()*/)
 	{
+		ClearAttributeCache(); // obj_name may resolve to this object
+		++g_attrGeneration;
 		return H5Adelete_by_idx(m_hID, obj_name, (H5_index_t)tIndex, (H5_iter_order_t)tOrder, nOffset, (hid_t)lapl) >= 0;
 	}
 
 	bool AttributedObject::DeleteAttribute(const char* obj_name, const char* attr_name, const PropertyList& lapl /*= PropertyList()*/)
 	{
+		ClearAttributeCache(); // obj_name may resolve to this object
+		++g_attrGeneration;
 		return H5Adelete_by_name(m_hID, obj_name, attr_name, (hid_t)lapl) >= 0;
 	}
 
@@ -141,29 +173,124 @@ namespace HDF5 {
 
 	HDF5::Attribute AttributedObject::OpenAttribute(const char* attr_name, const PropertyList& aapl /*= PropertyList()*/)
 	{
+		HDF5PP_PROBE_NAME(OpenAttribute, attr_name);
 		return Attribute(H5Aopen(m_hID, attr_name, (hid_t)aapl));
 	}
 
 	HDF5::Attribute AttributedObject::OpenAttribute(const char* obj_name, IndexType tIndex, OrderType tOrder, hsize_t nOffset, const PropertyList& aapl /*= PropertyList()*/, const PropertyList& lapl /*= PropertyList()*/)
 	{
+		HDF5PP_PROBE_NAME(OpenAttribute, obj_name);
 		return Attribute(H5Aopen_by_idx(m_hID, obj_name, (H5_index_t)tIndex, (H5_iter_order_t)tOrder, nOffset, (hid_t)aapl, (hid_t)lapl));
 	}
 
 	HDF5::Attribute AttributedObject::OpenAttribute(const char* obj_name, const char* attr_name, const PropertyList& aapl /*= PropertyList()*/, const PropertyList& lapl /*= PropertyList()*/)
 	{
+		HDF5PP_PROBE_NAME(OpenAttribute, attr_name);
 		return Attribute(H5Aopen_by_name(m_hID, obj_name, attr_name, (hid_t)aapl, (hid_t)lapl));
 	}
 
 	bool AttributedObject::RenameAttribute(const char* old_attr_name, const char* new_attr_name)
 	{
+		auto it = m_attrCache.find(old_attr_name);
+		if (it != m_attrCache.end()) {
+			it->second.Close();
+			m_attrCache.erase(it);
+		}
+		++g_attrGeneration;
 		return H5Arename(m_hID, old_attr_name, new_attr_name) >= 0;
 	}
 
 	bool AttributedObject::RenameAttribute(const char* obj_name, const char* old_attr_name, const char* new_attr_name, const PropertyList& lapl /*= PropertyList()*/)
 	{
+		ClearAttributeCache(); // obj_name may resolve to this object
+		++g_attrGeneration;
 		return H5Arename_by_name(m_hID, obj_name, old_attr_name, new_attr_name, (hid_t)lapl) >= 0;
 	}
 
+	bool AttributedObject::RewriteAttribute(const char* name, const Datatype& mem_dtype, const void* buf, hsize_t length, bool* failed /*= nullptr*/)
+	{
+		if (failed != nullptr) {
+			*failed = false;
+		}
+
+		// the cache belongs to the identifier it was built for; drop it if we were re-attached
+		if (m_attrCacheOwner != m_hID) {
+			ClearAttributeCache();
+		}
+
+		auto generation = g_attrGeneration.load();
+		auto it = m_attrCache.find(name);
+		if (it != m_attrCache.end()) {
+			auto& cached = it->second;
+			if (cached.generation == generation && cached.length == length && H5Iis_valid(cached.attr) > 0 &&
+				H5Tequal(cached.dtype, (hid_t)mem_dtype) > 0) {
+				auto rv = H5Awrite(cached.attr, (hid_t)mem_dtype, buf) >= 0;
+				if (failed != nullptr) {
+					*failed = !rv;
+				}
+				return rv;
+			}
+			// different type or shape requested, or attributes deleted since; check again against what is stored
+			cached.Close();
+			m_attrCache.erase(it);
+		}
+
+		bool existsFailed{ false };
+		if (!AttributeExists(name, &existsFailed)) {
+			if (failed != nullptr) {
+				*failed = existsFailed;
+			}
+			return false;
+		}
+
+		auto attr = OpenAttribute(name);
+		auto dtype = attr.GetDatatype();
+		auto dspace = attr.GetDataspace();
+		Dataspace::Type t;
+		if (!attr.IsValid() || !dtype.IsValid() || !dspace.IsValid() || !dspace.GetSimpleExtentType(t)) {
+			if (failed != nullptr) {
+				*failed = true;
+			}
+			return false;
+		}
+
+		bool compatible = dtype.Equals(mem_dtype);
+		if (length == 0) {
+			compatible = compatible && t == Dataspace::Type::Scalar;
+		}
+		else {
+			compatible = compatible && t == Dataspace::Type::Simple && dspace.GetSimpleExtentDimsCount() == 1 && dspace.GetSimpleExtentElementsCount() == (hssize_t)length;
+		}
+		if (!compatible) {
+			return false;
+		}
+
+		if (!attr.Write(mem_dtype, buf)) {
+			if (failed != nullptr) {
+				*failed = true;
+			}
+			return false;
+		}
+
+		m_attrCache[name] = CachedAttribute{ attr.Detach(), dtype.Detach(), length, generation };
+		return true;
+	}
+
+	void AttributedObject::CachedAttribute::Close()
+	{
+		H5Aclose(attr);
+		H5Tclose(dtype);
+	}
+
+	void AttributedObject::ClearAttributeCache()
+	{
+		for (auto& it : m_attrCache) {
+			it.second.Close();
+		}
+		m_attrCache.clear();
+		m_attrCacheOwner = m_hID;
+	}
+
 #define ADDATTR(x, y) bool AttributedObject::AddAttribute(const char* name, x c)\
 	{\
 		auto attr = CreateAttribute(name, y, Dataspace());\
@@ -184,8 +311,10 @@ namespace HDF5 {
 	ADDATTR(uint64_t, IntegerPDT::Native_UINT64)
 	ADDATTR(float, FloatPDT::Native_FLOAT)
 	ADDATTR(double, FloatPDT::Native_DOUBLE)
+#ifndef HDF5PP_LONG_IS_INT64
 		ADDATTR(long, IntegerPDT::Native_LONG)
 		ADDATTR(unsigned long, IntegerPDT::Native_ULONG)
+#endif
 		ADDATTR(char, IntegerPDT::Native_CHAR)
 
 
@@ -247,56 +376,155 @@ namespace HDF5 {
 #undef ADDATTR2
 #undef ADDATTR3
 
+#pragma warning(push)
+#pragma warning(disable:4996)
+	namespace {
+
+#ifndef _WIN32
+		// longest formatted wide string, in characters; vswprintf does not report the required length
+		const size_t MaxFormatLength = 1 << 20;
+
+		// wchar_t holds UTF-32 outside Windows
+		void AppendUTF8(std::string& str, uint32_t c)
+		{
+			if (c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF)) {
+				c = 0xFFFD;
+			}
+			if (c < 0x80) {
+				str += (char)c;
+			}
+			else if (c < 0x800) {
+				str += (char)(0xC0 | (c >> 6));
+				str += (char)(0x80 | (c & 0x3F));
+			}
+			else if (c < 0x10000) {
+				str += (char)(0xE0 | (c >> 12));
+				str += (char)(0x80 | ((c >> 6) & 0x3F));
+				str += (char)(0x80 | (c & 0x3F));
+			}
+			else {
+				str += (char)(0xF0 | (c >> 18));
+				str += (char)(0x80 | ((c >> 12) & 0x3F));
+				str += (char)(0x80 | ((c >> 6) & 0x3F));
+				str += (char)(0x80 | (c & 0x3F));
+			}
+		}
+#endif
+
+		// formats a wide string and converts the result to UTF-8
+		bool FormatUTF8(const wchar_t* format, va_list args, std::string& str)
+		{
+#ifdef _WIN32
+			va_list measure;
+			va_copy(measure, args);
+			auto ss = _vsnwprintf(nullptr, 0, format, measure);
+			va_end(measure);
+			if (ss < 0) {
+				return false;
+			}
+			std::vector<wchar_t> msg((size_t)ss + 1);
+			vswprintf_s(msg.data(), msg.size(), format, args);
+
+			auto len = WideCharToMultiByte(CP_UTF8, 0, msg.data(), -1, NULL, 0, 0, 0);
+			if (len <= 0) {
+				return false;
+			}
+			std::vector<char> pA(len);
+			WideCharToMultiByte(CP_UTF8, 0, msg.data(), -1, pA.data(), len, 0, 0);
+			str = pA.data();
+#else
+			std::vector<wchar_t> msg(256);
+			for (;;) {
+				va_list attempt;
+				va_copy(attempt, args);
+				auto ss = vswprintf(msg.data(), msg.size(), format, attempt);
+				va_end(attempt);
+				if (ss >= 0) {
+					break;
+				}
+				// too small, or a bad format
+				if (msg.size() >= MaxFormatLength) {
+					return false;
+				}
+				msg.resize(msg.size() * 2);
+			}
+
+			str.clear();
+			for (auto p = msg.data(); *p != 0; ++p) {
+				AppendUTF8(str, (uint32_t)*p);
+			}
+#endif
+			return true;
+		}
+
+		// converts a string stored with the ASCII or UTF-8 character set to a wide string
+		std::wstring ToWide(const char* pA, bool utf8)
+		{
+#ifdef _WIN32
+			auto codepage = utf8 ? CP_UTF8 : CP_ACP;
+			auto len = MultiByteToWideChar(codepage, 0, pA, -1, nullptr, 0);
+			if (len <= 0) {
+				return std::wstring();
+			}
+			std::vector<wchar_t> wstr(len);
+			MultiByteToWideChar(codepage, 0, pA, -1, wstr.data(), len);
+			return wstr.data();
+#else
+			// ASCII is a subset of UTF-8; malformed sequences become U+FFFD
+			(void)utf8;
+			std::wstring wstr;
+			auto p = (const unsigned char*)pA;
+			while (*p != 0) {
+				uint32_t c = *p++;
+				int follow = c >= 0xF5 ? 0 : c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : c >= 0xC2 ? 1 : 0;
+				if (c >= 0x80 && follow == 0) {
+					wstr += (wchar_t)0xFFFD;
+					continue;
+				}
+				if (follow > 0) {
+					c &= 0x3F >> follow;
+				}
+				for (; follow > 0 && (*p & 0xC0) == 0x80; --follow) {
+					c = (c << 6) | (*p++ & 0x3F);
+				}
+				wstr += (wchar_t)(follow == 0 ? c : 0xFFFD);
+			}
+			return wstr;
+#endif
+		}
+	}
+#pragma warning(pop)
+
 	bool AttributedObject::AddAttributeFormat(const char* name, const char* format, ...)
 	{
 		va_list args;
 		va_start(args, format);
-		auto ss = vsnprintf(nullptr, 0, format, args);
-		auto msg = new char[ss + 10];
-		vsprintf_s(msg, ss + 10, format, args);
+		auto rv = AddAttributeFormatV(name, format, args);
 		va_end(args);
-
-		StringDatatype dtype(strlen(msg));
-		Dataspace dspace;
-		auto attr = CreateAttribute(name, dtype, dspace);
-		auto rv = attr.Write(dtype, msg);
-		delete[] msg;
 		return rv;
 	}
 
-#pragma warning(push)
-#pragma warning(disable:4996)
 	bool AttributedObject::AddAttributeFormat(const char* name, const wchar_t* format, ...)
 	{
 		va_list args;
 		va_start(args, format);
-		auto ss = _vsnwprintf(nullptr, 0, format, args);
-		auto msg = new wchar_t[ss + 10];
-		vswprintf_s(msg, ss + 10, format, args);
+		auto rv = AddAttributeFormatV(name, format, args);
 		va_end(args);
-
-		auto len = WideCharToMultiByte(CP_UTF8, 0, msg, -1, NULL, 0, 0, 0);
-		char* pA = new char[len + 10];
-		WideCharToMultiByte(CP_UTF8, 0, msg, -1, pA, len + 10, 0, 0);
-
-
-		StringDatatype dtype(StringPDT::C_S1);
-		dtype.SetCharSet(StringDatatype::CharSet::UTF8);
-		dtype.SetSize(strlen(pA));
-		auto attr = CreateAttribute(name, dtype, Dataspace());
-
-		auto rv = attr.Write(dtype, pA);
-		delete[] pA;
-		delete[] msg;
 		return rv;
 	}
-#pragma warning(pop)
 
 	bool AttributedObject::AddAttributeFormatV(const char* name, const char* format, va_list args)
 	{
-		auto ss = vsnprintf(nullptr, 0, format, args);
+		// args is used twice, and may not be reused once consumed outside Windows
+		va_list measure;
+		va_copy(measure, args);
+		auto ss = vsnprintf(nullptr, 0, format, measure);
+		va_end(measure);
+		if (ss < 0) {
+			return false;
+		}
 		auto msg = new char[ss + 10];
-		vsprintf_s(msg, ss + 10, format, args);
+		vsnprintf(msg, ss + 10, format, args);
 
 		StringDatatype dtype(strlen(msg));
 		Dataspace dspace;
@@ -311,28 +539,22 @@ namespace HDF5 {
 
 	bool AttributedObject::AddAttributeFormatV(const char* name, const wchar_t* format, va_list args)
 	{
-		auto ss = _vsnwprintf(nullptr, 0, format, args);
-		auto msg = new wchar_t[(size_t)ss + 10];
-		vswprintf_s(msg, (size_t)ss + 10, format, args);
-
-		auto len = WideCharToMultiByte(CP_UTF8, 0, msg, -1, NULL, 0, 0, 0);
-		char* pA = new char[(size_t)len + 10];
-		WideCharToMultiByte(CP_UTF8, 0, msg, -1, pA, len + 10, 0, 0);
-
+		std::string str;
+		if (!FormatUTF8(format, args, str)) {
+			return false;
+		}
 
 		StringDatatype dtype(StringPDT::C_S1);
 		dtype.SetCharSet(StringDatatype::CharSet::UTF8);
-		dtype.SetSize(strlen(pA));
+		dtype.SetSize(str.size());
 		auto attr = CreateAttribute(name, dtype, Dataspace());
 
-		auto rv = attr.Write(dtype, pA);
-		delete[] pA;
-		delete[] msg;
-		return rv;
+		return attr.Write(dtype, str.c_str());
 	}
 
 	bool AttributedObject::ReadAttribute(const char* name, std::string& val)
 	{
+		HDF5PP_PROBE_NAME(ReadAttribute, name);
 		if (!AttributeExists(name)) {
 			return false;
 		}
@@ -357,6 +579,7 @@ namespace HDF5 {
 		}
 
 		auto sz = dtype.GetSize();
+		HDF5PP_PROBE_BYTES(sz);
 		auto pA = new char[sz + 1];
 		auto rv = attr.Read(dtype, pA);
 		pA[sz] = 0;
@@ -370,6 +593,7 @@ namespace HDF5 {
 
 	bool AttributedObject::ReadAttribute(const char* name, std::wstring& val)
 	{
+		HDF5PP_PROBE_NAME(ReadAttribute, name);
 		if (!AttributeExists(name)) {
 			return false;
 		}
@@ -394,16 +618,12 @@ namespace HDF5 {
 		}
 
 		auto sz = dtype.GetSize();
+		HDF5PP_PROBE_BYTES(sz);
 		auto pA = new char[sz + 1];
 		auto rv = attr.Read(dtype, pA);
 		pA[sz] = 0;
 		if (rv) {
-			auto codepage = H5Tget_cset((hid_t)dtype) == H5T_CSET_ASCII ? CP_ACP : CP_UTF8;
-			auto len = MultiByteToWideChar(codepage, 0, pA, -1, nullptr, 0);
-			wchar_t* wstr = new wchar_t[len + 10];
-			MultiByteToWideChar(codepage, 0, pA, -1, wstr, len + 10);
-			val = wstr;
-			delete[] wstr;
+			val = ToWide(pA, H5Tget_cset((hid_t)dtype) != H5T_CSET_ASCII);
 		}
 		delete[] pA;
 		return rv;
@@ -411,6 +631,7 @@ namespace HDF5 {
 
 #define READATTR(x, y) bool AttributedObject::ReadAttribute(const char* name, x& val)\
 	{\
+		HDF5PP_PROBE_NAME(ReadAttribute, name);\
 		if (!AttributeExists(name)) {\
 			return false;\
 		}\
@@ -451,6 +672,7 @@ namespace HDF5 {
 			return false;\
 		}\
 \
+		HDF5PP_PROBE_BYTES(sz);\
 		return attr.Read(y, &val);\
 	}\
 
@@ -468,6 +690,7 @@ namespace HDF5 {
 
 #define READATTR2(x, y) bool AttributedObject::ReadAttribute(const char* name, std::vector<x>& vals)\
 	{\
+		HDF5PP_PROBE_NAME(ReadAttribute, name);\
 		if (!AttributeExists(name)) {\
 			return false;\
 		}\
@@ -498,6 +721,7 @@ namespace HDF5 {
 			return false;\
 		}\
 \
+		HDF5PP_PROBE_BYTES(vals.size() * sizeof(vals[0]));\
 		return attr.Read(y, vals.data());\
 	}\
 
@@ -5,6 +5,7 @@
 #pragma once
 
 #include "hdf5pp_location.h"
+#include "hdf5pp_dtypeof.h"
 
 namespace HDF5 {
 
@@ -23,6 +24,9 @@ namespace HDF5 {
 		// take ownership of identifier and will be responsible for closing it
 		virtual bool Attach(hid_t hid) override;
 
+		// release ownership of identifier, dropping the attributes cached for it
+		virtual hid_t Detach() override;
+
 		// Creates an attribute attached here
 		Attribute CreateAttribute(const char* attr_name, const Datatype& dtype, const Dataspace& dspace, const PropertyList& acpl = PropertyList(), const PropertyList& aapl = PropertyList());
 
@@ -91,8 +95,10 @@ namespace HDF5 {
 		bool AddAttribute(const char* name, uint64_t c);
 		bool AddAttribute(const char* name, float c);
 		bool AddAttribute(const char* name, double c);
+#ifndef HDF5PP_LONG_IS_INT64
 		bool AddAttribute(const char* name, long c);
 		bool AddAttribute(const char* name, unsigned long c);
+#endif
 		bool AddAttribute(const char* name, char c);
 
 		bool AddAttribute(const char* name, const std::vector<int8_t>& vals);
@@ -122,7 +128,17 @@ namespace HDF5 {
 		bool AddAttributeFormatV(const char* name, const char* format, va_list args);
 		bool AddAttributeFormatV(const char* name, const wchar_t* format, va_list args);
 
+		// Overwrites the data of an existing attribute in place, provided its stored Datatype
+		// equals mem_dtype and its Dataspace holds length elements (length == 0 means scalar)
+		// returns false if the attribute does not exist or is not compatible; failed is set on errors
+		// the opened attribute is cached, so repeated rewrites cost an H5Awrite and a datatype check; deleting or
+		// renaming attributes through any AttributedObject drops the cached ones, deleting them with the C API does not
+		// the cached attributes keep their file open, even with a weak close degree, until this object is destroyed,
+		// detached, assigned or attached to another identifier, or ClearAttributeCache is called
+		bool RewriteAttribute(const char* name, const Datatype& mem_dtype, const void* buf, hsize_t length, bool* failed = nullptr);
+
 		//// Rewrite attribute if it exits, add if not
+		//// data is overwritten in place when type and shape are unchanged; otherwise the attribute is recreated
 		template <class T> bool SetAttribute(const char* name, T val);
 		template <class T> bool SetAttribute(const char* name, const std::vector<T>& vals);
 		template <class T> bool SetAttribute(const char* name, const T* vals, hsize_t length);
@@ -151,16 +167,36 @@ namespace HDF5 {
 		bool ReadAttribute(const char* name, std::vector<uint64_t>& val);
 		bool ReadAttribute(const char* name, std::vector<float>& val);
 		bool ReadAttribute(const char* name, std::vector<double>& val);
+
+		// Closes and forgets all attributes cached by RewriteAttribute, letting a weakly closed file close
+		void ClearAttributeCache();
+
 	protected:
 		explicit AttributedObject(hid_t hid);
 		friend class Location;
+
+	private:
+		struct CachedAttribute {
+			hid_t attr;			// opened attribute, owned by the cache
+			hid_t dtype;		// its stored Datatype, owned by the cache
+			hsize_t length;		// number of elements; 0 for scalar
+			uint64_t generation;	// of attribute deletions and renames when it was verified
+
+			void Close();
+		};
+		std::map<std::string, CachedAttribute> m_attrCache;
+		hid_t m_attrCacheOwner{ InvalidHandle };	// m_hID the cache was built for
 	};
 
 
 	template <class T> bool AttributedObject::SetAttribute(const char* name, T val)
 	{
 		bool failed{ false };
-		if (AttributeExists(name, &failed)) {
+		if (RewriteAttribute(name, DatatypeOf(val), &val, 0, &failed)) {
+			return true;
+		}
+
+		if (!failed && AttributeExists(name, &failed)) {
 			failed = !DeleteAttribute(name);
 		}
 
@@ -174,7 +210,11 @@ namespace HDF5 {
 	template <class T> bool AttributedObject::SetAttribute(const char* name, const std::vector<T>& vals)
 	{
 		bool failed{ false };
-		if (AttributeExists(name, &failed)) {
+		if (!vals.empty() && RewriteAttribute(name, DatatypeOf(T{}), vals.data(), vals.size(), &failed)) {
+			return true;
+		}
+
+		if (!failed && AttributeExists(name, &failed)) {
 			failed = !DeleteAttribute(name);
 		}
 
@@ -188,7 +228,11 @@ namespace HDF5 {
 	template <class T> bool AttributedObject::SetAttribute(const char* name, const T* vals, hsize_t length)
 	{
 		bool failed{ false };
-		if (AttributeExists(name, &failed)) {
+		if (length > 0 && RewriteAttribute(name, DatatypeOf(T{}), vals, length, &failed)) {
+			return true;
+		}
+
+		if (!failed && AttributeExists(name, &failed)) {
 			failed = !DeleteAttribute(name);
 		}
 
@@ -0,0 +1,615 @@
+#include "pch.h"
+#include "hdf5pp_catalog.h"
+#include "hdf5pp_attrobj.h"
+#include "hdf5pp_attribute.h"
+#include "hdf5pp_dset.h"
+#include "hdf5pp_dspace.h"
+#include "hdf5pp_dtype.h"
+#include "hdf5pp_library.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace HDF5 {
+
+	namespace {
+
+		const char CatalogMagic[8] = { 'H', '5', 'P', 'P', 'C', 'A', 'T', '\0' };
+		const uint32_t CatalogVersion = 1;
+		const uint32_t CatalogByteOrderMark = 0x01020304;	// images are native endian
+
+		// image layout: header | entries (sorted by path) | blob
+		// all blob offsets are relative to the beginning of the blob; every record is 8-byte aligned
+		struct CatalogHeader {
+			char magic[8];
+			uint32_t version;
+			uint32_t byte_order;
+			uint64_t count;
+			uint64_t entries_offset;
+			uint64_t blob_offset;
+			uint64_t blob_size;
+		};
+
+		struct CatalogEntry {
+			uint64_t path_offset;
+			uint32_t path_len;
+			uint32_t type;
+			uint8_t token[H5O_MAX_TOKEN_SIZE];
+			uint64_t dtype_offset;
+			uint32_t dtype_len;
+			uint32_t rank;
+			uint64_t dims_offset;		// rank current dims followed by rank max dims
+			uint64_t chunk_offset;
+			uint32_t chunk_rank;
+			uint32_t attrs_count;
+			uint64_t attrs_offset;		// attrs_count CatalogAttribute records
+			uint64_t storage_size;
+		};
+
+		struct CatalogAttribute {
+			uint64_t name_offset;
+			uint32_t name_len;
+			uint32_t dtype_len;
+			uint64_t dtype_offset;
+			uint64_t value_offset;
+			uint64_t value_len;
+		};
+
+		static_assert(sizeof(CatalogHeader) % 8 == 0, "CatalogHeader must be 8-byte aligned");
+		static_assert(sizeof(CatalogEntry) % 8 == 0, "CatalogEntry must be 8-byte aligned");
+		static_assert(sizeof(CatalogAttribute) % 8 == 0, "CatalogAttribute must be 8-byte aligned");
+		static_assert(sizeof(H5O_token_t) == H5O_MAX_TOKEN_SIZE, "unexpected H5O_token_t size");
+
+		struct BuildAttribute {
+			std::string name;
+			std::vector<unsigned char> dtype;
+			std::vector<unsigned char> value;
+		};
+
+		struct BuildEntry {
+			std::string path;
+			H5O_type_t type{ H5O_TYPE_UNKNOWN };
+			H5O_token_t token;
+			std::vector<unsigned char> dtype;
+			std::vector<hsize_t> dims;
+			std::vector<hsize_t> maxdims;
+			std::vector<hsize_t> chunk;
+			hsize_t storage_size{ 0 };
+			std::vector<BuildAttribute> attrs;
+		};
+
+		struct BuildContext {
+			AttributedObject* root;
+			const std::vector<std::string>* attribute_names;
+			std::vector<BuildEntry> entries;
+		};
+
+		// appends 8-byte aligned records to the blob
+		uint64_t AppendBlob(std::vector<char>& blob, const void* data, size_t size)
+		{
+			blob.resize((blob.size() + 7) & ~(size_t)7);
+			auto offset = (uint64_t)blob.size();
+			if (size > 0) {
+				blob.insert(blob.end(), (const char*)data, (const char*)data + size);
+			}
+			return offset;
+		}
+
+		int ComparePath(const char* a, size_t alen, const char* b, size_t blen)
+		{
+			auto rv = memcmp(a, b, std::min(alen, blen));
+			if (rv != 0) {
+				return rv;
+			}
+			return alen < blen ? -1 : (alen > blen ? 1 : 0);
+		}
+
+		// strips the leading '/'; the root itself is "."
+		std::string NormalizePath(const char* path)
+		{
+			while (*path == '/') {
+				++path;
+			}
+			return *path == 0 ? std::string(".") : std::string(path);
+		}
+
+		bool RecordAttribute(AttributedObject& root, const char* obj_name, const std::string& attr_name, std::vector<BuildAttribute>& attrs)
+		{
+			bool failed{ false };
+			if (!root.AttributeExists(obj_name, attr_name.c_str(), &failed)) {
+				return !failed;
+			}
+
+			auto attr = root.OpenAttribute(obj_name, attr_name.c_str());
+			auto ftype = attr.GetDatatype();
+			auto dspace = attr.GetDataspace();
+			if (!attr.IsValid() || !ftype.IsValid() || !dspace.IsValid()) {
+				return false;
+			}
+			auto npoints = dspace.GetSimpleExtentElementsCount();
+			Datatype::ClassType cls;
+			if (npoints < 0 || !ftype.GetClass(cls)) {
+				return false;
+			}
+
+			BuildAttribute a;
+			a.name = attr_name;
+			if (H5Tis_variable_str((hid_t)ftype) > 0) {
+				// only scalar variable length strings; recorded as fixed length strings
+				if (npoints != 1) {
+					return true;
+				}
+				StringDatatype mtype;
+				mtype.SetCharSet((StringDatatype::CharSet)H5Tget_cset((hid_t)ftype));
+				char* str{ nullptr };
+				if (!attr.Read(mtype, &str)) {
+					return false;
+				}
+				if (str != nullptr) {
+					a.value.assign(str, str + strlen(str));
+					Library::FreeMemory(str);
+				}
+				StringDatatype stype(a.value.empty() ? 1 : a.value.size());
+				stype.SetCharSet((StringDatatype::CharSet)H5Tget_cset((hid_t)ftype));
+				a.value.resize(stype.GetSize(), 0);
+				if (!stype.Encode(a.dtype)) {
+					return false;
+				}
+			}
+			else {
+				switch (cls) {
+				case Datatype::ClassType::Integer:
+				case Datatype::ClassType::Float:
+				case Datatype::ClassType::String:
+				case Datatype::ClassType::Bitfield:
+				case Datatype::ClassType::Enumeration:
+				case Datatype::ClassType::Array:
+					break;
+				default:
+					return true; // not recorded
+				}
+				if (ftype.DetectClass(Datatype::ClassType::VariableLengthArray) || ftype.DetectClass(Datatype::ClassType::Reference)) {
+					return true; // not recorded
+				}
+				auto mtype = ftype.GetNativeType(Datatype::Direction::Ascend);
+				if (!mtype.IsValid()) {
+					return false;
+				}
+				a.value.resize(mtype.GetSize() * (size_t)npoints);
+				if (!attr.Read(mtype, a.value.data()) || !mtype.Encode(a.dtype)) {
+					return false;
+				}
+			}
+			attrs.push_back(std::move(a));
+			return true;
+		}
+
+		herr_t CatalogVisit(hid_t /*obj*/, const char* name, const H5O_info_t* info, void* op_data)
+		{
+			auto ctx = (BuildContext*)op_data;
+
+			// don't catalog the catalog
+			if (strcmp(name, Catalog::DefaultDatasetName) == 0) {
+				return 0;
+			}
+
+			BuildEntry e;
+			e.path = name;
+			e.type = info->type;
+			e.token = info->token;
+
+			if (info->type == H5O_TYPE_DATASET) {
+				auto dset = ctx->root->OpenDataset(name);
+				if (!dset.IsValid()) {
+					return -1;
+				}
+				auto dtype = dset.GetDatatype();
+				auto dspace = dset.GetDataspace();
+				if (!dtype.IsValid() || !dspace.IsValid() || !dtype.Encode(e.dtype)) {
+					return -1;
+				}
+				auto rank = dspace.GetSimpleExtentDimsCount();
+				if (rank < 0) {
+					return -1;
+				}
+				if (rank > 0) {
+					e.dims.resize(rank);
+					e.maxdims.resize(rank);
+					if (dspace.GetSimpleExtentDims(e.dims.data(), e.maxdims.data()) < 0) {
+						return -1;
+					}
+				}
+				auto dcpl = dset.GetCreationPropertyList();
+				DatasetCreationPropertyList::Layout layout;
+				if (dcpl.GetLayout(layout) && layout == DatasetCreationPropertyList::Layout::Chunked) {
+					if (!dcpl.GetChunk(e.chunk)) {
+						return -1;
+					}
+				}
+				e.storage_size = dset.GetStorageSize();
+			}
+			else if (info->type == H5O_TYPE_NAMED_DATATYPE) {
+				auto dtype = ctx->root->OpenDatatype(name);
+				if (!dtype.IsValid() || !dtype.Encode(e.dtype)) {
+					return -1;
+				}
+			}
+
+			for (auto& attr_name : *ctx->attribute_names) {
+				if (!RecordAttribute(*ctx->root, name, attr_name, e.attrs)) {
+					return -1;
+				}
+			}
+
+			ctx->entries.push_back(std::move(e));
+			return 0;
+		}
+
+		const CatalogHeader* HeaderOf(const char* data)
+		{
+			return (const CatalogHeader*)data;
+		}
+
+		const CatalogEntry* EntryOf(const char* data, size_t index)
+		{
+			return (const CatalogEntry*)(data + HeaderOf(data)->entries_offset) + index;
+		}
+
+		// returns a pointer into the blob, or nullptr if the range is out of bounds
+		const char* BlobOf(const char* data, uint64_t offset, uint64_t size)
+		{
+			auto h = HeaderOf(data);
+			if (offset > h->blob_size || size > h->blob_size - offset) {
+				return nullptr;
+			}
+			return data + h->blob_offset + offset;
+		}
+
+		bool ReadHsizeArray(const char* data, uint64_t offset, uint32_t count, std::vector<hsize_t>& v)
+		{
+			auto p = BlobOf(data, offset, (uint64_t)count * sizeof(uint64_t));
+			if (p == nullptr) {
+				return false;
+			}
+			v.resize(count);
+			for (uint32_t i = 0; i < count; ++i) {
+				uint64_t d;
+				memcpy(&d, p + i * sizeof(uint64_t), sizeof(d));
+				v[i] = (hsize_t)d;
+			}
+			return true;
+		}
+
+		bool PathOf(const char* data, const CatalogEntry* e, const char*& path)
+		{
+			path = BlobOf(data, e->path_offset, e->path_len);
+			return path != nullptr;
+		}
+	}
+
+	const char* const Catalog::DefaultDatasetName = ".catalog";
+
+	Catalog::Catalog(const Catalog& rhs) : m_buffer(rhs.m_buffer), m_data(rhs.m_data), m_size(rhs.m_size)
+	{
+		if (!m_buffer.empty()) {
+			m_data = m_buffer.data();
+		}
+	}
+
+	Catalog::~Catalog()
+	{
+
+	}
+
+	Catalog& Catalog::operator=(const Catalog& rhs)
+	{
+		if (this != &rhs) {
+			m_buffer = rhs.m_buffer;
+			m_data = m_buffer.empty() ? rhs.m_data : m_buffer.data();
+			m_size = rhs.m_size;
+		}
+		return *this;
+	}
+
+	bool Catalog::Build(AttributedObject& root, const std::vector<std::string>& attribute_names /*= std::vector<std::string>()*/)
+	{
+		BuildContext ctx;
+		ctx.root = &root;
+		ctx.attribute_names = &attribute_names;
+		if (!root.VisitObjects(Location::IndexType::ByName, Location::OrderType::Native, CatalogVisit, &ctx, H5O_INFO_BASIC)) {
+			return false;
+		}
+
+		std::sort(ctx.entries.begin(), ctx.entries.end(), [](const BuildEntry& a, const BuildEntry& b) { return a.path < b.path; });
+
+		std::vector<CatalogEntry> entries(ctx.entries.size());
+		std::vector<char> blob;
+		for (size_t i = 0; i < ctx.entries.size(); ++i) {
+			auto& src = ctx.entries[i];
+			auto& dst = entries[i];
+			memset(&dst, 0, sizeof(dst));
+
+			dst.path_offset = AppendBlob(blob, src.path.data(), src.path.size());
+			dst.path_len = (uint32_t)src.path.size();
+			dst.type = (uint32_t)src.type;
+			memcpy(dst.token, &src.token, sizeof(dst.token));
+			dst.dtype_offset = AppendBlob(blob, src.dtype.data(), src.dtype.size());
+			dst.dtype_len = (uint32_t)src.dtype.size();
+
+			std::vector<uint64_t> dims(src.dims.begin(), src.dims.end());
+			dims.insert(dims.end(), src.maxdims.begin(), src.maxdims.end());
+			dst.rank = (uint32_t)src.dims.size();
+			dst.dims_offset = AppendBlob(blob, dims.data(), dims.size() * sizeof(uint64_t));
+
+			std::vector<uint64_t> chunk(src.chunk.begin(), src.chunk.end());
+			dst.chunk_rank = (uint32_t)chunk.size();
+			dst.chunk_offset = AppendBlob(blob, chunk.data(), chunk.size() * sizeof(uint64_t));
+			dst.storage_size = src.storage_size;
+
+			std::vector<CatalogAttribute> attrs(src.attrs.size());
+			for (size_t j = 0; j < src.attrs.size(); ++j) {
+				auto& a = src.attrs[j];
+				memset(&attrs[j], 0, sizeof(CatalogAttribute));
+				attrs[j].name_offset = AppendBlob(blob, a.name.data(), a.name.size());
+				attrs[j].name_len = (uint32_t)a.name.size();
+				attrs[j].dtype_offset = AppendBlob(blob, a.dtype.data(), a.dtype.size());
+				attrs[j].dtype_len = (uint32_t)a.dtype.size();
+				attrs[j].value_offset = AppendBlob(blob, a.value.data(), a.value.size());
+				attrs[j].value_len = a.value.size();
+			}
+			dst.attrs_count = (uint32_t)attrs.size();
+			dst.attrs_offset = AppendBlob(blob, attrs.data(), attrs.size() * sizeof(CatalogAttribute));
+		}
+
+		CatalogHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, CatalogMagic, sizeof(header.magic));
+		header.version = CatalogVersion;
+		header.byte_order = CatalogByteOrderMark;
+		header.count = entries.size();
+		header.entries_offset = sizeof(CatalogHeader);
+		header.blob_offset = header.entries_offset + entries.size() * sizeof(CatalogEntry);
+		header.blob_size = blob.size();
+
+		m_buffer.resize((size_t)(header.blob_offset + header.blob_size));
+		memcpy(m_buffer.data(), &header, sizeof(header));
+		if (!entries.empty()) {
+			memcpy(m_buffer.data() + header.entries_offset, entries.data(), entries.size() * sizeof(CatalogEntry));
+		}
+		if (!blob.empty()) {
+			memcpy(m_buffer.data() + header.blob_offset, blob.data(), blob.size());
+		}
+		m_data = m_buffer.data();
+		m_size = m_buffer.size();
+		return true;
+	}
+
+	bool Catalog::Save(const char* filename) const
+	{
+		if (m_data == nullptr) {
+			return false;
+		}
+		std::ofstream os(filename, std::ios::binary | std::ios::trunc);
+		os.write(m_data, (std::streamsize)m_size);
+		return os.good();
+	}
+
+	bool Catalog::Load(const char* filename)
+	{
+		std::ifstream is(filename, std::ios::binary | std::ios::ate);
+		if (!is) {
+			return false;
+		}
+		auto size = (size_t)is.tellg();
+		is.seekg(0);
+		m_buffer.resize(size);
+		if (!is.read(m_buffer.data(), (std::streamsize)size)) {
+			m_buffer.clear();
+			return false;
+		}
+		m_data = m_buffer.data();
+		m_size = m_buffer.size();
+		return Validate();
+	}
+
+	bool Catalog::Save(Location& loc, const char* dataset_name /*= DefaultDatasetName*/) const
+	{
+		if (m_data == nullptr) {
+			return false;
+		}
+		if (loc.LinkExists(dataset_name) && !loc.DeleteLink(dataset_name)) {
+			return false;
+		}
+		return loc.AddDataset(dataset_name, (const uint8_t*)m_data, m_size);
+	}
+
+	bool Catalog::Load(Location& loc, const char* dataset_name /*= DefaultDatasetName*/)
+	{
+		auto dset = loc.OpenDataset(dataset_name);
+		if (!dset.IsValid()) {
+			return false;
+		}
+		auto dspace = dset.GetDataspace();
+		auto size = dspace.GetSimpleExtentElementsCount();
+		if (size <= 0) {
+			return false;
+		}
+		m_buffer.resize((size_t)size);
+		if (!dset.Read(IntegerPDT::Native_UINT8, dspace, dspace, m_buffer.data())) {
+			m_buffer.clear();
+			return false;
+		}
+		m_data = m_buffer.data();
+		m_size = m_buffer.size();
+		return Validate();
+	}
+
+	bool Catalog::Attach(const void* image, size_t size)
+	{
+		m_buffer.clear();
+		m_data = (const char*)image;
+		m_size = size;
+		return Validate();
+	}
+
+	bool Catalog::Validate()
+	{
+		auto ok = m_data != nullptr && m_size >= sizeof(CatalogHeader) && ((uintptr_t)m_data % 8) == 0;
+		if (ok) {
+			auto h = HeaderOf(m_data);
+			ok = memcmp(h->magic, CatalogMagic, sizeof(CatalogMagic)) == 0
+				&& h->version == CatalogVersion
+				&& h->byte_order == CatalogByteOrderMark
+				&& h->entries_offset >= sizeof(CatalogHeader)
+				&& h->count <= (m_size - h->entries_offset) / sizeof(CatalogEntry)
+				&& h->blob_offset >= h->entries_offset + h->count * sizeof(CatalogEntry)
+				&& h->blob_offset <= m_size
+				&& h->blob_size <= m_size - h->blob_offset;
+		}
+		if (!ok) {
+			m_buffer.clear();
+			m_data = nullptr;
+			m_size = 0;
+		}
+		return ok;
+	}
+
+	size_t Catalog::GetCount() const
+	{
+		return m_data == nullptr ? 0 : (size_t)HeaderOf(m_data)->count;
+	}
+
+	size_t Catalog::IndexOf(const char* path) const
+	{
+		auto key = NormalizePath(path);
+		size_t lo{ 0 }, hi{ GetCount() };
+		while (lo < hi) {
+			auto mid = lo + (hi - lo) / 2;
+			auto e = EntryOf(m_data, mid);
+			const char* p;
+			if (!PathOf(m_data, e, p)) {
+				return GetCount();
+			}
+			auto cmp = ComparePath(p, e->path_len, key.data(), key.size());
+			if (cmp == 0) {
+				return mid;
+			}
+			if (cmp < 0) {
+				lo = mid + 1;
+			}
+			else {
+				hi = mid;
+			}
+		}
+		return GetCount();
+	}
+
+	bool Catalog::GetItem(size_t index, Item& item) const
+	{
+		if (index >= GetCount()) {
+			return false;
+		}
+		auto e = EntryOf(m_data, index);
+		const char* path;
+		auto dtype = BlobOf(m_data, e->dtype_offset, e->dtype_len);
+		if (!PathOf(m_data, e, path) || dtype == nullptr) {
+			return false;
+		}
+		item.path.assign(path, e->path_len);
+		item.type = (H5O_type_t)e->type;
+		memcpy(&item.token, e->token, sizeof(item.token));
+		item.dtype.assign(dtype, dtype + e->dtype_len);
+		std::vector<hsize_t> dims;
+		if (!ReadHsizeArray(m_data, e->dims_offset, 2 * e->rank, dims) || !ReadHsizeArray(m_data, e->chunk_offset, e->chunk_rank, item.chunk)) {
+			return false;
+		}
+		item.dims.assign(dims.begin(), dims.begin() + e->rank);
+		item.maxdims.assign(dims.begin() + e->rank, dims.end());
+		item.storage_size = (hsize_t)e->storage_size;
+		return true;
+	}
+
+	bool Catalog::Find(const char* path, Item& item) const
+	{
+		return GetItem(IndexOf(path), item);
+	}
+
+	bool Catalog::List(const char* group_path, std::vector<std::string>& names) const
+	{
+		names.clear();
+		auto prefix = NormalizePath(group_path);
+		if (prefix == ".") {
+			prefix.clear();
+		}
+		else {
+			if (IndexOf(prefix.c_str()) == GetCount()) {
+				return false;
+			}
+			prefix += '/';
+		}
+
+		// members of a group are contiguous in path order: find the first one
+		size_t lo{ 0 }, hi{ GetCount() };
+		while (lo < hi) {
+			auto mid = lo + (hi - lo) / 2;
+			auto e = EntryOf(m_data, mid);
+			const char* p;
+			if (!PathOf(m_data, e, p)) {
+				return false;
+			}
+			if (ComparePath(p, e->path_len, prefix.data(), prefix.size()) < 0) {
+				lo = mid + 1;
+			}
+			else {
+				hi = mid;
+			}
+		}
+
+		for (auto i = lo; i < GetCount(); ++i) {
+			auto e = EntryOf(m_data, i);
+			const char* p;
+			if (!PathOf(m_data, e, p)) {
+				return false;
+			}
+			if (e->path_len < prefix.size() || memcmp(p, prefix.data(), prefix.size()) != 0) {
+				break;
+			}
+			std::string rest(p + prefix.size(), e->path_len - prefix.size());
+			if (!rest.empty() && rest != "." && rest.find('/') == std::string::npos) {
+				names.push_back(rest);
+			}
+		}
+		return true;
+	}
+
+	bool Catalog::GetAttribute(const char* path, const char* attr_name, std::vector<unsigned char>& dtype, std::vector<unsigned char>& value) const
+	{
+		auto index = IndexOf(path);
+		if (index >= GetCount()) {
+			return false;
+		}
+		auto e = EntryOf(m_data, index);
+		auto attrs = (const CatalogAttribute*)BlobOf(m_data, e->attrs_offset, (uint64_t)e->attrs_count * sizeof(CatalogAttribute));
+		if (attrs == nullptr) {
+			return false;
+		}
+		auto len = strlen(attr_name);
+		for (uint32_t i = 0; i < e->attrs_count; ++i) {
+			auto name = BlobOf(m_data, attrs[i].name_offset, attrs[i].name_len);
+			if (name == nullptr || attrs[i].name_len != len || memcmp(name, attr_name, len) != 0) {
+				continue;
+			}
+			auto t = BlobOf(m_data, attrs[i].dtype_offset, attrs[i].dtype_len);
+			auto v = BlobOf(m_data, attrs[i].value_offset, attrs[i].value_len);
+			if (t == nullptr || v == nullptr) {
+				return false;
+			}
+			dtype.assign(t, t + attrs[i].dtype_len);
+			value.assign(v, v + attrs[i].value_len);
+			return true;
+		}
+		return false;
+	}
+
+}
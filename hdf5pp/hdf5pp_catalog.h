@@ -0,0 +1,89 @@
+// hdf5pp_catalog.h
+// HDF5::Catalog is a compact index of the objects found under a group (usually the root of a file)
+// it is built with a single recursive visit and records, per object: path, token, type and, for
+// datasets, the encoded datatype, extent, chunk shape, storage size and selected attributes
+// the image is position independent (offsets only), so it can be memory mapped as is; it can be
+// stored next to the file (sidecar) or inside it as a hidden dataset
+// once loaded, listing and shape queries are answered without opening any object headers
+//
+#pragma once
+
+#include "hdf5pp_api.h"
+
+namespace HDF5 {
+
+	class HDF5PP_API Location;
+	class HDF5PP_API AttributedObject;
+
+	class HDF5PP_API Catalog
+	{
+	public:
+		// name of the hidden dataset used by Save(Location&)/Load(Location&)
+		static const char* const DefaultDatasetName;
+
+		struct Item {
+			std::string path;					// path relative to the catalog root; the root itself is "."
+			H5O_type_t type{ H5O_TYPE_UNKNOWN };
+			H5O_token_t token;
+			std::vector<unsigned char> dtype;	// encoded Datatype (datasets and committed datatypes)
+			std::vector<hsize_t> dims;			// current extent (datasets)
+			std::vector<hsize_t> maxdims;		// maximum extent (datasets)
+			std::vector<hsize_t> chunk;			// chunk shape; empty if not chunked
+			hsize_t storage_size{ 0 };			// allocated storage (datasets)
+		};
+
+		Catalog() = default;
+		Catalog(const Catalog& rhs);
+		virtual ~Catalog();
+		Catalog& operator=(const Catalog& rhs);
+
+		// Builds the catalog with a single recursive visit starting at root
+		// the values of the named attributes are recorded for every object that has them
+		// (numeric, enumeration, array and string attributes; others are skipped)
+		bool Build(AttributedObject& root, const std::vector<std::string>& attribute_names = std::vector<std::string>());
+
+		// Writes the catalog to / reads it from a sidecar file
+		bool Save(const char* filename) const;
+		bool Load(const char* filename);
+
+		// Writes the catalog to / reads it from a hidden uint8 dataset
+		// loading costs a single dataset open and read
+		bool Save(Location& loc, const char* dataset_name = DefaultDatasetName) const;
+		bool Load(Location& loc, const char* dataset_name = DefaultDatasetName);
+
+		// Uses an externally owned image (e.g. a memory mapped sidecar file) without copying it
+		// the memory must remain valid for as long as the Catalog uses it
+		bool Attach(const void* image, size_t size);
+
+		// Returns the serialized image
+		const void* GetImage() const { return m_data; }
+		size_t GetImageSize() const { return m_size; }
+
+		// Returns the number of objects in the catalog
+		size_t GetCount() const;
+
+		// Retrieves the n-th object; objects are sorted by path
+		bool GetItem(size_t index, Item& item) const;
+
+		// Retrieves the object with the given path (binary search)
+		bool Find(const char* path, Item& item) const;
+
+		// Retrieves the names of the direct members of a group ("" or "/" for the root)
+		bool List(const char* group_path, std::vector<std::string>& names) const;
+
+		// Retrieves a recorded attribute value and its encoded (native) Datatype
+		bool GetAttribute(const char* path, const char* attr_name, std::vector<unsigned char>& dtype, std::vector<unsigned char>& value) const;
+
+	protected:
+		// checks the image header and table bounds
+		bool Validate();
+
+		// returns index of the object with the given path, or GetCount() if not found
+		size_t IndexOf(const char* path) const;
+
+		std::vector<char> m_buffer;		// owned image, empty if attached to external memory
+		const char* m_data{ nullptr };
+		size_t m_size{ 0 };
+	};
+
+}
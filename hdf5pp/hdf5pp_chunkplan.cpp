@@ -0,0 +1,247 @@
+#include "pch.h"
+#include "hdf5pp_chunkplan.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace HDF5 {
+
+	namespace {
+
+		// chunks are limited to 4 GiB
+		const hsize_t MaxChunkBytes = 0xffffffffULL;
+
+		const char* GetPatternName(ChunkPlanner::Pattern pattern)
+		{
+			switch (pattern) {
+			case ChunkPlanner::Pattern::Rows: return "rows";
+			case ChunkPlanner::Pattern::Columns: return "columns";
+			case ChunkPlanner::Pattern::Tile: return "tile";
+			case ChunkPlanner::Pattern::Append: return "append";
+			}
+			return "?";
+		}
+
+		hsize_t GCD(hsize_t a, hsize_t b)
+		{
+			while (b != 0) {
+				auto t = a % b;
+				a = b;
+				b = t;
+			}
+			return a;
+		}
+
+		std::string FormatDims(const std::vector<hsize_t>& dims)
+		{
+			std::string s;
+			for (auto d : dims) {
+				if (!s.empty()) {
+					s += 'x';
+				}
+				s += std::to_string((unsigned long long)d);
+			}
+			return s;
+		}
+	}
+
+	ChunkPlanner::ChunkPlanner(const std::vector<hsize_t>& dims, size_t elem_size, size_t chunk_bytes /*= 1024 * 1024*/, const std::vector<hsize_t>& max_dims /*= std::vector<hsize_t>()*/)
+		: m_dims(dims)
+		, m_maxDims(max_dims.size() == dims.size() ? max_dims : dims)
+		, m_elemSize(std::max<size_t>(elem_size, 1))
+		, m_chunkBytes(chunk_bytes)
+	{
+		for (auto& d : m_dims) {
+			d = std::max<hsize_t>(d, 1);
+		}
+	}
+
+	bool ChunkPlanner::AddRowScan(double weight /*= 1*/, hsize_t rows /*= 1*/)
+	{
+		if (m_dims.empty() || !(weight > 0) || rows < 1 || rows > m_dims.front()) {
+			return false;
+		}
+		Access access{ Pattern::Rows, m_dims, weight };
+		access.shape.front() = rows;
+		m_accesses.push_back(access);
+		return true;
+	}
+
+	bool ChunkPlanner::AddColumnScan(double weight /*= 1*/, hsize_t columns /*= 1*/)
+	{
+		if (m_dims.empty() || !(weight > 0) || columns < 1 || columns > m_dims.back()) {
+			return false;
+		}
+		Access access{ Pattern::Columns, m_dims, weight };
+		access.shape.back() = columns;
+		m_accesses.push_back(access);
+		return true;
+	}
+
+	bool ChunkPlanner::AddTile(const std::vector<hsize_t>& shape, double weight /*= 1*/)
+	{
+		if (m_dims.empty() || !(weight > 0) || shape.size() != m_dims.size()) {
+			return false;
+		}
+		for (size_t d = 0; d < shape.size(); ++d) {
+			if (shape[d] < 1 || shape[d] > m_dims[d]) {
+				return false;
+			}
+		}
+		m_accesses.push_back(Access{ Pattern::Tile, shape, weight });
+		return true;
+	}
+
+	bool ChunkPlanner::AddAppend(double weight /*= 1*/, hsize_t rows /*= 1*/)
+	{
+		// appended rows go past the current extent, so only the first dimension's maximum limits them
+		if (m_dims.empty() || !(weight > 0) || rows < 1 || (m_maxDims.front() != H5S_UNLIMITED && rows > m_maxDims.front())) {
+			return false;
+		}
+		Access access{ Pattern::Append, m_dims, weight };
+		access.shape.front() = rows;
+		m_accesses.push_back(access);
+		return true;
+	}
+
+	double ChunkPlanner::ChunksPerAccess(const Access& access, const std::vector<hsize_t>& chunk) const
+	{
+		if (chunk.size() != m_dims.size() || access.shape.size() != m_dims.size()) {
+			return 0;
+		}
+		double chunks{ 1 };
+		for (size_t d = 0; d < m_dims.size(); ++d) {
+			double n = (double)m_dims[d];
+			double q = (double)access.shape[d];
+			double c = (double)std::max<hsize_t>(chunk[d], 1);
+			double spanned;
+			if (access.pattern == Pattern::Append && d == 0) {
+				// batches start at multiples of q, i.e. at multiples of gcd(q, c) within a chunk
+				auto g = (double)GCD(access.shape[d], std::max<hsize_t>(chunk[d], 1));
+				spanned = 1 + (q - g) / c;
+			}
+			else if (q >= n) {
+				spanned = std::ceil(n / c);
+			}
+			else {
+				// q elements starting anywhere span 1 + (q - 1) / c chunks on average
+				spanned = std::min(std::ceil(n / c), 1 + (q - 1) / c);
+			}
+			chunks *= spanned;
+		}
+		return chunks;
+	}
+
+	double ChunkPlanner::ExpectedChunks(const std::vector<hsize_t>& chunk) const
+	{
+		double total{ 0 };
+		double weights{ 0 };
+		for (auto& access : m_accesses) {
+			total += access.weight * ChunksPerAccess(access, chunk);
+			weights += access.weight;
+		}
+		return weights > 0 ? total / weights : 0;
+	}
+
+	std::vector<hsize_t> ChunkPlanner::Candidates(size_t d, hsize_t max_elems) const
+	{
+		auto limit = m_maxDims[d] == H5S_UNLIMITED ? max_elems : std::max<hsize_t>(std::min(m_maxDims[d], max_elems), 1);
+		std::vector<hsize_t> candidates;
+		for (hsize_t c = 1; c <= limit; c *= 2) {
+			candidates.push_back(c);
+		}
+		candidates.push_back(limit);
+		if (m_dims[d] <= limit) {
+			candidates.push_back(m_dims[d]);
+		}
+		for (auto& access : m_accesses) {
+			if (access.shape[d] <= limit) {
+				candidates.push_back(access.shape[d]);
+			}
+		}
+		std::sort(candidates.begin(), candidates.end());
+		candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+		return candidates;
+	}
+
+	void ChunkPlanner::Search(size_t d, hsize_t budget, std::vector<hsize_t>& chunk, std::vector<hsize_t>& best, double& best_cost, hsize_t& best_elems) const
+	{
+		if (d == m_dims.size()) {
+			hsize_t elems{ 1 };
+			for (auto c : chunk) {
+				elems *= c;
+			}
+			// fewer chunks first, then chunks closer to the target size
+			auto cost = ExpectedChunks(chunk);
+			auto tolerance = 1e-9 * std::max(cost, best_cost);
+			if (best.empty() || cost < best_cost - tolerance || (cost <= best_cost + tolerance && elems > best_elems)) {
+				best = chunk;
+				best_cost = cost;
+				best_elems = elems;
+			}
+			return;
+		}
+		for (auto c : Candidates(d, budget)) {
+			chunk[d] = c;
+			Search(d + 1, budget / c, chunk, best, best_cost, best_elems);
+		}
+	}
+
+	std::vector<hsize_t> ChunkPlanner::Plan() const
+	{
+		if (m_dims.empty()) {
+			return std::vector<hsize_t>();
+		}
+		if (m_accesses.empty()) {
+			ChunkPlanner planner(*this);
+			planner.AddRowScan();
+			return planner.Plan();
+		}
+		auto max_elems = std::max<hsize_t>(1, std::min<hsize_t>(m_chunkBytes, MaxChunkBytes) / m_elemSize);
+		std::vector<hsize_t> chunk(m_dims.size(), 1);
+		std::vector<hsize_t> best;
+		double best_cost{ 0 };
+		hsize_t best_elems{ 0 };
+		Search(0, max_elems, chunk, best, best_cost, best_elems);
+		return best;
+	}
+
+	std::vector<ChunkPlanner::Prediction> ChunkPlanner::Simulate(const std::vector<hsize_t>& chunk) const
+	{
+		std::vector<Prediction> predictions;
+		hsize_t chunk_elems{ 1 };
+		for (auto c : chunk) {
+			chunk_elems *= c;
+		}
+		for (auto& access : m_accesses) {
+			Prediction p;
+			p.access = access;
+			p.chunks = ChunksPerAccess(access, chunk);
+			p.bytes_read = p.chunks * (double)chunk_elems * (double)m_elemSize;
+			p.bytes_used = (double)m_elemSize;
+			for (auto s : access.shape) {
+				p.bytes_used *= (double)s;
+			}
+			predictions.push_back(p);
+		}
+		return predictions;
+	}
+
+	bool ChunkPlanner::Print(const std::vector<hsize_t>& chunk, FILE* fp /*= nullptr*/) const
+	{
+		if (fp == nullptr) {
+			fp = stdout;
+		}
+		if (chunk.size() != m_dims.size()) {
+			return false;
+		}
+		fprintf(fp, "dataset %s x %zu bytes, chunk %s\n", FormatDims(m_dims).c_str(), m_elemSize, FormatDims(chunk).c_str());
+		for (auto& p : Simulate(chunk)) {
+			fprintf(fp, "  %-8s %-20s weight %6.2f  chunks/access %10.2f  read %12.0f bytes  used %12.0f bytes  (x%.1f)\n",
+				GetPatternName(p.access.pattern), FormatDims(p.access.shape).c_str(), p.access.weight,
+				p.chunks, p.bytes_read, p.bytes_used, p.bytes_used > 0 ? p.bytes_read / p.bytes_used : 0.0);
+		}
+		fprintf(fp, "  weighted mean chunks/access %.2f\n", ExpectedChunks(chunk));
+		return true;
+	}
+}
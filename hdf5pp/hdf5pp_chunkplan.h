@@ -0,0 +1,76 @@
+// hdf5pp_chunkplan.h
+// HDF5::ChunkPlanner chooses chunk dims for a dataset from the ways it will be accessed: row scans, column
+// scans, tiles and appends, each with a relative weight
+// the plan is the shape of at most chunk_bytes that minimizes the weighted mean number of chunks an access
+// touches; the model counts chunks, not bytes, and ignores the chunk cache
+// rows run along the first dimension and columns along the last one, so in 2D a row is dims[1] elements
+// DatasetCreationPropertyList::SetChunk(planner) sets the planned chunk dims
+//
+#pragma once
+
+#include "hdf5pp_api.h"
+
+#include <cstdio>
+
+namespace HDF5 {
+
+	class HDF5PP_API ChunkPlanner
+	{
+	public:
+		enum class Pattern {
+			Rows,		// count consecutive indices of the first dimension, whole in the other ones, anywhere
+			Columns,	// count consecutive indices of the last dimension, whole in the other ones, anywhere
+			Tile,		// a block of the given shape, anywhere
+			Append		// count indices of the first dimension, whole in the other ones, added one batch after another
+		};
+
+		struct Access {
+			Pattern pattern;
+			std::vector<hsize_t> shape;		// extent of one access in every dimension
+			double weight;
+		};
+
+		struct Prediction {
+			Access access;
+			double chunks{ 0 };				// mean number of chunks one access touches
+			double bytes_read{ 0 };			// bytes of these chunks
+			double bytes_used{ 0 };			// bytes of the access itself
+		};
+
+		// dims is the expected extent of the dataset; a dimension that is H5S_UNLIMITED in max_dims (empty for
+		// fixed size) may get chunks larger than its extent
+		ChunkPlanner(const std::vector<hsize_t>& dims, size_t elem_size, size_t chunk_bytes = 1024 * 1024, const std::vector<hsize_t>& max_dims = std::vector<hsize_t>());
+
+		// Declare an access pattern; false if count or shape does not fit the dataset, or weight is not positive
+		bool AddRowScan(double weight = 1, hsize_t rows = 1);
+		bool AddColumnScan(double weight = 1, hsize_t columns = 1);
+		bool AddTile(const std::vector<hsize_t>& shape, double weight = 1);
+		bool AddAppend(double weight = 1, hsize_t rows = 1);
+
+		const std::vector<Access>& GetAccesses() const { return m_accesses; }
+
+		// Returns the planned chunk dims; without declared patterns, as for a single row scan
+		std::vector<hsize_t> Plan() const;
+
+		// Returns the mean number of chunks of shape chunk one access of the pattern touches, and the mean over
+		// all declared patterns, weighted
+		double ChunksPerAccess(const Access& access, const std::vector<hsize_t>& chunk) const;
+		double ExpectedChunks(const std::vector<hsize_t>& chunk) const;
+
+		// Simulator: predicts the chunks and bytes read per access of every declared pattern with chunks of shape
+		// chunk, and prints the predictions (to stdout when fp is nullptr)
+		std::vector<Prediction> Simulate(const std::vector<hsize_t>& chunk) const;
+		bool Print(const std::vector<hsize_t>& chunk, FILE* fp = nullptr) const;
+
+	protected:
+		// the chunk extents worth trying in dimension d
+		std::vector<hsize_t> Candidates(size_t d, hsize_t max_elems) const;
+		void Search(size_t d, hsize_t budget, std::vector<hsize_t>& chunk, std::vector<hsize_t>& best, double& best_cost, hsize_t& best_elems) const;
+
+		std::vector<hsize_t> m_dims;
+		std::vector<hsize_t> m_maxDims;
+		size_t m_elemSize;
+		size_t m_chunkBytes;
+		std::vector<Access> m_accesses;
+	};
+}
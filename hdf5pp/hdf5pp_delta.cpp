@@ -0,0 +1,454 @@
+#include "pch.h"
+#include "hdf5pp_delta.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+// SSE2 is part of x86-64, so its unpacking needs no check of the processor
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__)
+#define HDF5PP_DELTA_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace HDF5 {
+
+	namespace {
+
+		// the filter parameters are the order, the packing, the element size and the chunk size in bytes (0 if
+		// unknown or too large), the last one not written by earlier versions
+		const size_t ParameterCount = 3;
+		const size_t ChunkBytesParameter = 3;
+
+		// a chunk is the number of elements (64 bits, little endian), then what Pack writes
+		const size_t HeaderSize = 8;
+
+		const size_t Lanes = 4;
+
+		template <typename T>
+		struct Width {
+			static const size_t Bits = sizeof(T) * 8;
+			static const size_t MaxVarint = (Bits + 6) / 7;
+			static const size_t BlockValues = Lanes * Bits;		// a lane of a block packs Bits values in b words
+		};
+
+		void PutLE64(uint8_t* p, uint64_t v)
+		{
+			for (size_t i = 0; i < 8; ++i) {
+				p[i] = (uint8_t)(v >> (8 * i));
+			}
+		}
+
+		uint64_t GetLE64(const uint8_t* p)
+		{
+			uint64_t v{ 0 };
+			for (size_t i = 0; i < 8; ++i) {
+				v |= (uint64_t)p[i] << (8 * i);
+			}
+			return v;
+		}
+
+		bool IsValid(DeltaFilter::Order order, DeltaFilter::Packing packing)
+		{
+			return (order == DeltaFilter::Order::Delta || order == DeltaFilter::Order::DeltaOfDelta) &&
+				(packing == DeltaFilter::Packing::Varint || packing == DeltaFilter::Packing::FrameOfReference);
+		}
+
+		template <typename T>
+		T ZigZag(T d)
+		{
+			typedef typename std::make_signed<T>::type S;
+			return (T)((T)(d << 1) ^ (T)((S)d >> (Width<T>::Bits - 1)));
+		}
+
+		template <typename T>
+		T UnZigZag(T z)
+		{
+			return (T)((z >> 1) ^ (T)(0 - (z & 1)));
+		}
+
+		template <typename T>
+		size_t MaxPackedSize(size_t count, DeltaFilter::Packing packing)
+		{
+			if (packing == DeltaFilter::Packing::Varint) {
+				return count * Width<T>::MaxVarint;
+			}
+			auto blocks = (count + Width<T>::BlockValues - 1) / Width<T>::BlockValues;
+			return blocks * (1 + Width<T>::MaxVarint + Width<T>::BlockValues * sizeof(T));
+		}
+
+		template <typename T>
+		uint8_t* PutVarint(uint8_t* p, T z)
+		{
+			while (z >= 0x80) {
+				*p++ = (uint8_t)(z | 0x80);
+				z = (T)(z >> 7);
+			}
+			*p++ = (uint8_t)z;
+			return p;
+		}
+
+		template <typename T>
+		const uint8_t* GetVarint(const uint8_t* p, const uint8_t* end, T& z)
+		{
+			z = 0;
+			for (size_t shift = 0; p < end && shift < Width<T>::Bits; shift += 7) {
+				auto b = *p++;
+				z = (T)(z | ((T)(b & 0x7f) << shift));
+				if ((b & 0x80) == 0) {
+					return p;
+				}
+			}
+			return nullptr;
+		}
+
+		// the zig-zag differences of count elements, then as many of the first as make whole blocks
+		template <typename T>
+		void Differences(const uint8_t* in, size_t count, DeltaFilter::Order order, size_t padded, std::vector<T>& z)
+		{
+			z.resize(padded);
+			T prev{ 0 };
+			T prev_d{ 0 };
+			for (size_t i = 0; i < count; ++i) {
+				T x;
+				memcpy(&x, in + i * sizeof(T), sizeof(T));
+				T d = (T)(x - prev);
+				prev = x;
+				if (order == DeltaFilter::Order::DeltaOfDelta) {
+					T dd = (T)(d - prev_d);
+					prev_d = d;
+					d = dd;
+				}
+				z[i] = ZigZag(d);
+			}
+		}
+
+		// undoes Differences, storing the elements
+		template <typename T>
+		void Sums(const T* z, size_t count, DeltaFilter::Order order, uint8_t* out)
+		{
+			T prev{ 0 };
+			T prev_d{ 0 };
+			for (size_t i = 0; i < count; ++i) {
+				T d = UnZigZag(z[i]);
+				if (order == DeltaFilter::Order::DeltaOfDelta) {
+					d = (T)(prev_d + d);
+					prev_d = d;
+				}
+				prev = (T)(prev + d);
+				memcpy(out + i * sizeof(T), &prev, sizeof(T));
+			}
+		}
+
+		// a block is its width b (1 byte), its smallest value (varint), then Lanes x b words: value j * Lanes + l
+		// takes b bits from bit j * b of lane l, whose word k is word k * Lanes + l
+		template <typename T>
+		uint8_t* PackBlock(const T* z, uint8_t* p)
+		{
+			const size_t bits = Width<T>::Bits;
+			auto lo = *std::min_element(z, z + Width<T>::BlockValues);
+			auto hi = *std::max_element(z, z + Width<T>::BlockValues);
+			size_t b{ 0 };
+			while (b < bits && (T)(hi - lo) >> b != 0) {
+				++b;
+			}
+			*p++ = (uint8_t)b;
+			p = PutVarint(p, lo);
+			if (b == 0) {
+				return p;
+			}
+			T words[Lanes * bits] = {};
+			for (size_t j = 0; j < bits; ++j) {
+				auto k = j * b / bits;
+				auto shift = j * b % bits;
+				for (size_t l = 0; l < Lanes; ++l) {
+					T v = (T)(z[j * Lanes + l] - lo);
+					words[k * Lanes + l] |= (T)(v << shift);
+					if (shift + b > bits) {
+						words[(k + 1) * Lanes + l] |= (T)(v >> (bits - shift));
+					}
+				}
+			}
+			memcpy(p, words, Lanes * b * sizeof(T));
+			return p + Lanes * b * sizeof(T);
+		}
+
+		// the value of each lane in row j: w holds the lanes of the word the row starts in, then those of the next
+		// one, which only the rows that straddle two words (spill) read
+		template <typename T>
+		void UnpackRow(const T* w, T* v, size_t shift, bool spill, T mask, T lo)
+		{
+			const size_t bits = Width<T>::Bits;
+			if (spill) {
+				for (size_t l = 0; l < Lanes; ++l) {
+					v[l] = (T)((T)(((T)(w[l] >> shift) | (T)(w[l + Lanes] << (bits - shift))) & mask) + lo);
+				}
+			}
+			else {
+				for (size_t l = 0; l < Lanes; ++l) {
+					v[l] = (T)((T)((T)(w[l] >> shift) & mask) + lo);
+				}
+			}
+		}
+
+#ifdef HDF5PP_DELTA_SSE2
+		// the 4 lanes in one register
+		template <>
+		void UnpackRow<uint32_t>(const uint32_t* w, uint32_t* v, size_t shift, bool spill, uint32_t mask, uint32_t lo)
+		{
+			__m128i x = _mm_srl_epi32(_mm_loadu_si128((const __m128i*)w), _mm_cvtsi32_si128((int)shift));
+			if (spill) {
+				x = _mm_or_si128(x, _mm_sll_epi32(_mm_loadu_si128((const __m128i*)(w + Lanes)), _mm_cvtsi32_si128((int)(32 - shift))));
+			}
+			x = _mm_add_epi32(_mm_and_si128(x, _mm_set1_epi32((int)mask)), _mm_set1_epi32((int)lo));
+			_mm_storeu_si128((__m128i*)v, x);
+		}
+
+		// the 4 lanes in two registers
+		template <>
+		void UnpackRow<uint64_t>(const uint64_t* w, uint64_t* v, size_t shift, bool spill, uint64_t mask, uint64_t lo)
+		{
+			const __m128i right = _mm_cvtsi32_si128((int)shift);
+			const __m128i m = _mm_set1_epi64x((long long)mask);
+			const __m128i base = _mm_set1_epi64x((long long)lo);
+			__m128i x0 = _mm_srl_epi64(_mm_loadu_si128((const __m128i*)w), right);
+			__m128i x1 = _mm_srl_epi64(_mm_loadu_si128((const __m128i*)(w + 2)), right);
+			if (spill) {
+				const __m128i left = _mm_cvtsi32_si128((int)(64 - shift));
+				x0 = _mm_or_si128(x0, _mm_sll_epi64(_mm_loadu_si128((const __m128i*)(w + Lanes)), left));
+				x1 = _mm_or_si128(x1, _mm_sll_epi64(_mm_loadu_si128((const __m128i*)(w + Lanes + 2)), left));
+			}
+			_mm_storeu_si128((__m128i*)v, _mm_add_epi64(_mm_and_si128(x0, m), base));
+			_mm_storeu_si128((__m128i*)(v + 2), _mm_add_epi64(_mm_and_si128(x1, m), base));
+		}
+#endif
+
+		// the lanes decode together: the same shifts and masks on Lanes words side by side
+		template <typename T>
+		const uint8_t* UnpackBlock(const uint8_t* p, const uint8_t* end, T* z)
+		{
+			const size_t bits = Width<T>::Bits;
+			if (p >= end) {
+				return nullptr;
+			}
+			size_t b = *p++;
+			T lo;
+			p = GetVarint(p, end, lo);
+			if (p == nullptr || b > bits || (size_t)(end - p) < Lanes * b * sizeof(T)) {
+				return nullptr;
+			}
+			if (b == 0) {
+				std::fill(z, z + Width<T>::BlockValues, lo);
+				return p;
+			}
+			T words[Lanes * bits];
+			memcpy(words, p, Lanes * b * sizeof(T));
+			const T mask = b == bits ? std::numeric_limits<T>::max() : (T)(((T)1 << b) - 1);
+			for (size_t j = 0; j < bits; ++j) {
+				auto k = j * b / bits;
+				auto shift = j * b % bits;
+				UnpackRow(words + k * Lanes, z + j * Lanes, shift, shift + b > bits, mask, lo);
+			}
+			return p + Lanes * b * sizeof(T);
+		}
+
+		// writes at most MaxPackedSize bytes to out; returns the number written
+		template <typename T>
+		size_t PackValues(const uint8_t* in, size_t count, DeltaFilter::Order order, DeltaFilter::Packing packing, uint8_t* out)
+		{
+			const size_t block = Width<T>::BlockValues;
+			auto fr = packing == DeltaFilter::Packing::FrameOfReference;
+			auto padded = fr ? (count + block - 1) / block * block : count;
+			std::vector<T> z;
+			Differences(in, count, order, padded, z);
+			auto p = out;
+			if (!fr) {
+				for (auto v : z) {
+					p = PutVarint(p, v);
+				}
+				return p - out;
+			}
+			// the last block is padded with its first value, which costs no bits
+			if (padded > count) {
+				std::fill(z.begin() + count, z.end(), z[padded - block]);
+			}
+			for (size_t i = 0; i < padded; i += block) {
+				p = PackBlock(z.data() + i, p);
+			}
+			return p - out;
+		}
+
+		template <typename T>
+		bool UnpackValues(const uint8_t* in, size_t size, DeltaFilter::Order order, DeltaFilter::Packing packing, uint8_t* out, size_t count)
+		{
+			const size_t block = Width<T>::BlockValues;
+			auto fr = packing == DeltaFilter::Packing::FrameOfReference;
+			auto padded = fr ? (count + block - 1) / block * block : count;
+			std::vector<T> z(padded);
+			auto p = in;
+			auto end = in + size;
+			for (size_t i = 0; i < padded && p != nullptr; i += fr ? block : 1) {
+				p = fr ? UnpackBlock(p, end, z.data() + i) : GetVarint(p, end, z[i]);
+			}
+			if (p != end) {
+				return false;
+			}
+			Sums(z.data(), count, order, out);
+			return true;
+		}
+
+		// the most values size bytes of packed values can hold: a varint takes a byte at least, a block a byte and a
+		// varint at least
+		uint64_t MaxValues(size_t size, size_t elem_size, DeltaFilter::Packing packing)
+		{
+			if (packing == DeltaFilter::Packing::Varint) {
+				return size;
+			}
+			return (uint64_t)(size / 2) * Lanes * 8 * elem_size;
+		}
+
+		size_t MaxPacked(size_t count, size_t elem_size, DeltaFilter::Packing packing)
+		{
+			switch (elem_size) {
+			case 1: return MaxPackedSize<uint8_t>(count, packing);
+			case 2: return MaxPackedSize<uint16_t>(count, packing);
+			case 4: return MaxPackedSize<uint32_t>(count, packing);
+			case 8: return MaxPackedSize<uint64_t>(count, packing);
+			}
+			return 0;
+		}
+
+		size_t PackAny(const void* in, size_t count, size_t elem_size, DeltaFilter::Order order, DeltaFilter::Packing packing, uint8_t* out)
+		{
+			auto src = (const uint8_t*)in;
+			switch (elem_size) {
+			case 1: return PackValues<uint8_t>(src, count, order, packing, out);
+			case 2: return PackValues<uint16_t>(src, count, order, packing, out);
+			case 4: return PackValues<uint32_t>(src, count, order, packing, out);
+			case 8: return PackValues<uint64_t>(src, count, order, packing, out);
+			}
+			return 0;
+		}
+
+		bool UnpackAny(const void* in, size_t size, size_t elem_size, DeltaFilter::Order order, DeltaFilter::Packing packing, void* out, size_t count)
+		{
+			auto src = (const uint8_t*)in;
+			auto dst = (uint8_t*)out;
+			switch (elem_size) {
+			case 1: return UnpackValues<uint8_t>(src, size, order, packing, dst, count);
+			case 2: return UnpackValues<uint16_t>(src, size, order, packing, dst, count);
+			case 4: return UnpackValues<uint32_t>(src, size, order, packing, dst, count);
+			case 8: return UnpackValues<uint64_t>(src, size, order, packing, dst, count);
+			}
+			return false;
+		}
+
+		bool ParseParameters(const unsigned int* cd_values, size_t cd_nelmts, DeltaFilter::Order& order, DeltaFilter::Packing& packing, size_t& elem_size)
+		{
+			if (cd_nelmts < ParameterCount) {
+				return false;
+			}
+			order = (DeltaFilter::Order)cd_values[0];
+			packing = (DeltaFilter::Packing)cd_values[1];
+			elem_size = cd_values[2];
+			return IsValid(order, packing) && MaxPacked(1, elem_size, packing) != 0;
+		}
+	}
+
+	bool DeltaFilter::Pack(const void* in, size_t count, size_t elem_size, Order order, Packing packing, std::vector<uint8_t>& out)
+	{
+		if (!IsValid(order, packing) || MaxPacked(1, elem_size, packing) == 0) {
+			return false;
+		}
+		out.resize(MaxPacked(count, elem_size, packing));
+		out.resize(PackAny(in, count, elem_size, order, packing, out.data()));
+		return true;
+	}
+
+	bool DeltaFilter::Unpack(const void* in, size_t size, size_t elem_size, Order order, Packing packing, void* out, size_t count)
+	{
+		return IsValid(order, packing) && UnpackAny(in, size, elem_size, order, packing, out, count);
+	}
+
+	std::vector<unsigned int> DeltaFilter::MakeParameters(Order order, Packing packing)
+	{
+		return { (unsigned int)order, (unsigned int)packing, 0, 0 };
+	}
+
+	const char* DeltaFilter::GetName() const
+	{
+		return "hdf5pp delta";
+	}
+
+	bool DeltaFilter::Encode(const unsigned int* cd_values, size_t cd_nelmts, const void* in, size_t size, Buffer& out) const
+	{
+		Order order;
+		Packing packing;
+		size_t elem_size{ 0 };
+		if (!ParseParameters(cd_values, cd_nelmts, order, packing, elem_size) || size % elem_size != 0) {
+			return false;
+		}
+		auto count = size / elem_size;
+		if (!out.Resize(HeaderSize + MaxPacked(count, elem_size, packing))) {
+			return false;
+		}
+		auto dst = (uint8_t*)out.GetData();
+		PutLE64(dst, count);
+		auto packed = HeaderSize + PackAny(in, count, elem_size, order, packing, dst + HeaderSize);
+		// not worth filtering: the library stores the chunk as it is
+		return packed < size && out.Resize(packed);
+	}
+
+	bool DeltaFilter::Decode(const unsigned int* cd_values, size_t cd_nelmts, const void* in, size_t size, Buffer& out) const
+	{
+		Order order;
+		Packing packing;
+		size_t elem_size{ 0 };
+		if (!ParseParameters(cd_values, cd_nelmts, order, packing, elem_size) || size < HeaderSize) {
+			return false;
+		}
+		auto src = (const uint8_t*)in;
+		auto count = GetLE64(src);
+		// checked before anything is allocated for it: no more than the packed values can hold, nor than a chunk
+		uint64_t chunk_bytes = cd_nelmts > ChunkBytesParameter ? cd_values[ChunkBytesParameter] : 0;
+		if (count > MaxValues(size - HeaderSize, elem_size, packing) || (chunk_bytes > 0 && count > chunk_bytes / elem_size) ||
+			!out.Resize((size_t)count * elem_size)) {
+			return false;
+		}
+		return UnpackAny(src + HeaderSize, size - HeaderSize, elem_size, order, packing, out.GetData(), (size_t)count);
+	}
+
+	bool DeltaFilter::CanApply(hid_t /*dcpl_id*/, hid_t type_id, hid_t /*space_id*/) const
+	{
+		// integers are read as they are stored, little endian
+		auto size = H5Tget_size(type_id);
+		return H5Tget_class(type_id) == H5T_INTEGER && H5Tget_order(type_id) == H5T_ORDER_LE &&
+			H5Tget_order(H5T_NATIVE_INT) == H5T_ORDER_LE && (size == 1 || size == 2 || size == 4 || size == 8);
+	}
+
+	bool DeltaFilter::SetLocal(hid_t dcpl_id, hid_t type_id, hid_t space_id) const
+	{
+		unsigned int flags{ 0 };
+		std::vector<unsigned int> cd_values;
+		if (!GetParameters(dcpl_id, ID, flags, cd_values) || cd_values.size() < ParameterCount ||
+			!IsValid((Order)cd_values[0], (Packing)cd_values[1])) {
+			return false;
+		}
+		// element size 0 makes Encode leave every chunk as it is
+		auto elem_size = CanApply(dcpl_id, type_id, space_id) ? H5Tget_size(type_id) : 0;
+		cd_values[2] = (unsigned int)elem_size;
+		cd_values.resize(ChunkBytesParameter + 1);
+		auto rank = H5Pget_chunk(dcpl_id, 0, nullptr);
+		std::vector<hsize_t> chunk(rank > 0 ? (size_t)rank : 0);
+		uint64_t chunk_bytes = elem_size;
+		if (rank <= 0 || H5Pget_chunk(dcpl_id, rank, chunk.data()) != rank) {
+			chunk_bytes = 0;
+		}
+		for (auto d : chunk) {
+			chunk_bytes = d > 0 && chunk_bytes <= std::numeric_limits<unsigned int>::max() / d ? chunk_bytes * d : 0;
+		}
+		cd_values[ChunkBytesParameter] = chunk_bytes <= std::numeric_limits<unsigned int>::max() ? (unsigned int)chunk_bytes : 0;
+		return SetParameters(dcpl_id, ID, flags, cd_values);
+	}
+}
@@ -0,0 +1,55 @@
+// hdf5pp_delta.h
+// HDF5::DeltaFilter encodes integer series that move by small or regular steps, such as timestamps and counters:
+// each element is replaced by its difference from the previous one (Order::Delta), or by the difference of these
+// differences (Order::DeltaOfDelta, for steady rates), zig-zag mapped so that small negative steps stay small, then
+// packed as varints (Packing::Varint) or by frame of reference (Packing::FrameOfReference): blocks of 4 x the
+// element bits values stored as offsets from the smallest one in as many bits as the largest needs, none when
+// the steps are constant
+// frame of reference blocks are laid out in 4 interleaved lanes that decode together, which compilers vectorize;
+// the sums that undo the differences run serially after
+// the differences wrap at the element size, so signed and unsigned types, and series that are not monotonic, come
+// back exactly; a chunk that would not shrink is stored unfiltered, the filter being optional
+// the filter has a testing identifier (DatasetCreationPropertyList::SetDelta, SetDeltaOfDelta); put a compression
+// filter after it for more
+//
+#pragma once
+
+#include "hdf5pp_filter.h"
+
+#include <cstdint>
+
+namespace HDF5 {
+
+	class HDF5PP_API DeltaFilter : public Filter
+	{
+	public:
+		enum class Order {
+			Delta = 1,
+			DeltaOfDelta = 2
+		};
+
+		enum class Packing {
+			Varint = 1,				// 7 bits per byte, 1 byte for zig-zag values under 128
+			FrameOfReference = 2	// bit-packed blocks, see above
+		};
+
+		static const H5Z_filter_t ID = 258;
+
+		// Encodes count little-endian integers of elem_size bytes (1, 2, 4 or 8) from in into out
+		static bool Pack(const void* in, size_t count, size_t elem_size, Order order, Packing packing, std::vector<uint8_t>& out);
+
+		// Decodes size bytes written by Pack into count integers of elem_size bytes at out
+		static bool Unpack(const void* in, size_t size, size_t elem_size, Order order, Packing packing, void* out, size_t count);
+
+		// Returns the filter parameters of order and packing; the element and chunk sizes are set when the dataset is
+		// created
+		static std::vector<unsigned int> MakeParameters(Order order, Packing packing);
+
+		H5Z_filter_t GetID() const override { return ID; }
+		const char* GetName() const override;
+		bool Encode(const unsigned int* cd_values, size_t cd_nelmts, const void* in, size_t size, Buffer& out) const override;
+		bool Decode(const unsigned int* cd_values, size_t cd_nelmts, const void* in, size_t size, Buffer& out) const override;
+		bool CanApply(hid_t dcpl_id, hid_t type_id, hid_t space_id) const override;
+		bool SetLocal(hid_t dcpl_id, hid_t type_id, hid_t space_id) const override;
+	};
+}
@@ -3,9 +3,21 @@
 
 #include "hdf5pp_dtype.h"
 #include "hdf5pp_dspace.h"
+#include "hdf5pp_probe.h"
 
 namespace HDF5 {
 
+#if defined(HDF5PP_WITH_METRICS) || defined(HDF5PP_WITH_TRACE)
+	namespace {
+		// bytes in the memory buffer of a transfer
+		uint64_t TransferSize(const Datatype& mem_dtype, const Dataspace& mem_dspace)
+		{
+			auto npoints = H5Sget_select_npoints((hid_t)mem_dspace);
+			return npoints > 0 ? (uint64_t)npoints * H5Tget_size((hid_t)mem_dtype) : 0;
+		}
+	}
+#endif
+
 
 	Dataset::Dataset(const Dataset& rhs)
 	{
@@ -45,6 +57,7 @@ namespace HDF5 {
 	{
 		if (hid >= 0) {
 			if (H5I_DATASET == H5Iget_type(hid)) {
+				ClearAttributeCache();
 				DecrementReferenceCount();
 				m_hID = hid;
 				return true;
@@ -54,6 +67,7 @@ namespace HDF5 {
 			}
 		}
 		else {
+			ClearAttributeCache();
 			DecrementReferenceCount();
 			m_hID = InvalidHandle;
 			return true;
@@ -122,6 +136,8 @@ namespace HDF5 {
 
 	bool Dataset::Read(const Datatype& mem_dype, const Dataspace& mem_dspace, const Dataspace& file_dspace, void* buf, const PropertyList& xpl /*= PropertyList()*/)
 	{
+		HDF5PP_PROBE_OBJECT(DatasetRead, m_hID);
+		HDF5PP_PROBE_BYTES(TransferSize(mem_dype, mem_dspace));
 		return H5Dread(m_hID, (hid_t)mem_dype, (hid_t)mem_dspace, (hid_t)file_dspace, (hid_t)xpl, buf) >= 0;
 	}
 
@@ -157,6 +173,8 @@ namespace HDF5 {
 
 	bool Dataset::Write(const Datatype& mem_dtype, const Dataspace& mem_dspace, const Dataspace& file_dspace, const void* buf, const PropertyList& xpl /*= PropertyList()*/)
 	{
+		HDF5PP_PROBE_OBJECT(DatasetWrite, m_hID);
+		HDF5PP_PROBE_BYTES(TransferSize(mem_dtype, mem_dspace));
 		return H5Dwrite(m_hID, (hid_t)mem_dtype, (hid_t)mem_dspace, (hid_t)file_dspace, (hid_t)xpl, buf) >= 0;
 	}
 
@@ -168,6 +186,7 @@ namespace HDF5 {
 	Dataset& Dataset::operator=(const Dataset& rhs)
 	{
 		if (this != &rhs) {
+			ClearAttributeCache();
 			DecrementReferenceCount();
 			m_hID = rhs.m_hID;
 			IncrementReferenceCount();
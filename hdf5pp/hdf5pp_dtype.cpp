@@ -58,6 +58,7 @@ namespace HDF5 {
 	{
 		if (hid >= 0) {
 			if (H5I_DATATYPE == H5Iget_type(hid)) {
+				ClearAttributeCache();
 				H5Tclose(m_hID);
 				m_hID = hid;
 				return true;
@@ -67,6 +68,7 @@ namespace HDF5 {
 			}
 		}
 		else {
+			ClearAttributeCache();
 			H5Tclose(m_hID);
 			m_hID = InvalidHandle;
 			return true;
@@ -241,6 +243,7 @@ namespace HDF5 {
 	Datatype& Datatype::operator=(const Datatype& rhs)
 	{
 		if (this != &rhs) {
+			ClearAttributeCache();
 			H5Tclose(m_hID);
 			m_hID = H5Tcopy(rhs.m_hID);
 		}
@@ -312,6 +315,7 @@ namespace HDF5 {
 		if (hid >= 0) {
 			if (H5I_DATATYPE == H5Iget_type(hid)) {
 				if (H5T_ARRAY == H5Tget_class(hid)) {
+					ClearAttributeCache();
 					H5Tclose(m_hID);
 					m_hID = hid;
 					return true;
@@ -325,6 +329,7 @@ namespace HDF5 {
 			}
 		}
 		else {
+			ClearAttributeCache();
 			H5Tclose(m_hID);
 			m_hID = InvalidHandle;
 			return true;
@@ -349,6 +354,7 @@ namespace HDF5 {
 	ArrayDatatype& ArrayDatatype::operator=(const ArrayDatatype& rhs)
 	{
 		if (this != &rhs) {
+			ClearAttributeCache();
 			H5Tclose(m_hID);
 			m_hID = H5Tcopy(rhs.m_hID);
 		}
@@ -375,6 +381,7 @@ namespace HDF5 {
 	OpaqueDatatype& OpaqueDatatype::operator=(const OpaqueDatatype& rhs)
 	{
 		if (this != &rhs) {
+			ClearAttributeCache();
 			H5Tclose(m_hID);
 			m_hID = H5Tcopy(rhs.m_hID);
 		}
@@ -386,6 +393,7 @@ namespace HDF5 {
 		if (hid >= 0) {
 			if (H5I_DATATYPE == H5Iget_type(hid)) {
 				if (H5T_OPAQUE == H5Tget_class(hid)) {
+					ClearAttributeCache();
 					H5Tclose(m_hID);
 					m_hID = hid;
 					return true;
@@ -399,6 +407,7 @@ namespace HDF5 {
 			}
 		}
 		else {
+			ClearAttributeCache();
 			H5Tclose(m_hID);
 			m_hID = InvalidHandle;
 			return true;
@@ -476,6 +485,7 @@ namespace HDF5 {
 	EnumerationDatatype& EnumerationDatatype::operator=(const EnumerationDatatype& rhs)
 	{
 		if (this != &rhs) {
+			ClearAttributeCache();
 			H5Tclose(m_hID);
 			m_hID = H5Tcopy(rhs.m_hID);
 		}
@@ -487,6 +497,7 @@ namespace HDF5 {
 		if (hid >= 0) {
 			if (H5I_DATATYPE == H5Iget_type(hid)) {
 				if (H5T_ENUM == H5Tget_class(hid)) {
+					ClearAttributeCache();
 					H5Tclose(m_hID);
 					m_hID = hid;
 					return true;
@@ -500,6 +511,7 @@ namespace HDF5 {
 			}
 		}
 		else {
+			ClearAttributeCache();
 			H5Tclose(m_hID);
 			m_hID = InvalidHandle;
 			return true;
@@ -582,6 +594,7 @@ namespace HDF5 {
 	CompoundDatatype& CompoundDatatype::operator=(const CompoundDatatype& rhs)
 	{
 		if (this != &rhs) {
+			ClearAttributeCache();
 			H5Tclose(m_hID);
 			m_hID = H5Tcopy(rhs.m_hID);
 		}
@@ -593,6 +606,7 @@ namespace HDF5 {
 		if (hid >= 0) {
 			if (H5I_DATATYPE == H5Iget_type(hid)) {
 				if (H5T_COMPOUND == H5Tget_class(hid)) {
+					ClearAttributeCache();
 					H5Tclose(m_hID);
 					m_hID = hid;
 					return true;
@@ -606,6 +620,7 @@ namespace HDF5 {
 			}
 		}
 		else {
+			ClearAttributeCache();
 			H5Tclose(m_hID);
 			m_hID = InvalidHandle;
 			return true;
@@ -714,6 +729,7 @@ namespace HDF5 {
 	StringDatatype& StringDatatype::operator=(const StringDatatype& rhs)
 	{
 		if (this != &rhs) {
+			ClearAttributeCache();
 			H5Tclose(m_hID);
 			m_hID = H5Tcopy(rhs.m_hID);
 		}
@@ -722,6 +738,7 @@ namespace HDF5 {
 
 	StringDatatype& StringDatatype::operator=(const StringPDT& rhs)
 	{
+		ClearAttributeCache();
 		H5Tclose(m_hID);
 		m_hID = H5Tcopy((hid_t)rhs);
 		return *this;
@@ -732,6 +749,7 @@ namespace HDF5 {
 		if (hid >= 0) {
 			if (H5I_DATATYPE == H5Iget_type(hid)) {
 				if (H5T_STRING == H5Tget_class(hid)) {
+					ClearAttributeCache();
 					H5Tclose(m_hID);
 					m_hID = hid;
 					return true;
@@ -745,6 +763,7 @@ namespace HDF5 {
 			}
 		}
 		else {
+			ClearAttributeCache();
 			H5Tclose(m_hID);
 			m_hID = InvalidHandle;
 			return true;
@@ -831,6 +850,7 @@ namespace HDF5 {
 	FloatDatatype& FloatDatatype::operator=(const FloatDatatype& rhs)
 	{
 		if (this != &rhs) {
+			ClearAttributeCache();
 			H5Tclose(m_hID);
 			m_hID = H5Tcopy(rhs.m_hID);
 		}
@@ -839,6 +859,7 @@ namespace HDF5 {
 
 	FloatDatatype& FloatDatatype::operator=(const FloatPDT& rhs)
 	{
+		ClearAttributeCache();
 		H5Tclose(m_hID);
 		m_hID = H5Tcopy((hid_t)rhs);
 		return *this;
@@ -849,6 +870,7 @@ namespace HDF5 {
 		if (hid >= 0) {
 			if (H5I_DATATYPE == H5Iget_type(hid)) {
 				if (H5T_FLOAT == H5Tget_class(hid)) {
+					ClearAttributeCache();
 					H5Tclose(m_hID);
 					m_hID = hid;
 					return true;
@@ -862,6 +884,7 @@ namespace HDF5 {
 			}
 		}
 		else {
+			ClearAttributeCache();
 			H5Tclose(m_hID);
 			m_hID = InvalidHandle;
 			return true;
@@ -959,6 +982,7 @@ namespace HDF5 {
 	IntegerDatatype& IntegerDatatype::operator=(const IntegerDatatype& rhs)
 	{
 		if (this != &rhs) {
+			ClearAttributeCache();
 			H5Tclose(m_hID);
 			m_hID = H5Tcopy(rhs.m_hID);
 		}
@@ -967,6 +991,7 @@ namespace HDF5 {
 
 	IntegerDatatype& IntegerDatatype::operator=(const IntegerPDT& rhs)
 	{
+		ClearAttributeCache();
 		H5Tclose(m_hID);
 		m_hID = H5Tcopy((hid_t)rhs);
 		return *this;
@@ -977,6 +1002,7 @@ namespace HDF5 {
 		if (hid >= 0) {
 			if (H5I_DATATYPE == H5Iget_type(hid)) {
 				if (H5T_INTEGER == H5Tget_class(hid)) {
+					ClearAttributeCache();
 					H5Tclose(m_hID);
 					m_hID = hid;
 					return true;
@@ -990,6 +1016,7 @@ namespace HDF5 {
 			}
 		}
 		else {
+			ClearAttributeCache();
 			H5Tclose(m_hID);
 			m_hID = InvalidHandle;
 			return true;
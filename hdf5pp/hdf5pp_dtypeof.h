@@ -7,6 +7,7 @@ namespace HDF5 {
 	class HDF5PP_API IntegerPDT;
 	class HDF5PP_API FloatPDT;
 
+	HDF5PP_API const IntegerPDT& DatatypeOf(char);
 	HDF5PP_API const IntegerPDT& DatatypeOf(unsigned char);
 	HDF5PP_API const IntegerPDT& DatatypeOf(signed char);
 	HDF5PP_API const IntegerPDT& DatatypeOf(short);
@@ -1,9 +1,226 @@
 #include "pch.h"
 #include "hdf5pp_file.h"
+#include "hdf5pp_probe.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
 
 
 namespace HDF5 {
 
+	namespace {
+
+		// state shared by the file image callbacks of one OpenImage call; the property lists and the open
+		// file all refer to the same image memory, which is never copied by the callbacks
+		struct ImageUData {
+			void* image;		// the caller's buffer, or our copy of it
+			size_t size;
+			bool owned;			// image is our copy: resizable, and freed once nothing refers to it
+			int fapl_refs;		// property lists holding the image
+			int vfd_refs;		// open files holding the image
+			int refs;			// holders of this struct
+		};
+
+		void* ImageMalloc(size_t size, H5FD_file_image_op_t op, void* udata)
+		{
+			auto ud = (ImageUData*)udata;
+			if (ud->image == nullptr || size > ud->size) {
+				return nullptr;
+			}
+			switch (op) {
+			case H5FD_FILE_IMAGE_OP_PROPERTY_LIST_SET:
+			case H5FD_FILE_IMAGE_OP_PROPERTY_LIST_COPY:
+			case H5FD_FILE_IMAGE_OP_PROPERTY_LIST_GET:
+				++ud->fapl_refs;
+				return ud->image;
+			case H5FD_FILE_IMAGE_OP_FILE_OPEN:
+				if (ud->vfd_refs != 0) {
+					return nullptr;
+				}
+				// the driver keeps udata without copying it; hold a reference for it until FILE_CLOSE
+				++ud->vfd_refs;
+				++ud->refs;
+				return ud->image;
+			default:
+				return nullptr;
+			}
+		}
+
+		void* ImageMemcpy(void* dest, const void* src, size_t size, H5FD_file_image_op_t /*op*/, void* /*udata*/)
+		{
+			// every allocation returned the image itself
+			if (dest != src) {
+				memcpy(dest, src, size);
+			}
+			return dest;
+		}
+
+		void* ImageRealloc(void* ptr, size_t size, H5FD_file_image_op_t op, void* udata)
+		{
+			auto ud = (ImageUData*)udata;
+			if (!ud->owned || op != H5FD_FILE_IMAGE_OP_FILE_RESIZE || ptr != ud->image) {
+				return nullptr;
+			}
+			auto image = realloc(ud->image, size);
+			if (image != nullptr) {
+				ud->image = image;
+				ud->size = size;
+			}
+			return image;
+		}
+
+		herr_t ImageUDataFree(void* udata);
+
+		herr_t ImageFree(void* /*ptr*/, H5FD_file_image_op_t op, void* udata)
+		{
+			auto ud = (ImageUData*)udata;
+			switch (op) {
+			case H5FD_FILE_IMAGE_OP_PROPERTY_LIST_CLOSE:
+				if (ud->fapl_refs == 0) {
+					return -1;
+				}
+				--ud->fapl_refs;
+				break;
+			case H5FD_FILE_IMAGE_OP_FILE_CLOSE:
+				if (ud->vfd_refs == 0) {
+					return -1;
+				}
+				--ud->vfd_refs;
+				break;
+			default:
+				return -1;
+			}
+			// property lists copied before a resize still hold the old address, so ptr is not compared
+			if (ud->owned && ud->fapl_refs == 0 && ud->vfd_refs == 0) {
+				free(ud->image);
+				ud->image = nullptr;
+			}
+			if (op == H5FD_FILE_IMAGE_OP_FILE_CLOSE) {
+				ImageUDataFree(ud);
+			}
+			return 0;
+		}
+
+		void* ImageUDataCopy(void* udata)
+		{
+			++((ImageUData*)udata)->refs;
+			return udata;
+		}
+
+		herr_t ImageUDataFree(void* udata)
+		{
+			auto ud = (ImageUData*)udata;
+			if (--ud->refs == 0) {
+				if (ud->owned) {
+					free(ud->image);
+				}
+				delete ud;
+			}
+			return 0;
+		}
+
+		// the core driver identifies files by name, so every image gets its own
+		std::atomic<unsigned long> g_imageCount{ 0 };
+
+		// Bob Jenkins' lookup3 hash with a zero initial value, the checksum of HDF5 metadata
+		uint32_t ChecksumLookup3(const unsigned char* k, size_t length)
+		{
+			auto rot = [](uint32_t x, int n) { return (x << n) | (x >> (32 - n)); };
+			uint32_t a, b, c;
+			a = b = c = 0xdeadbeef + (uint32_t)length;
+			while (length > 12) {
+				a += k[0] + ((uint32_t)k[1] << 8) + ((uint32_t)k[2] << 16) + ((uint32_t)k[3] << 24);
+				b += k[4] + ((uint32_t)k[5] << 8) + ((uint32_t)k[6] << 16) + ((uint32_t)k[7] << 24);
+				c += k[8] + ((uint32_t)k[9] << 8) + ((uint32_t)k[10] << 16) + ((uint32_t)k[11] << 24);
+				a -= c; a ^= rot(c, 4); c += b;
+				b -= a; b ^= rot(a, 6); a += c;
+				c -= b; c ^= rot(b, 8); b += a;
+				a -= c; a ^= rot(c, 16); c += b;
+				b -= a; b ^= rot(a, 19); a += c;
+				c -= b; c ^= rot(b, 4); b += a;
+				length -= 12;
+				k += 12;
+			}
+			if (length == 0) {
+				return c;
+			}
+			uint32_t tail[3] = { 0, 0, 0 };
+			for (size_t i = 0; i < length; ++i) {
+				tail[i / 4] += (uint32_t)k[i] << (8 * (i % 4));
+			}
+			a += tail[0];
+			b += tail[1];
+			c += tail[2];
+			c ^= b; c -= rot(b, 14);
+			a ^= c; a -= rot(c, 11);
+			b ^= a; b -= rot(a, 25);
+			c ^= b; c -= rot(b, 16);
+			a ^= c; a -= rot(c, 4);
+			b ^= a; b -= rot(a, 14);
+			c ^= b; c -= rot(b, 24);
+			return c;
+		}
+
+		// copies the image of an open file, flushed first so that it is complete
+		// the library clears the "open for write" status flags of the superblock in the copy but leaves the
+		// checksum of version 2 and 3 superblocks as it was, so it is recomputed here
+		bool CopyImage(File& file, std::vector<char>& image)
+		{
+			if (!file.FlushFile(Location::FlushScope::Local)) {
+				return false;
+			}
+			auto size = file.GetFileImageSize();
+			if (size <= 0) {
+				return false;
+			}
+			image.resize((size_t)size);
+			if (file.GetFileImage(image.data(), image.size()) != size) {
+				return false;
+			}
+
+			// the image starts with the superblock, without the user block if the file has one
+			static const unsigned char Signature[8] = { 0x89, 'H', 'D', 'F', '\r', '\n', 0x1a, '\n' };
+			auto sb = (unsigned char*)image.data();
+			if (image.size() < 12 || memcmp(sb, Signature, sizeof(Signature)) != 0) {
+				return false;
+			}
+			if (sb[8] >= 2) {
+				// signature, version, sizes of offsets and lengths, status flags, four addresses, checksum
+				size_t len = 12 + 4 * (size_t)sb[9];
+				if (len + 4 > image.size()) {
+					return false;
+				}
+				auto sum = ChecksumLookup3(sb, len);
+				for (int i = 0; i < 4; ++i) {
+					sb[len + i] = (unsigned char)(sum >> (8 * i));
+				}
+			}
+			return true;
+		}
+
+		// writes an image to path in sequential writes of block_size bytes, bypassing the stream buffer
+		bool WriteImage(const std::string& path, const std::vector<char>& image, size_t block_size)
+		{
+			std::ofstream out;
+			out.rdbuf()->pubsetbuf(nullptr, 0);
+			out.open(path, std::ios::binary | std::ios::trunc);
+			if (block_size == 0) {
+				block_size = image.size();
+			}
+			for (size_t offset = 0; out && offset < image.size(); offset += block_size) {
+				out.write(image.data() + offset, (std::streamsize)std::min(block_size, image.size() - offset));
+			}
+			out.close();
+			return !out.fail();
+		}
+	}
+
 	File::File(const File& rhs)
 	{
 		m_hID = rhs.m_hID;
@@ -12,6 +229,7 @@ namespace HDF5 {
 
 	File::File(const char* name, unsigned int flags, const PropertyList& fcpl /*= PropertyList()*/, const PropertyList& fapl /*= PropertyList()*/)
 	{
+		HDF5PP_PROBE_NAME(FileCreate, name);
 		m_hID = H5Fcreate(name, flags, (hid_t)fcpl, (hid_t)fapl);
 		if (m_hID < 0) {
 			m_hID = InvalidHandle;
@@ -26,6 +244,8 @@ namespace HDF5 {
 	File& File::operator=(const File& rhs)
 	{
 		if (this != &rhs) {
+			ClearAttributeCache();
+			m_pageStatsFilename.clear();
 			DecrementReferenceCount();
 			m_hID = rhs.m_hID;
 			IncrementReferenceCount();
@@ -37,6 +257,8 @@ namespace HDF5 {
 	{
 		if (hid >= 0) {
 			if (H5I_FILE == H5Iget_type(hid)) {
+				ClearAttributeCache();
+				m_pageStatsFilename.clear();
 				DecrementReferenceCount();
 				m_hID = hid;
 				return true;
@@ -47,6 +269,8 @@ namespace HDF5 {
 			}
 		}
 		else {
+			ClearAttributeCache();
+			m_pageStatsFilename.clear();
 			DecrementReferenceCount();
 			m_hID = InvalidHandle;
 			return true;
@@ -61,6 +285,7 @@ namespace HDF5 {
 	bool File::Create(const char* name, unsigned int flags, const PropertyList& fcpl /*= PropertyList()*/, const PropertyList& fapl /*= PropertyList()*/)
 	{
 		Close();
+		HDF5PP_PROBE_NAME(FileCreate, name);
 		m_hID = H5Fcreate(name, flags, (hid_t)fcpl, (hid_t)fapl);
 		if (m_hID < 0) {
 			m_hID = InvalidHandle;
@@ -70,6 +295,22 @@ namespace HDF5 {
 
 	bool File::Close()
 	{
+		ClearAttributeCache();
+		if (!m_pageStatsFilename.empty()) {
+			// only the File that created or opened the file has the name, so the statistics are exported once
+			if (m_hID >= 0) {
+				ExportPageBufferingStats(m_pageStatsFilename.c_str());
+			}
+			m_pageStatsFilename.clear();
+		}
+		if (m_hID >= 0 && H5Iget_ref(m_hID) == 1 && H5Fget_obj_count(m_hID, H5F_OBJ_ALL) == 1) {
+			// nothing else holds the file open, so it closes with this identifier; a file kept open by its objects
+			// keeps its policy until SetForFile finds it closed
+			unsigned long fileno{ 0 };
+			if (H5Fget_fileno(m_hID, &fileno) >= 0) {
+				LayoutPolicy::SetForFile(fileno, nullptr);
+			}
+		}
 		if (m_hID >= 0) {
 			auto rv = H5Fclose(m_hID);
 			m_hID = InvalidHandle;
@@ -80,6 +321,25 @@ namespace HDF5 {
 		}
 	}
 
+	bool File::SetLayoutPolicy(std::shared_ptr<const LayoutPolicy> policy)
+	{
+		unsigned long fileno{ 0 };
+		if (m_hID < 0 || H5Fget_fileno(m_hID, &fileno) < 0) {
+			return false;
+		}
+		LayoutPolicy::SetForFile(fileno, policy);
+		return true;
+	}
+
+	std::shared_ptr<const LayoutPolicy> File::GetLayoutPolicy() const
+	{
+		unsigned long fileno{ 0 };
+		if (m_hID < 0 || H5Fget_fileno(m_hID, &fileno) < 0) {
+			return nullptr;
+		}
+		return LayoutPolicy::GetForFile(fileno);
+	}
+
 	bool Delete(const char* filename, const PropertyList& fapl /*= PropertyList()*/)
 	{
 		return H5Fdelete(filename, (hid_t)fapl) >= 0;
@@ -229,6 +489,97 @@ namespace HDF5 {
 		return H5Freset_page_buffering_stats(m_hID) >= 0;
 	}
 
+	bool File::ExportPageBufferingStats(const char* filename)
+	{
+		BufferingStats stats;
+		if (!GetPageBufferingStatus(stats)) {
+			return false;
+		}
+		auto len = H5Fget_name(m_hID, nullptr, 0);
+		if (len < 0) {
+			return false;
+		}
+		std::string name((size_t)len + 1, 0);
+		H5Fget_name(m_hID, &name[0], name.size());
+		name.resize((size_t)len);
+
+		std::ofstream os(filename, std::ios::app);
+		os << "{\"file\":\"";
+		for (auto c : name) {
+			if (c == '"' || c == '\\') {
+				os << '\\';
+			}
+			os << c;
+		}
+		os << "\"";
+		auto pair = [&os](const char* key, const unsigned int* v) {
+			os << ",\"" << key << "\":{\"metadata\":" << v[0] << ",\"raw\":" << v[1] << "}";
+		};
+		pair("accesses", stats.accesses);
+		pair("hits", stats.hits);
+		pair("misses", stats.misses);
+		pair("evictions", stats.evictions);
+		pair("bypasses", stats.bypasses);
+		os << "}\n";
+		return os.good();
+	}
+
+	bool File::CreatePaged(const char* name, unsigned int flags, const PagingConfig& cfg /*= PagingConfig()*/)
+	{
+		FileCreationPropertyList fcpl;
+		FileAccessPropertyList fapl;
+		if (!fcpl.SetPagedAggregation(cfg.page_size, cfg.persist_free_space) ||
+			!fapl.SetPageBufferSize(cfg.buffer_size, cfg.min_meta_perc, cfg.min_raw_perc)) {
+			return false;
+		}
+		if (!Create(name, flags, fcpl, fapl)) {
+			return false;
+		}
+		m_pageStatsFilename = cfg.stats_filename;
+		return true;
+	}
+
+	bool File::OpenPaged(const char* name, unsigned int flags, const PagingConfig& cfg /*= PagingConfig()*/)
+	{
+		FileAccessPropertyList fapl;
+		if (!fapl.SetPageBufferSize(cfg.buffer_size, cfg.min_meta_perc, cfg.min_raw_perc)) {
+			return false;
+		}
+		if (!Open(name, flags, fapl)) {
+			return false;
+		}
+		m_pageStatsFilename = cfg.stats_filename;
+		return true;
+	}
+
+	bool File::CreateScratch(const char* name, size_t increment /*= 1 << 20*/, const PropertyList& fcpl /*= PropertyList()*/)
+	{
+		FileAccessPropertyList fapl;
+		if (!fapl.SetCoreDriver(increment, false)) {
+			return false;
+		}
+		return Create(name, H5F_ACC_TRUNC, fcpl, fapl);
+	}
+
+	bool File::Persist(const char* path, size_t block_size /*= 16 << 20*/)
+	{
+		std::vector<char> image;
+		return CopyImage(*this, image) && WriteImage(path, image, block_size);
+	}
+
+	std::future<bool> File::PersistAsync(const char* path, size_t block_size /*= 16 << 20*/)
+	{
+		std::vector<char> image;
+		if (!CopyImage(*this, image)) {
+			std::promise<bool> failed;
+			failed.set_value(false);
+			return failed.get_future();
+		}
+		return std::async(std::launch::async, [image = std::move(image), target = std::string(path), block_size]() {
+			return WriteImage(target, image, block_size);
+		});
+	}
+
 	bool File::GetVFDHandle(const PropertyList& fapl, void** file_handle)
 	{
 		return H5Fget_vfd_handle(m_hID, (hid_t)fapl, file_handle) >= 0;
@@ -252,6 +603,7 @@ namespace HDF5 {
 	bool File::Open(const char* name, unsigned int flags, const PropertyList& fapl /*= PropertyList()*/)
 	{
 		Close();
+		HDF5PP_PROBE_NAME(FileOpen, name);
 		m_hID = H5Fopen(name, flags, (hid_t)fapl);
 		if (m_hID < 0) {
 			m_hID = InvalidHandle;
@@ -259,6 +611,41 @@ namespace HDF5 {
 		return m_hID >= 0;
 	}
 
+	bool File::OpenImage(const void* buffer, size_t size, unsigned int flags)
+	{
+		Close();
+		if (buffer == nullptr || size == 0) {
+			return false;
+		}
+
+		auto ud = new ImageUData{ const_cast<void*>(buffer), size, false, 0, 0, 1 };
+		if ((flags & H5F_ACC_RDWR) != 0) {
+			ud->image = malloc(size);
+			if (ud->image == nullptr) {
+				delete ud;
+				return false;
+			}
+			memcpy(ud->image, buffer, size);
+			ud->owned = true;
+		}
+
+		bool rv{ false };
+		{
+			H5FD_file_image_callbacks_t callbacks = { ImageMalloc, ImageMemcpy, ImageRealloc, ImageFree, ImageUDataCopy, ImageUDataFree, ud };
+			FileAccessPropertyList fapl;
+			// grow a writable image in steps of an eighth of its size
+			if (fapl.SetCoreDriver(std::max(size / 8, (size_t)64 * 1024), false) &&
+				fapl.SetFileImageCallbacks(callbacks) &&
+				fapl.SetFileImage(ud->image, size)) {
+				char name[48];
+				snprintf(name, sizeof(name), "hdf5pp_image_%lu", ++g_imageCount);
+				rv = Open(name, flags, fapl);
+			}
+		}
+		ImageUDataFree(ud);
+		return rv;
+	}
+
 	File File::Reopen()
 	{
 		return File(H5Freopen(m_hID));
@@ -5,6 +5,10 @@
 
 #include "hdf5pp_group.h"
 #include "hdf5pp_proplist.h"
+#include "hdf5pp_layout.h"
+
+#include <future>
+#include <memory>
 
 namespace HDF5 {
 
@@ -15,6 +19,8 @@ namespace HDF5 {
 		File(const File& rhs);
 		File(const char* name, unsigned int flags, const PropertyList& fcpl = PropertyList(), const PropertyList& fapl = PropertyList());
 		virtual ~File();
+		// operator= and Attach release this object's reference to its file, which closes with the last one; unlike
+		// Close, they do not export page buffering statistics
 		File& operator=(const File& rhs);
 
 		bool Attach(hid_t hid) override;
@@ -34,7 +40,9 @@ namespace HDF5 {
 		// flags: H5F_ACC_TRUNC or H5F_ACC_EXCL, H5F_ACC_DEBUG
 		bool Create(const char* name, unsigned int flags, const PropertyList& fcpl = PropertyList(), const PropertyList& fapl = PropertyList());
 
-		// Terminates access to an HDF5 file
+		// Terminates access to an HDF5 file; called by the destructor
+		// the File that created or opened the file with CreatePaged/OpenPaged exports its page buffering statistics
+		// first (PagingConfig::stats_filename), even if copies of it are still open; copies never export them
 		bool Close();
 
 		// the static function File::Delete deletes an HDF5 file filename with a file 
@@ -162,6 +170,42 @@ namespace HDF5 {
 		// Resets the page buffering statistics
 		bool ResetPageBufferingStats();
 
+		// Appends the page buffering statistics to a text file as one line of JSON
+		bool ExportPageBufferingStats(const char* filename);
+
+		// "paged file" preset: paged aggregation on create, a page buffer on create and open
+		struct PagingConfig {
+			PagingConfig() : page_size(4096), persist_free_space(true), buffer_size(4096 * 256), min_meta_perc(0), min_raw_perc(0) {}
+
+			hsize_t page_size;				// file space page size, also the page buffer granularity
+			bool persist_free_space;		// track free space across opens so partially used pages are reused
+			size_t buffer_size;				// page buffer size; a multiple of page_size
+			unsigned int min_meta_perc;		// minimum percentage of the page buffer kept for metadata pages
+			unsigned int min_raw_perc;		// minimum percentage of the page buffer kept for raw data pages
+			std::string stats_filename;		// if not empty, the statistics are exported here by Close
+		};
+
+		// Creates a new paged file with a page buffer; Will close currently opened file, if any
+		bool CreatePaged(const char* name, unsigned int flags, const PagingConfig& cfg = PagingConfig());
+
+		// Opens a file created with paged aggregation, with a page buffer; Will close currently opened file, if any
+		// opening a file that is not paged fails
+		bool OpenPaged(const char* name, unsigned int flags, const PagingConfig& cfg = PagingConfig());
+
+		// Creates a scratch file that lives in memory (core driver, no backing store) and grows in steps of
+		// increment bytes; name only identifies the file, nothing is written to disk unless Persist is called
+		// Will close currently opened file, if any
+		bool CreateScratch(const char* name, size_t increment = 1 << 20, const PropertyList& fcpl = PropertyList());
+
+		// Writes the current image of the file (see GetFileImage) to path, replacing it, in writes of block_size
+		// bytes; the written file opens like any other, e.g. with Open
+		bool Persist(const char* path, size_t block_size = 16 << 20);
+
+		// Same as Persist, but only the image copy is taken on the calling thread: the writes run on a background
+		// thread, so the file can be modified or closed meanwhile; the copy takes as much memory as the image
+		// get() on the result returns whether the write succeeded
+		std::future<bool> PersistAsync(const char* path, size_t block_size = 16 << 20);
+
 		// Returns pointer to the file handle from the virtual file driver
 		bool GetVFDHandle(const PropertyList& fapl, void** file_handle);
 
@@ -182,6 +226,14 @@ namespace HDF5 {
 		// flags: H5F_ACC_RDWR, H5F_ACC_RDONLY, H5F_ACC_DEBUG
 		bool Open(const char* name, unsigned int flags, const PropertyList& fapl = PropertyList());
 
+		// Opens an HDF5 file image held in memory (e.g. one retrieved with GetFileImage); will close the currently
+		// opened file, if any
+		// flags: H5F_ACC_RDONLY reads directly from buffer without copying it; buffer must stay valid and unchanged
+		// until the file and every object opened from it are closed
+		// H5F_ACC_RDWR opens it copy-on-write: buffer is copied once, at open, into memory owned by the file and
+		// is never written; changes go to the copy (see GetFileImage), which is released when the file is closed
+		bool OpenImage(const void* buffer, size_t size, unsigned int flags);
+
 		// Returns a new handle for a previously-opened file
 		File Reopen();
 
@@ -190,9 +242,17 @@ namespace HDF5 {
 
 		// Enabled SWMR writing mode
 		bool StartSWMRWrite();
+
+		// Sets the layout policy of the datasets AddDataset creates in this file, instead of the default one
+		// (LayoutPolicy::SetDefault); nullptr goes back to the default; kept until the last handle to the file
+		// is closed
+		bool SetLayoutPolicy(std::shared_ptr<const LayoutPolicy> policy);
+		std::shared_ptr<const LayoutPolicy> GetLayoutPolicy() const;
 	protected:
 		explicit File(hid_t hid);
 		friend class Location;
+
+		std::string m_pageStatsFilename;	// set by CreatePaged/OpenPaged
 	};
 
 }
\ No newline at end of file
@@ -0,0 +1,191 @@
+#include "pch.h"
+#include "hdf5pp_filemetrics.h"
+#include "hdf5pp_library.h"
+
+#include <fstream>
+#include <sstream>
+
+namespace HDF5 {
+
+	namespace {
+
+		// total number of metadata entries that needed read retries since the file was opened
+		bool GetReadRetries(File& file, uint64_t& total)
+		{
+			H5F_retry_info_t info;
+			if (!file.GetMetadataReadEntryInfo(info)) {
+				return false;
+			}
+			total = 0;
+			for (auto retries : info.retries) {
+				if (retries != nullptr) {
+					for (unsigned int bin = 0; bin < info.nbins; ++bin) {
+						total += retries[bin];
+					}
+					Library::FreeMemory(retries);
+				}
+			}
+			return true;
+		}
+
+		void WritePair(std::ostream& os, const char* key, const unsigned int* v)
+		{
+			os << ",\"" << key << "\":[" << v[0] << "," << v[1] << "]";
+		}
+	}
+
+	FileMetrics::FileMetrics(const File& file, const Thresholds& thresholds /*= Thresholds()*/, size_t max_samples /*= 1024*/)
+		: m_file(file), m_thresholds(thresholds), m_maxSamples(max_samples), m_origin(std::chrono::steady_clock::now())
+	{
+		// the first window starts now
+		GetReadRetries(m_file, m_lastRetries);
+		m_file.ResetMDCHitRateStats();
+		m_file.ResetPageBufferingStats();
+	}
+
+	FileMetrics::~FileMetrics()
+	{
+		Stop();
+	}
+
+	bool FileMetrics::Start(unsigned int interval_ms)
+	{
+		hbool_t threadsafe{ false };
+		if (H5is_library_threadsafe(&threadsafe) < 0 || !threadsafe || interval_ms == 0) {
+			return false;
+		}
+		std::lock_guard<std::mutex> guard(m_runLock);
+		if (m_thread.joinable()) {
+			return false;
+		}
+		m_stop = false;
+		m_thread = std::thread(&FileMetrics::Run, this, interval_ms);
+		return true;
+	}
+
+	void FileMetrics::Stop()
+	{
+		{
+			std::lock_guard<std::mutex> guard(m_runLock);
+			m_stop = true;
+		}
+		m_wake.notify_all();
+		if (m_thread.joinable()) {
+			m_thread.join();
+		}
+	}
+
+	void FileMetrics::Run(unsigned int interval_ms)
+	{
+		auto next = std::chrono::steady_clock::now();
+		std::unique_lock<std::mutex> lock(m_runLock);
+		while (!m_stop) {
+			next += std::chrono::milliseconds(interval_ms);
+			if (m_wake.wait_until(lock, next, [this] { return m_stop; })) {
+				break;
+			}
+			lock.unlock();
+			Sample sample;
+			SampleNow(sample);
+			lock.lock();
+		}
+	}
+
+	bool FileMetrics::SampleNow(Sample& sample)
+	{
+		std::unique_lock<std::mutex> lock(m_lock);
+
+		sample = Sample();
+		sample.time = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_origin).count();
+		if (!m_file.GetMDCHitRate(sample.mdc_hit_rate) ||
+			!m_file.GetMDCSize(&sample.mdc_max_size, &sample.mdc_min_clean_size, &sample.mdc_cur_size, &sample.mdc_entries)) {
+			return false;
+		}
+		// fails when the file has no page buffer
+		sample.page_buffer = m_file.GetPageBufferingStatus(sample.page_stats);
+		uint64_t retries{ 0 };
+		if (GetReadRetries(m_file, retries)) {
+			sample.read_retries = retries - m_lastRetries;
+			m_lastRetries = retries;
+		}
+
+		m_file.ResetMDCHitRateStats();
+		if (sample.page_buffer) {
+			m_file.ResetPageBufferingStats();
+		}
+
+		sample.mdc_thrash = sample.mdc_hit_rate < m_thresholds.min_mdc_hit_rate &&
+			(double)sample.mdc_cur_size >= m_thresholds.min_mdc_fill * (double)sample.mdc_max_size;
+		if (sample.page_buffer) {
+			auto accesses = (uint64_t)sample.page_stats.accesses[0] + sample.page_stats.accesses[1];
+			auto bypasses = (uint64_t)sample.page_stats.bypasses[0] + sample.page_stats.bypasses[1];
+			sample.bypass_storm = accesses >= m_thresholds.min_accesses &&
+				(double)bypasses > m_thresholds.max_bypass_ratio * (double)accesses;
+		}
+
+		m_samples.push_back(sample);
+		while (m_samples.size() > m_maxSamples) {
+			m_samples.pop_front();
+		}
+
+		auto alert = m_alert;
+		auto data = m_alertData;
+		lock.unlock();
+		if (alert != nullptr && (sample.mdc_thrash || sample.bypass_storm)) {
+			alert(*this, sample, data);
+		}
+		return true;
+	}
+
+	void FileMetrics::SetAlertCallback(AlertCallback cb, void* data)
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+		m_alert = cb;
+		m_alertData = data;
+	}
+
+	void FileMetrics::GetSamples(std::vector<Sample>& samples) const
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+		samples.assign(m_samples.begin(), m_samples.end());
+	}
+
+	std::string FileMetrics::ToJSON() const
+	{
+		std::vector<Sample> samples;
+		GetSamples(samples);
+
+		std::ostringstream os;
+		os << "[";
+		for (size_t i = 0; i < samples.size(); ++i) {
+			auto& s = samples[i];
+			os << (i == 0 ? "\n" : ",\n") << "{\"time\":" << s.time
+				<< ",\"mdc_hit_rate\":" << s.mdc_hit_rate
+				<< ",\"mdc_max_size\":" << s.mdc_max_size
+				<< ",\"mdc_min_clean_size\":" << s.mdc_min_clean_size
+				<< ",\"mdc_cur_size\":" << s.mdc_cur_size
+				<< ",\"mdc_entries\":" << s.mdc_entries
+				<< ",\"read_retries\":" << s.read_retries;
+			if (s.page_buffer) {
+				// [metadata, raw data]
+				WritePair(os, "pb_accesses", s.page_stats.accesses);
+				WritePair(os, "pb_hits", s.page_stats.hits);
+				WritePair(os, "pb_misses", s.page_stats.misses);
+				WritePair(os, "pb_evictions", s.page_stats.evictions);
+				WritePair(os, "pb_bypasses", s.page_stats.bypasses);
+			}
+			os << ",\"mdc_thrash\":" << (s.mdc_thrash ? "true" : "false")
+				<< ",\"bypass_storm\":" << (s.bypass_storm ? "true" : "false") << "}";
+		}
+		os << "\n]\n";
+		return os.str();
+	}
+
+	bool FileMetrics::ExportJSON(const char* filename) const
+	{
+		std::ofstream os(filename, std::ios::trunc);
+		os << ToJSON();
+		return os.good();
+	}
+
+}
@@ -0,0 +1,93 @@
+// hdf5pp_filemetrics.h
+// HDF5::FileMetrics samples the metadata cache, page buffer and metadata read retry statistics of one open file
+// into a time series; counters are reset after every sample, so each sample covers one window
+// samples are taken on demand (SampleNow) or by a background timer (Start), which requires a thread-safe
+// build of the HDF5 library; thresholds flag metadata cache thrashing and page buffer bypass storms
+//
+#pragma once
+
+#include "hdf5pp_file.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace HDF5 {
+
+	class HDF5PP_API FileMetrics
+	{
+	public:
+		struct Thresholds {
+			Thresholds() : min_mdc_hit_rate(0.9), min_mdc_fill(0.95), max_bypass_ratio(0.5), min_accesses(100) {}
+
+			double min_mdc_hit_rate;	// thrash: the hit rate over the window is below this ...
+			double min_mdc_fill;		// ... while the cache is filled to at least this fraction of its maximum size
+			double max_bypass_ratio;	// bypass storm: more than this fraction of page buffer accesses bypassed it ...
+			unsigned int min_accesses;	// ... in a window with at least this many accesses
+		};
+
+		struct Sample {
+			double time{ 0 };						// seconds since the FileMetrics was created
+			double mdc_hit_rate{ 0 };				// metadata cache hit rate over the window
+			size_t mdc_max_size{ 0 };				// metadata cache size at the end of the window
+			size_t mdc_min_clean_size{ 0 };
+			size_t mdc_cur_size{ 0 };
+			int mdc_entries{ 0 };
+			bool page_buffer{ false };				// false if the file is not open with a page buffer
+			File::BufferingStats page_stats{};		// page buffer counters over the window; [0] metadata, [1] raw data
+			uint64_t read_retries{ 0 };				// metadata entries read with retries during the window
+			bool mdc_thrash{ false };
+			bool bypass_storm{ false };
+		};
+
+		// called (on the sampling thread) for every sample that crosses a threshold
+		typedef void (*AlertCallback)(const FileMetrics& metrics, const Sample& sample, void* data);
+
+		// keeps a handle to file for as long as it exists; at most max_samples are kept
+		FileMetrics(const File& file, const Thresholds& thresholds = Thresholds(), size_t max_samples = 1024);
+		FileMetrics(const FileMetrics&) = delete;
+		FileMetrics& operator=(const FileMetrics&) = delete;
+		virtual ~FileMetrics();
+
+		// Starts sampling every interval_ms on a background thread
+		// fails if the HDF5 library is not thread-safe or sampling is already running
+		bool Start(unsigned int interval_ms);
+
+		// Stops the background thread
+		void Stop();
+
+		// Takes a sample on the calling thread, appends it to the series and resets the file's counters
+		bool SampleNow(Sample& sample);
+
+		// Sets the function called for samples that cross a threshold
+		void SetAlertCallback(AlertCallback cb, void* data);
+
+		// Retrieves the samples taken so far, oldest first
+		void GetSamples(std::vector<Sample>& samples) const;
+
+		// Formats the series as JSON (one object per sample) / writes it to a file (replacing it)
+		std::string ToJSON() const;
+		bool ExportJSON(const char* filename) const;
+
+	protected:
+		void Run(unsigned int interval_ms);
+
+		File m_file;
+		Thresholds m_thresholds;
+		size_t m_maxSamples;
+		std::chrono::steady_clock::time_point m_origin;
+		uint64_t m_lastRetries{ 0 };
+		AlertCallback m_alert{ nullptr };
+		void* m_alertData{ nullptr };
+
+		mutable std::mutex m_lock;			// guards the series and the sampling state
+		std::deque<Sample> m_samples;
+
+		std::mutex m_runLock;				// guards m_stop, with m_wake
+		std::condition_variable m_wake;
+		bool m_stop{ false };
+		std::thread m_thread;
+	};
+}
@@ -0,0 +1,425 @@
+#include "pch.h"
+#include "hdf5pp_filter.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <utility>
+
+#ifdef HDF5PP_WITH_LZ4
+#include <lz4.h>
+#endif
+#ifdef HDF5PP_WITH_ZSTD
+#include <zstd.h>
+#include <zstd_errors.h>
+#endif
+
+namespace HDF5 {
+
+	namespace {
+
+		// the callbacks of H5Z_class2_t do not get the filter identifier, so every registered filter takes a slot
+		// with callbacks of its own
+		struct Slot {
+			std::shared_ptr<const Filter> filter;
+			std::string name;				// referenced by the registered class
+		};
+
+		std::mutex g_slotsMutex;
+		std::array<Slot, Filter::MaxRegistered> g_slots;
+
+		std::shared_ptr<const Filter> GetFilter(size_t slot)
+		{
+			std::lock_guard<std::mutex> lock(g_slotsMutex);
+			return g_slots[slot].filter;
+		}
+
+		size_t RunFilter(size_t slot, unsigned int flags, size_t cd_nelmts, const unsigned int cd_values[], size_t nbytes, size_t* buf_size, void** buf)
+		{
+			auto filter = GetFilter(slot);
+			if (!filter) {
+				return 0;
+			}
+			Filter::Buffer out;
+			try {
+				auto ok = (flags & H5Z_FLAG_REVERSE) != 0 ?
+					filter->Decode(cd_values, cd_nelmts, *buf, nbytes, out) :
+					filter->Encode(cd_values, cd_nelmts, *buf, nbytes, out);
+				if (!ok) {
+					return 0;
+				}
+			}
+			catch (...) {
+				return 0;
+			}
+			auto size = out.GetSize();
+			H5free_memory(*buf);
+			*buf = out.Release();
+			*buf_size = size;
+			return size;
+		}
+
+		htri_t RunCanApply(size_t slot, hid_t dcpl_id, hid_t type_id, hid_t space_id)
+		{
+			auto filter = GetFilter(slot);
+			try {
+				return filter && filter->CanApply(dcpl_id, type_id, space_id) ? 1 : 0;
+			}
+			catch (...) {
+				return -1;
+			}
+		}
+
+		herr_t RunSetLocal(size_t slot, hid_t dcpl_id, hid_t type_id, hid_t space_id)
+		{
+			auto filter = GetFilter(slot);
+			try {
+				return filter && filter->SetLocal(dcpl_id, type_id, space_id) ? 0 : -1;
+			}
+			catch (...) {
+				return -1;
+			}
+		}
+
+		template <size_t I>
+		size_t FilterFunc(unsigned int flags, size_t cd_nelmts, const unsigned int cd_values[], size_t nbytes, size_t* buf_size, void** buf)
+		{
+			return RunFilter(I, flags, cd_nelmts, cd_values, nbytes, buf_size, buf);
+		}
+
+		template <size_t I>
+		htri_t CanApplyFunc(hid_t dcpl_id, hid_t type_id, hid_t space_id)
+		{
+			return RunCanApply(I, dcpl_id, type_id, space_id);
+		}
+
+		template <size_t I>
+		herr_t SetLocalFunc(hid_t dcpl_id, hid_t type_id, hid_t space_id)
+		{
+			return RunSetLocal(I, dcpl_id, type_id, space_id);
+		}
+
+		struct SlotCallbacks {
+			H5Z_func_t filter;
+			H5Z_can_apply_func_t can_apply;
+			H5Z_set_local_func_t set_local;
+		};
+
+		template <size_t... I>
+		std::array<SlotCallbacks, sizeof...(I)> MakeCallbacks(std::index_sequence<I...>)
+		{
+			return { { { FilterFunc<I>, CanApplyFunc<I>, SetLocalFunc<I> }... } };
+		}
+
+		const std::array<SlotCallbacks, Filter::MaxRegistered> g_callbacks = MakeCallbacks(std::make_index_sequence<Filter::MaxRegistered>());
+
+#ifdef HDF5PP_WITH_LZ4
+		// the chunk format of the HDF5 LZ4 plugin is big endian
+		void PutBE32(uint8_t* p, uint32_t v)
+		{
+			p[0] = (uint8_t)(v >> 24);
+			p[1] = (uint8_t)(v >> 16);
+			p[2] = (uint8_t)(v >> 8);
+			p[3] = (uint8_t)v;
+		}
+
+		uint32_t GetBE32(const uint8_t* p)
+		{
+			return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+		}
+
+		const size_t LZ4HeaderSize = 12;				// original size (64 bits), block size (32 bits)
+		const size_t LZ4DefaultBlockSize = 1 << 30;
+#endif
+	}
+
+	Filter::Buffer::~Buffer()
+	{
+		if (m_data != nullptr) {
+			H5free_memory(m_data);
+		}
+	}
+
+	bool Filter::Buffer::Resize(size_t size)
+	{
+		if (size == 0) {
+			H5free_memory(m_data);
+			m_data = nullptr;
+			m_size = 0;
+			return true;
+		}
+		auto data = H5resize_memory(m_data, size);
+		if (data == nullptr) {
+			return false;
+		}
+		m_data = data;
+		m_size = size;
+		return true;
+	}
+
+	void* Filter::Buffer::Release()
+	{
+		auto data = m_data;
+		m_data = nullptr;
+		m_size = 0;
+		return data;
+	}
+
+	bool Filter::CanApply(hid_t /*dcpl_id*/, hid_t /*type_id*/, hid_t /*space_id*/) const
+	{
+		return true;
+	}
+
+	bool Filter::SetLocal(hid_t /*dcpl_id*/, hid_t /*type_id*/, hid_t /*space_id*/) const
+	{
+		return true;
+	}
+
+	bool Filter::GetParameters(hid_t dcpl_id, H5Z_filter_t id, unsigned int& flags, std::vector<unsigned int>& cd_values)
+	{
+		cd_values.resize(16);
+		for (;;) {
+			auto cd_nelmts = cd_values.size();
+			unsigned int config{ 0 };
+			if (H5Pget_filter_by_id2(dcpl_id, id, &flags, &cd_nelmts, cd_values.data(), 0, nullptr, &config) < 0) {
+				return false;
+			}
+			// cd_nelmts is the number of parameters the filter has, which may be more than fitted
+			if (cd_nelmts <= cd_values.size()) {
+				cd_values.resize(cd_nelmts);
+				return true;
+			}
+			cd_values.resize(cd_nelmts);
+		}
+	}
+
+	bool Filter::SetParameters(hid_t dcpl_id, H5Z_filter_t id, unsigned int flags, const std::vector<unsigned int>& cd_values)
+	{
+		return H5Pmodify_filter(dcpl_id, id, flags, cd_values.size(), cd_values.data()) >= 0;
+	}
+
+	bool Filter::Register(std::shared_ptr<const Filter> filter)
+	{
+		if (!filter) {
+			return false;
+		}
+		// the slot is taken under the lock, which is released before H5Zregister: the callbacks take it too, with
+		// the library lock of a thread-safe HDF5 held
+		auto id = filter->GetID();
+		size_t slot;
+		std::shared_ptr<const Filter> previous;
+		std::string previousName;
+		const char* name;
+		{
+			std::lock_guard<std::mutex> lock(g_slotsMutex);
+			auto it = std::find_if(g_slots.begin(), g_slots.end(), [id](const Slot& s) { return s.filter && s.filter->GetID() == id; });
+			if (it == g_slots.end()) {
+				it = std::find_if(g_slots.begin(), g_slots.end(), [](const Slot& s) { return !s.filter; });
+				if (it == g_slots.end()) {
+					return false;
+				}
+			}
+			slot = (size_t)std::distance(g_slots.begin(), it);
+			previous = std::move(it->filter);
+			previousName = std::move(it->name);
+			it->filter = filter;
+			it->name = filter->GetName();
+			name = it->name.c_str();
+		}
+		auto& callbacks = g_callbacks[slot];
+
+		H5Z_class2_t cls{};
+		cls.version = H5Z_CLASS_T_VERS;
+		cls.id = id;
+		cls.encoder_present = 1;
+		cls.decoder_present = 1;
+		cls.name = name;
+		cls.can_apply = callbacks.can_apply;
+		cls.set_local = callbacks.set_local;
+		cls.filter = callbacks.filter;
+		if (H5Zregister(&cls) < 0) {
+			std::lock_guard<std::mutex> lock(g_slotsMutex);
+			auto& s = g_slots[slot];
+			if (s.filter == filter) {
+				s.filter = std::move(previous);
+				s.name = std::move(previousName);
+			}
+			return false;
+		}
+		return true;
+	}
+
+	bool Filter::Unregister(H5Z_filter_t id)
+	{
+		if (H5Zunregister(id) < 0) {
+			return false;
+		}
+		std::lock_guard<std::mutex> lock(g_slotsMutex);
+		for (auto& s : g_slots) {
+			if (s.filter && s.filter->GetID() == id) {
+				s.filter.reset();
+			}
+		}
+		return true;
+	}
+
+	bool LZ4Filter::IsAvailable()
+	{
+#ifdef HDF5PP_WITH_LZ4
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	const char* LZ4Filter::GetName() const
+	{
+		return "HDF5 lz4 filter; see http://www.hdfgroup.org/services/contributions.html";
+	}
+
+	bool LZ4Filter::SetLocal(hid_t /*dcpl_id*/, hid_t /*type_id*/, hid_t /*space_id*/) const
+	{
+		return IsAvailable();
+	}
+
+#ifdef HDF5PP_WITH_LZ4
+	bool LZ4Filter::Encode(const unsigned int* cd_values, size_t cd_nelmts, const void* in, size_t size, Buffer& out) const
+	{
+		size_t block = cd_nelmts > 0 && cd_values[0] > 0 ? cd_values[0] : LZ4DefaultBlockSize;
+		block = std::max<size_t>(std::min<size_t>({ block, size, (size_t)LZ4_MAX_INPUT_SIZE }), 1);
+		auto blocks = (size + block - 1) / block;
+		if (!out.Resize(LZ4HeaderSize + blocks * (4 + (size_t)LZ4_compressBound((int)block)))) {
+			return false;
+		}
+		auto src = (const char*)in;
+		auto dst = (uint8_t*)out.GetData();
+		PutBE32(dst, (uint32_t)((uint64_t)size >> 32));
+		PutBE32(dst + 4, (uint32_t)size);
+		PutBE32(dst + 8, (uint32_t)block);
+		dst += LZ4HeaderSize;
+		for (size_t offset = 0; offset < size; offset += block) {
+			auto n = (int)std::min(block, size - offset);
+			auto c = LZ4_compress_default(src + offset, (char*)dst + 4, n, LZ4_compressBound(n));
+			// blocks that do not shrink are stored as they are
+			if (c <= 0 || c >= n) {
+				memcpy(dst + 4, src + offset, (size_t)n);
+				c = n;
+			}
+			PutBE32(dst, (uint32_t)c);
+			dst += 4 + c;
+		}
+		return out.Resize((size_t)(dst - (uint8_t*)out.GetData()));
+	}
+
+	bool LZ4Filter::Decode(const unsigned int* /*cd_values*/, size_t /*cd_nelmts*/, const void* in, size_t size, Buffer& out) const
+	{
+		if (size < LZ4HeaderSize) {
+			return false;
+		}
+		auto src = (const uint8_t*)in;
+		auto end = src + size;
+		auto total = ((uint64_t)GetBE32(src) << 32) | GetBE32(src + 4);
+		size_t block = GetBE32(src + 8);
+		src += LZ4HeaderSize;
+		if (block == 0 || total > SIZE_MAX || !out.Resize((size_t)total)) {
+			return false;
+		}
+		auto dst = (char*)out.GetData();
+		for (size_t offset = 0; offset < total; offset += block) {
+			auto n = std::min<size_t>(block, (size_t)total - offset);
+			if (end - src < 4) {
+				return false;
+			}
+			size_t c = GetBE32(src);
+			src += 4;
+			if ((size_t)(end - src) < c) {
+				return false;
+			}
+			if (c == n) {
+				memcpy(dst + offset, src, n);
+			}
+			else if (LZ4_decompress_safe((const char*)src, dst + offset, (int)c, (int)n) != (int)n) {
+				return false;
+			}
+			src += c;
+		}
+		return true;
+	}
+#else
+	bool LZ4Filter::Encode(const unsigned int* /*cd_values*/, size_t /*cd_nelmts*/, const void* /*in*/, size_t /*size*/, Buffer& /*out*/) const
+	{
+		return false;
+	}
+
+	bool LZ4Filter::Decode(const unsigned int* /*cd_values*/, size_t /*cd_nelmts*/, const void* /*in*/, size_t /*size*/, Buffer& /*out*/) const
+	{
+		return false;
+	}
+#endif
+
+	bool ZstdFilter::IsAvailable()
+	{
+#ifdef HDF5PP_WITH_ZSTD
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	const char* ZstdFilter::GetName() const
+	{
+		return "Zstandard compression: http://www.zstd.net";
+	}
+
+	bool ZstdFilter::SetLocal(hid_t /*dcpl_id*/, hid_t /*type_id*/, hid_t /*space_id*/) const
+	{
+		return IsAvailable();
+	}
+
+#ifdef HDF5PP_WITH_ZSTD
+	bool ZstdFilter::Encode(const unsigned int* cd_values, size_t cd_nelmts, const void* in, size_t size, Buffer& out) const
+	{
+		auto level = cd_nelmts > 0 ? (int)cd_values[0] : 3;
+		if (!out.Resize(ZSTD_compressBound(size))) {
+			return false;
+		}
+		auto n = ZSTD_compress(out.GetData(), out.GetSize(), in, size, level);
+		return !ZSTD_isError(n) && out.Resize(n);
+	}
+
+	bool ZstdFilter::Decode(const unsigned int* /*cd_values*/, size_t /*cd_nelmts*/, const void* in, size_t size, Buffer& out) const
+	{
+		auto content = ZSTD_getFrameContentSize(in, size);
+		if (content == ZSTD_CONTENTSIZE_ERROR || (content != ZSTD_CONTENTSIZE_UNKNOWN && content > SIZE_MAX)) {
+			return false;
+		}
+		// frames written without their size are decompressed into a growing buffer
+		auto capacity = content != ZSTD_CONTENTSIZE_UNKNOWN ? (size_t)content : std::max<size_t>(size * 4, 4096);
+		for (;;) {
+			if (!out.Resize(std::max<size_t>(capacity, 1))) {
+				return false;
+			}
+			auto n = ZSTD_decompress(out.GetData(), out.GetSize(), in, size);
+			if (!ZSTD_isError(n)) {
+				return out.Resize(n);
+			}
+			if (content != ZSTD_CONTENTSIZE_UNKNOWN || ZSTD_getErrorCode(n) != ZSTD_error_dstSize_tooSmall || capacity > SIZE_MAX / 2) {
+				return false;
+			}
+			capacity *= 2;
+		}
+	}
+#else
+	bool ZstdFilter::Encode(const unsigned int* /*cd_values*/, size_t /*cd_nelmts*/, const void* /*in*/, size_t /*size*/, Buffer& /*out*/) const
+	{
+		return false;
+	}
+
+	bool ZstdFilter::Decode(const unsigned int* /*cd_values*/, size_t /*cd_nelmts*/, const void* /*in*/, size_t /*size*/, Buffer& /*out*/) const
+	{
+		return false;
+	}
+#endif
+}
@@ -0,0 +1,116 @@
+// hdf5pp_filter.h
+// HDF5::Filter is the base class of data filters written in C++: Encode and Decode transform one chunk, CanApply
+// and SetLocal check and complete the filter parameters when a dataset is created; Library::RegisterFilter adapts
+// a filter to an H5Z_class2_t registered under its identifier
+// filters must not throw (exceptions are caught and reported as failures) and may be called from any thread, one
+// call at a time per dataset, so Encode and Decode should not keep state
+// LZ4Filter and ZstdFilter use the identifiers registered with The HDF Group for LZ4 and Zstandard and write the
+// same chunk format as the HDF5 plugins of these codecs, so files stay readable by other software; they work only
+// when the library is built with HDF5PP_WITH_LZ4 / HDF5PP_WITH_ZSTD defined (see IsAvailable): otherwise creating
+// a dataset that uses them fails, and they should not be registered, so that the plugins can read such datasets
+//
+#pragma once
+
+#include "hdf5pp_api.h"
+
+#include <memory>
+
+namespace HDF5 {
+
+	class HDF5PP_API Filter
+	{
+	public:
+		// output buffer of Encode and Decode; its memory comes from the HDF5 library, which takes it over
+		class HDF5PP_API Buffer
+		{
+		public:
+			Buffer() = default;
+			Buffer(const Buffer&) = delete;
+			Buffer& operator=(const Buffer&) = delete;
+			~Buffer();
+
+			// Resizes the buffer, keeping its contents up to the smaller size
+			bool Resize(size_t size);
+
+			void* GetData() { return m_data; }
+			size_t GetSize() const { return m_size; }
+
+			// Gives up the memory, for the library to own
+			void* Release();
+		private:
+			void* m_data{ nullptr };
+			size_t m_size{ 0 };
+		};
+
+		Filter() = default;
+		Filter(const Filter&) = delete;
+		Filter& operator=(const Filter&) = delete;
+		virtual ~Filter() = default;
+
+		// Returns the filter identifier (256-511 for testing, 32000 and above when registered with The HDF Group);
+		// datasets written with a testing identifier can only be read where the same filter is registered
+		virtual H5Z_filter_t GetID() const = 0;
+
+		// Returns the filter name, as reported in the filter pipeline of datasets
+		virtual const char* GetName() const = 0;
+
+		// Transforms size bytes of in with the parameters cd_values into out, when a chunk is written (Encode) or
+		// read (Decode); failing Encode leaves the chunk unfiltered if the filter is optional in the pipeline
+		virtual bool Encode(const unsigned int* cd_values, size_t cd_nelmts, const void* in, size_t size, Buffer& out) const = 0;
+		virtual bool Decode(const unsigned int* cd_values, size_t cd_nelmts, const void* in, size_t size, Buffer& out) const = 0;
+
+		// Returns whether the filter can be applied to a dataset of datatype type_id and dataspace space_id
+		// created with dcpl_id; the default accepts any dataset
+		virtual bool CanApply(hid_t dcpl_id, hid_t type_id, hid_t space_id) const;
+
+		// Completes the filter parameters in dcpl_id for a dataset of type_id and space_id, e.g. with the element
+		// size (see GetParameters and SetParameters); the default keeps them
+		// the library does not call CanApply for a filter that is optional in the pipeline, but failing SetLocal
+		// fails the creation of the dataset, so an optional filter should check CanApply here and set parameters
+		// that make Encode leave the chunks of a dataset it cannot handle as they are
+		virtual bool SetLocal(hid_t dcpl_id, hid_t type_id, hid_t space_id) const;
+
+		// Gets/Sets the flags and parameters of filter id in the pipeline of dcpl_id
+		static bool GetParameters(hid_t dcpl_id, H5Z_filter_t id, unsigned int& flags, std::vector<unsigned int>& cd_values);
+		static bool SetParameters(hid_t dcpl_id, H5Z_filter_t id, unsigned int flags, const std::vector<unsigned int>& cd_values);
+
+		// Registers filter with the library, replacing any filter of the same identifier; the library keeps a
+		// reference until the filter is unregistered; at most MaxRegistered filters are registered at a time
+		static bool Register(std::shared_ptr<const Filter> filter);
+		static bool Unregister(H5Z_filter_t id);
+
+		static const size_t MaxRegistered = 16;
+	};
+
+	// LZ4 filter, cd_values[0] is the block size in bytes (0 or none: 1 GiB)
+	class HDF5PP_API LZ4Filter : public Filter
+	{
+	public:
+		static const H5Z_filter_t ID = 32004;
+
+		// Returns true if the library was built with HDF5PP_WITH_LZ4
+		static bool IsAvailable();
+
+		H5Z_filter_t GetID() const override { return ID; }
+		const char* GetName() const override;
+		bool Encode(const unsigned int* cd_values, size_t cd_nelmts, const void* in, size_t size, Buffer& out) const override;
+		bool Decode(const unsigned int* cd_values, size_t cd_nelmts, const void* in, size_t size, Buffer& out) const override;
+		bool SetLocal(hid_t dcpl_id, hid_t type_id, hid_t space_id) const override;
+	};
+
+	// Zstandard filter, cd_values[0] is the compression level (none: 3)
+	class HDF5PP_API ZstdFilter : public Filter
+	{
+	public:
+		static const H5Z_filter_t ID = 32015;
+
+		// Returns true if the library was built with HDF5PP_WITH_ZSTD
+		static bool IsAvailable();
+
+		H5Z_filter_t GetID() const override { return ID; }
+		const char* GetName() const override;
+		bool Encode(const unsigned int* cd_values, size_t cd_nelmts, const void* in, size_t size, Buffer& out) const override;
+		bool Decode(const unsigned int* cd_values, size_t cd_nelmts, const void* in, size_t size, Buffer& out) const override;
+		bool SetLocal(hid_t dcpl_id, hid_t type_id, hid_t space_id) const override;
+	};
+}
@@ -20,6 +20,7 @@ namespace HDF5 {
 	Group& Group::operator=(const Group& rhs)
 	{
 		if (this != &rhs) {
+			ClearAttributeCache();
 			DecrementReferenceCount();
 			m_hID = rhs.m_hID;
 			IncrementReferenceCount();
@@ -31,6 +32,7 @@ namespace HDF5 {
 	{
 		if (hid >= 0) {
 			if (H5I_GROUP == H5Iget_type(hid)) {
+				ClearAttributeCache();
 				if (m_hID >= 0) {
 					H5Gclose(m_hID);
 				}
@@ -42,6 +44,7 @@ namespace HDF5 {
 			}
 		}
 		else {
+			ClearAttributeCache();
 			if (m_hID >= 0) {
 				H5Gclose(m_hID);
 			}
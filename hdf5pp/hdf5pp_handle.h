@@ -26,7 +26,7 @@ namespace HDF5 {
 
 		// release ownership of indentifier; user should close it using the
 		// appropriate C-API function
-		hid_t Detach();
+		virtual hid_t Detach();
 
 		// casting does not increment reference count; 
 		// user should not close the handle with any C-API functions
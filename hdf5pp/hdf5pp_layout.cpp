@@ -0,0 +1,175 @@
+#include "pch.h"
+#include "hdf5pp_layout.h"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <set>
+
+namespace HDF5 {
+
+	namespace {
+
+		struct Registry {
+			std::mutex lock;
+			std::shared_ptr<const LayoutPolicy> default_policy{ std::make_shared<LayoutPolicy>() };
+			std::map<unsigned long, std::shared_ptr<const LayoutPolicy>> files;		// by file number
+		};
+
+		Registry& GetRegistry()
+		{
+			static Registry registry;
+			return registry;
+		}
+
+		// drops the policies of files that are no longer open: under the weak close degree, a file stays open after
+		// its last identifier is closed for as long as objects of it are
+		void DropClosedFiles(std::map<unsigned long, std::shared_ptr<const LayoutPolicy>>& files)
+		{
+			auto count = H5Fget_obj_count(H5F_OBJ_ALL, H5F_OBJ_ALL);
+			if (count <= 0) {
+				return;
+			}
+			std::vector<hid_t> ids((size_t)count);
+			count = H5Fget_obj_ids(H5F_OBJ_ALL, H5F_OBJ_ALL, ids.size(), ids.data());
+			if (count < 0) {
+				return;
+			}
+			std::set<unsigned long> open;
+			for (ssize_t i = 0; i < count; ++i) {
+				unsigned long fileno{ 0 };
+				auto file_id = H5Iget_file_id(ids[i]);
+				if (file_id >= 0) {
+					if (H5Fget_fileno(file_id, &fileno) >= 0) {
+						open.insert(fileno);
+					}
+					H5Fclose(file_id);
+				}
+			}
+			for (auto it = files.begin(); it != files.end();) {
+				it = open.count(it->first) > 0 ? std::next(it) : files.erase(it);
+			}
+		}
+	}
+
+	LayoutPolicy::LayoutPolicy(const Thresholds& thresholds /*= Thresholds()*/)
+		: m_thresholds(thresholds)
+	{
+	}
+
+	LayoutPolicy::~LayoutPolicy()
+	{
+	}
+
+	bool LayoutPolicy::Apply(const std::vector<hsize_t>& dims, const std::vector<hsize_t>& max_dims, size_t elem_size, DatasetCreationPropertyList& dcpl) const
+	{
+		hsize_t bytes = elem_size;
+		for (auto d : dims) {
+			bytes *= d;
+		}
+		bool extendable = !max_dims.empty() && max_dims != dims;
+		if (!extendable && bytes <= m_thresholds.compact_max_bytes) {
+			return dcpl.SetLayout(DatasetCreationPropertyList::Layout::Compact);
+		}
+		if (!extendable && bytes < m_thresholds.chunked_min_bytes) {
+			// the data is written right after creation: filling first would write it twice
+			return dcpl.SetLayout(DatasetCreationPropertyList::Layout::Contiguous) &&
+				dcpl.SetAllocTime(DatasetCreationPropertyList::AllocTime::Late) &&
+				dcpl.SetFillTime(DatasetCreationPropertyList::FillTime::Never);
+		}
+		if (!dcpl.SetChunk(ChunkDims(dims, max_dims, elem_size, m_thresholds.chunk_bytes)) ||
+			!dcpl.SetFillTime(DatasetCreationPropertyList::FillTime::Never)) {
+			return false;
+		}
+		if (m_thresholds.deflate_level >= 0) {
+			if (m_thresholds.shuffle && elem_size > 1 && !dcpl.SetShuffle()) {
+				return false;
+			}
+			return dcpl.SetDeflate((unsigned int)std::min(m_thresholds.deflate_level, 9));
+		}
+		return true;
+	}
+
+	std::vector<hsize_t> LayoutPolicy::ChunkDims(const std::vector<hsize_t>& dims, const std::vector<hsize_t>& max_dims, size_t elem_size, size_t chunk_bytes)
+	{
+		std::vector<hsize_t> chunk(dims.size(), 1);
+		hsize_t elems = std::max<hsize_t>(1, chunk_bytes / std::max<size_t>(elem_size, 1));
+		hsize_t inner{ 1 };		// elements in the dimensions after i
+		for (size_t i = dims.size(); i-- > 0;) {
+			// an extendable dimension may grow past its current size
+			auto limit = (i < max_dims.size() && max_dims[i] != dims[i]) ? (max_dims[i] == H5S_UNLIMITED ? elems : max_dims[i]) : dims[i];
+			chunk[i] = std::max<hsize_t>(1, std::min(limit, elems / inner));
+			inner *= chunk[i];
+		}
+		return chunk;
+	}
+
+	void LayoutPolicy::SetDefault(std::shared_ptr<const LayoutPolicy> policy)
+	{
+		auto& registry = GetRegistry();
+		std::lock_guard<std::mutex> guard(registry.lock);
+		registry.default_policy = policy;
+	}
+
+	std::shared_ptr<const LayoutPolicy> LayoutPolicy::GetDefault()
+	{
+		auto& registry = GetRegistry();
+		std::lock_guard<std::mutex> guard(registry.lock);
+		return registry.default_policy;
+	}
+
+	void LayoutPolicy::SetForFile(unsigned long fileno, std::shared_ptr<const LayoutPolicy> policy)
+	{
+		auto& registry = GetRegistry();
+		std::lock_guard<std::mutex> guard(registry.lock);
+		if (policy) {
+			if (!registry.files.empty()) {
+				DropClosedFiles(registry.files);
+			}
+			registry.files[fileno] = policy;
+		}
+		else {
+			registry.files.erase(fileno);
+		}
+	}
+
+	std::shared_ptr<const LayoutPolicy> LayoutPolicy::GetForFile(unsigned long fileno)
+	{
+		auto& registry = GetRegistry();
+		std::lock_guard<std::mutex> guard(registry.lock);
+		auto it = registry.files.find(fileno);
+		return it != registry.files.end() ? it->second : nullptr;
+	}
+
+	std::shared_ptr<const LayoutPolicy> LayoutPolicy::Find(hid_t loc_id)
+	{
+		auto& registry = GetRegistry();
+		std::lock_guard<std::mutex> guard(registry.lock);
+		if (!registry.files.empty()) {
+			unsigned long fileno{ 0 };
+			auto file_id = H5Iget_file_id(loc_id);
+			auto found = file_id >= 0 && H5Fget_fileno(file_id, &fileno) >= 0;
+			if (file_id >= 0) {
+				H5Fclose(file_id);
+			}
+			auto it = found ? registry.files.find(fileno) : registry.files.end();
+			if (it != registry.files.end()) {
+				return it->second;
+			}
+		}
+		return registry.default_policy;
+	}
+
+	DatasetCreationPropertyList LayoutPolicy::CreationPropertyList(hid_t loc_id, const std::vector<hsize_t>& dims, size_t elem_size)
+	{
+		auto policy = Find(loc_id);
+		if (policy) {
+			DatasetCreationPropertyList dcpl;
+			if (policy->Apply(dims, std::vector<hsize_t>(), elem_size, dcpl)) {
+				return dcpl;
+			}
+			// a rule the library rejects falls back to its defaults
+		}
+		return DatasetCreationPropertyList();
+	}
+}
@@ -0,0 +1,61 @@
+// hdf5pp_layout.h
+// HDF5::LayoutPolicy chooses the storage of the datasets created by Location::AddDataset from their size:
+// small ones are compact (stored in the object header, no separate raw data I/O), mid-size ones contiguous,
+// allocated when written and never filled, large or extendable ones chunked by chunks of about chunk_bytes,
+// optionally compressed
+// a policy applies to a file when set with File::SetLayoutPolicy, otherwise the default policy (SetDefault)
+// applies; derive from LayoutPolicy and override Apply for other rules
+//
+#pragma once
+
+#include "hdf5pp_proplist.h"
+
+#include <memory>
+#include <vector>
+
+namespace HDF5 {
+
+	class HDF5PP_API LayoutPolicy
+	{
+	public:
+		struct Thresholds {
+			Thresholds() : compact_max_bytes(4096), chunked_min_bytes(64 * 1024 * 1024), chunk_bytes(1024 * 1024), deflate_level(-1), shuffle(false) {}
+
+			size_t compact_max_bytes;	// compact up to this size; the object header limits it to less than 64 KiB
+			hsize_t chunked_min_bytes;	// chunked from this size on; contiguous in between
+			size_t chunk_bytes;			// target size of a chunk
+			int deflate_level;			// 0-9: deflate chunked datasets; -1: no compression
+			bool shuffle;				// shuffle before deflate
+		};
+
+		explicit LayoutPolicy(const Thresholds& thresholds = Thresholds());
+		virtual ~LayoutPolicy();
+
+		// Sets the storage of a dataset of dims elements of elem_size bytes in dcpl; max_dims is empty for a dataset
+		// that cannot be extended
+		virtual bool Apply(const std::vector<hsize_t>& dims, const std::vector<hsize_t>& max_dims, size_t elem_size, DatasetCreationPropertyList& dcpl) const;
+
+		const Thresholds& GetThresholds() const { return m_thresholds; }
+
+		// Returns chunk dims of about chunk_bytes: the last dimensions whole, the first ones split
+		static std::vector<hsize_t> ChunkDims(const std::vector<hsize_t>& dims, const std::vector<hsize_t>& max_dims, size_t elem_size, size_t chunk_bytes);
+
+		// Sets/Gets the policy of the files that have none of their own; nullptr for the library defaults
+		static void SetDefault(std::shared_ptr<const LayoutPolicy> policy);
+		static std::shared_ptr<const LayoutPolicy> GetDefault();
+
+		// Returns the policy that applies to the file of loc_id, nullptr if none
+		static std::shared_ptr<const LayoutPolicy> Find(hid_t loc_id);
+
+		// Returns the creation property list for a dataset of dims elements of elem_size bytes in the file of loc_id
+		static DatasetCreationPropertyList CreationPropertyList(hid_t loc_id, const std::vector<hsize_t>& dims, size_t elem_size);
+
+	protected:
+		// sets/clears the policy of the file with file number fileno
+		static void SetForFile(unsigned long fileno, std::shared_ptr<const LayoutPolicy> policy);
+		static std::shared_ptr<const LayoutPolicy> GetForFile(unsigned long fileno);
+		friend class File;
+
+		Thresholds m_thresholds;
+	};
+}
@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "hdf5pp_library.h"
+#include "hdf5pp_filter.h"
 
 namespace HDF5 {
 
@@ -104,9 +105,14 @@ namespace HDF5 {
 		return H5Zregister(&filter_class) >= 0;
 	}
 
+	bool Library::RegisterFilter(std::shared_ptr<const Filter> filter)
+	{
+		return Filter::Register(filter);
+	}
+
 	bool Library::UnregisterFilter(H5Z_filter_t filter)
 	{
-		return H5Zunregister(filter) >= 0;
+		return Filter::Unregister(filter);
 	}
 
 	bool Library::AppendPluginSearchPath(const char* plugin_path)
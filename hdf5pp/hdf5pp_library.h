@@ -2,8 +2,12 @@
 
 #include "hdf5pp_api.h"
 
+#include <memory>
+
 namespace HDF5 {
 
+	class Filter;
+
 	class HDF5PP_API Library
 	{
 	public:
@@ -61,7 +65,10 @@ namespace HDF5 {
 		// Register a filter
 		static bool RegisterFilter(const H5Z_class2_t& filter_class);
 
-		// Unregister a filter
+		// Register a filter written in C++ (see hdf5pp_filter.h)
+		static bool RegisterFilter(std::shared_ptr<const Filter> filter);
+
+		// Unregister a filter, C or C++
 		static bool UnregisterFilter(H5Z_filter_t filter);
 
 		// Insert a plugin path at the end of the list
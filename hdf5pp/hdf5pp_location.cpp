@@ -7,6 +7,8 @@
 #include "hdf5pp_dspace.h"
 #include "hdf5pp_dtype.h"
 #include "hdf5pp_attrobj.h"
+#include "hdf5pp_layout.h"
+#include "hdf5pp_probe.h"
 
 namespace HDF5 {
 
@@ -245,6 +247,7 @@ namespace HDF5 {
 
 	Datatype Location::OpenDatatype(const char* name, const PropertyList& tapl /*= PropertyList()*/)
 	{
+		HDF5PP_PROBE_NAME(OpenDatatype, name);
 		return Datatype(H5Topen2(m_hID, name, (hid_t)tapl));
 	}
 
@@ -323,21 +326,25 @@ namespace HDF5 {
 
 	Object Location::OpenObject(const char* name, const PropertyList& lapl /*= PropertyList()*/)
 	{
+		HDF5PP_PROBE_NAME(OpenObject, name);
 		return Object(H5Oopen(m_hID, name, (hid_t)lapl));
 	}
 
 	Object Location::OpenObject(haddr_t addr)
 	{
+		HDF5PP_PROBE(OpenObject);
 		return Object(H5Oopen_by_addr(m_hID, addr));
 	}
 
 	Object Location::OpenObject(const char* group_name, IndexType tIndex, OrderType tOrder, hsize_t nOffset, const PropertyList& lapl /*= PropertyList()*/)
 	{
+		HDF5PP_PROBE_NAME(OpenObject, group_name);
 		return Object(H5Oopen_by_idx(m_hID, group_name, (H5_index_t)tIndex, (H5_iter_order_t)tOrder, nOffset, (hid_t)lapl));
 	}
 
 	HDF5::Object Location::OpenObject(H5O_token_t token)
 	{
+		HDF5PP_PROBE(OpenObject);
 		return Object(H5Oopen_by_token(m_hID, token));
 	}
 
@@ -501,11 +508,13 @@ namespace HDF5 {
 
 	Group Location::CreateGroup(const char* group_name, const PropertyList& lcpl /*= PropertyList()*/, const PropertyList& gcpl /*= PropertyList()*/, const PropertyList& gapl /*= PropertyList()*/)
 	{
+		HDF5PP_PROBE_NAME(CreateGroup, group_name);
 		return Group(H5Gcreate2(m_hID, group_name, (hid_t)lcpl, (hid_t)gcpl, (hid_t)gapl));
 	}
 
 	Group Location::CreateGroup(const PropertyList& gcpl /*= PropertyList()*/, const PropertyList& gapl /*= PropertyList()*/)
 	{
+		HDF5PP_PROBE(CreateGroup);
 		return Group(H5Gcreate_anon(m_hID, (hid_t)gcpl, (hid_t)gapl));
 	}
 
@@ -526,26 +535,31 @@ namespace HDF5 {
 
 	Group Location::OpenGroup(const char* group_name, const PropertyList& gapl /*= PropertyList()*/)
 	{
+		HDF5PP_PROBE_NAME(OpenGroup, group_name);
 		return Group(H5Gopen2(m_hID, group_name, (hid_t)gapl));
 	}
 
 	Dataset Location::CreateDataset(const char* dataset_name, const Datatype& dtype, const Dataspace& dspace, const PropertyList& lcpl /*= PropertyList()*/, const PropertyList& dcpl /*= PropertyList()*/, const PropertyList& dapl /*= PropertyList()*/)
 	{
+		HDF5PP_PROBE_NAME(CreateDataset, dataset_name);
 		return Dataset(H5Dcreate2(m_hID, dataset_name, (hid_t)dtype, (hid_t)dspace, (hid_t)lcpl, (hid_t)dcpl, (hid_t)dapl));
 	}
 
 	HDF5::Dataset Location::CreateDataset(const Datatype& dtype, const Dataspace& dspace, const PropertyList& dcpl /*= PropertyList()*/, const PropertyList& dapl /*= PropertyList()*/)
 	{
+		HDF5PP_PROBE(CreateDataset);
 		return Dataset(H5Dcreate_anon(m_hID, (hid_t)dtype, (hid_t)dspace, (hid_t)dcpl, (hid_t)dapl));
 	}
 
 	HDF5::Dataset Location::OpenDataset(const char* name, const PropertyList& dapl /*= PropertyList()*/)
 	{
+		HDF5PP_PROBE_NAME(OpenDataset, name);
 		return Dataset(H5Dopen2(m_hID, name, (hid_t)dapl));
 	}
 
 	bool Location::FlushFile(FlushScope scope)
 	{
+		HDF5PP_PROBE_OBJECT(FileFlush, m_hID);
 		return H5Fflush(m_hID, (H5F_scope_t)scope) >= 0;
 	}
 
@@ -571,7 +585,8 @@ namespace HDF5 {
 		return false;\
 	}\
 		\
-	Handle dset(H5Dcreate2(m_hID, name, (hid_t)y, (hid_t)dspace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT));\
+	auto dcpl = LayoutPolicy::CreationPropertyList(m_hID, dd, sizeof(x));\
+	Handle dset(H5Dcreate2(m_hID, name, (hid_t)y, (hid_t)dspace, H5P_DEFAULT, (hid_t)dcpl, H5P_DEFAULT));\
 	if (!dset.IsValid()) {\
 		return false;\
 	}\
@@ -590,8 +605,10 @@ namespace HDF5 {
 	ADDDSET(uint64_t, IntegerPDT::Native_UINT64)
 	ADDDSET(float, FloatPDT::Native_FLOAT)
 	ADDDSET(double, FloatPDT::Native_DOUBLE)
+#ifndef HDF5PP_LONG_IS_INT64
 	ADDDSET(long, IntegerPDT::Native_LONG)
 	ADDDSET(unsigned long, IntegerPDT::Native_ULONG)
+#endif
 
 #define ADDDSET2(x, y) bool Location::AddDataset(const char* name, const x* vals, size_t dim1, size_t dim2, size_t dim3, size_t dim4)\
 	{\
@@ -615,7 +632,8 @@ namespace HDF5 {
 		return false;\
 	}\
 \
-	Handle dset(H5Dcreate2(m_hID, name, (hid_t)y, (hid_t)dspace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT));\
+	auto dcpl = LayoutPolicy::CreationPropertyList(m_hID, dd, sizeof(x));\
+	Handle dset(H5Dcreate2(m_hID, name, (hid_t)y, (hid_t)dspace, H5P_DEFAULT, (hid_t)dcpl, H5P_DEFAULT));\
 	if (!dset.IsValid()) {\
 		return false;\
 	}\
@@ -634,8 +652,10 @@ namespace HDF5 {
 	ADDDSET2(uint64_t, IntegerPDT::Native_UINT64)
 	ADDDSET2(float, FloatPDT::Native_FLOAT)
 	ADDDSET2(double, FloatPDT::Native_DOUBLE)
+#ifndef HDF5PP_LONG_IS_INT64
 	ADDDSET2(long, IntegerPDT::Native_LONG)
 	ADDDSET2(unsigned long, IntegerPDT::Native_ULONG)
+#endif
 
 #undef ADDDSET
 #undef ADDDSET2
@@ -665,7 +685,9 @@ namespace HDF5 {
 		if (!dtype.SetSize(H5T_VARIABLE)) {
 			return false;
 		}
-		auto dset = CreateDataset(name, dtype, dspace);
+		// each string is stored as a global heap reference of about the size of an hvl_t
+		auto dcpl = LayoutPolicy::CreationPropertyList(m_hID, dims, sizeof(hvl_t));
+		auto dset = CreateDataset(name, dtype, dspace, PropertyList(), dcpl);
 		if (!dset.IsValid()) {
 			return false;
 		}
@@ -261,8 +261,10 @@ namespace HDF5 {
 		bool AddDataset(const char* name, const std::vector<uint64_t>& vals, const std::vector<size_t>& dims = std::vector<size_t>());
 		bool AddDataset(const char* name, const std::vector<float>& vals, const std::vector<size_t>& dims = std::vector<size_t>());
 		bool AddDataset(const char* name, const std::vector<double>& vals, const std::vector<size_t>& dims = std::vector<size_t>());
+#ifndef HDF5PP_LONG_IS_INT64
 		bool AddDataset(const char* name, const std::vector<long>& vals, const std::vector<size_t>& dims = std::vector<size_t>());
 		bool AddDataset(const char* name, const std::vector<unsigned long>& vals, const std::vector<size_t>& dims = std::vector<size_t>());
+#endif
 
 		bool AddDataset(const char* name, const int8_t* vals, size_t dim1, size_t dim2 = 1, size_t dim3 = 1, size_t dim4 = 1);
 		bool AddDataset(const char* name, const uint8_t* vals, size_t dim1, size_t dim2 = 1, size_t dim3 = 1, size_t dim4 = 1);
@@ -274,8 +276,10 @@ namespace HDF5 {
 		bool AddDataset(const char* name, const uint64_t* vals, size_t dim1, size_t dim2 = 1, size_t dim3 = 1, size_t dim4 = 1);
 		bool AddDataset(const char* name, const float* vals, size_t dim1, size_t dim2 = 1, size_t dim3 = 1, size_t dim4 = 1);
 		bool AddDataset(const char* name, const double* vals, size_t dim1, size_t dim2 = 1, size_t dim3 = 1, size_t dim4 = 1);
+#ifndef HDF5PP_LONG_IS_INT64
 		bool AddDataset(const char* name, const long* vals, size_t dim1, size_t dim2 = 1, size_t dim3 = 1, size_t dim4 = 1);
 		bool AddDataset(const char* name, const unsigned long* vals, size_t dim1, size_t dim2 = 1, size_t dim3 = 1, size_t dim4 = 1);
+#endif
 
 		bool AddDataset(const char* name, const std::vector<std::string>& vStr);
 		bool AddDataset(const char* name, const std::vector<const char *>& vStr);
@@ -0,0 +1,340 @@
+#include "pch.h"
+#include "hdf5pp_metrics.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+
+namespace HDF5 {
+
+	namespace {
+
+		const size_t OperationCount = (size_t)Metrics::Operation::Count;
+
+		const char* const OperationNames[OperationCount] = {
+			"Dataset::Read",
+			"Dataset::Write",
+			"Location::OpenObject",
+			"Location::OpenGroup",
+			"Location::OpenDataset",
+			"Location::OpenDatatype",
+			"AttributedObject::OpenAttribute",
+			"Location::CreateGroup",
+			"Location::CreateDataset",
+			"AttributedObject::CreateAttribute",
+			"AttributedObject::ReadAttribute",
+			"File::Create",
+			"File::Open",
+			"File::Flush",
+		};
+
+		// only the owning thread writes a shard, so plain load + store is enough; the atomics
+		// make concurrent snapshots well defined
+		struct Counter {
+			std::atomic<uint64_t> value{ 0 };
+
+			void Add(uint64_t n) { value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+			void Max(uint64_t n)
+			{
+				if (n > value.load(std::memory_order_relaxed)) {
+					value.store(n, std::memory_order_relaxed);
+				}
+			}
+			uint64_t Get() const { return value.load(std::memory_order_relaxed); }
+			void Clear() { value.store(0, std::memory_order_relaxed); }
+		};
+
+		struct OperationStats {
+			Counter calls;
+			Counter bytes;
+			Counter total_ns;
+			Counter max_ns;
+			Counter buckets[Metrics::BucketCount];
+		};
+
+		struct Shard {
+			OperationStats ops[OperationCount];
+		};
+
+		// owns the statistics of threads that have exited and the list of live shards
+		struct Registry {
+			std::mutex lock;
+			std::vector<Shard*> shards;
+			Shard retired;
+		};
+
+		// never destroyed, so that threads exiting during shutdown can still retire their shards
+		Registry& GetRegistry()
+		{
+			static Registry* registry = new Registry;
+			return *registry;
+		}
+
+		void Merge(const OperationStats& src, Metrics::OperationSnapshot& dst)
+		{
+			dst.calls += src.calls.Get();
+			dst.bytes += src.bytes.Get();
+			dst.total_ns += src.total_ns.Get();
+			dst.max_ns = std::max(dst.max_ns, src.max_ns.Get());
+			for (size_t i = 0; i < dst.buckets.size(); ++i) {
+				dst.buckets[i] += src.buckets[i].Get();
+			}
+		}
+
+		void MergeInto(const OperationStats& src, OperationStats& dst)
+		{
+			dst.calls.Add(src.calls.Get());
+			dst.bytes.Add(src.bytes.Get());
+			dst.total_ns.Add(src.total_ns.Get());
+			dst.max_ns.Max(src.max_ns.Get());
+			for (size_t i = 0; i < Metrics::BucketCount; ++i) {
+				dst.buckets[i].Add(src.buckets[i].Get());
+			}
+		}
+
+		void Clear(OperationStats& stats)
+		{
+			stats.calls.Clear();
+			stats.bytes.Clear();
+			stats.total_ns.Clear();
+			stats.max_ns.Clear();
+			for (auto& b : stats.buckets) {
+				b.Clear();
+			}
+		}
+
+		// registers the calling thread's shard on first use and retires it when the thread exits
+		class ThreadShard
+		{
+		public:
+			ThreadShard()
+			{
+				auto& r = GetRegistry();
+				std::lock_guard<std::mutex> guard(r.lock);
+				r.shards.push_back(&m_shard);
+			}
+			~ThreadShard()
+			{
+				auto& r = GetRegistry();
+				std::lock_guard<std::mutex> guard(r.lock);
+				for (size_t i = 0; i < OperationCount; ++i) {
+					MergeInto(m_shard.ops[i], r.retired.ops[i]);
+				}
+				r.shards.erase(std::find(r.shards.begin(), r.shards.end(), &m_shard));
+			}
+			Shard& Get() { return m_shard; }
+		private:
+			Shard m_shard;
+		};
+
+		Shard& GetThreadShard()
+		{
+			thread_local ThreadShard shard;
+			return shard.Get();
+		}
+
+		// Prometheus histogram boundaries, in seconds
+		const double PrometheusBounds[] = {
+			1e-6, 2.5e-6, 5e-6, 1e-5, 2.5e-5, 5e-5, 1e-4, 2.5e-4, 5e-4, 1e-3, 2.5e-3, 5e-3,
+			1e-2, 2.5e-2, 5e-2, 1e-1, 2.5e-1, 5e-1, 1.0, 2.5, 5.0, 10.0
+		};
+	}
+
+	uint64_t Metrics::OperationSnapshot::Percentile(double q) const
+	{
+		if (calls == 0 || buckets.empty()) {
+			return 0;
+		}
+		auto rank = (uint64_t)(std::min(std::max(q, 0.0), 1.0) * (double)calls + 0.5);
+		uint64_t seen{ 0 };
+		for (size_t i = 0; i < buckets.size(); ++i) {
+			seen += buckets[i];
+			if (seen >= rank && seen > 0) {
+				return std::min(GetBucketUpperBound(i), max_ns);
+			}
+		}
+		return max_ns;
+	}
+
+	bool Metrics::IsEnabled()
+	{
+#ifdef HDF5PP_WITH_METRICS
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	const char* Metrics::GetName(Operation op)
+	{
+		return (size_t)op < OperationCount ? OperationNames[(size_t)op] : "";
+	}
+
+	size_t Metrics::GetBucket(uint64_t ns)
+	{
+		if (ns < SubBucketCount) {
+			return (size_t)ns;
+		}
+		size_t magnitude{ 0 };
+		for (auto v = ns; v > 1; v >>= 1) {
+			++magnitude;
+		}
+		if (magnitude > MaxMagnitude) {
+			return BucketCount - 1;
+		}
+		auto shift = magnitude - SubBucketBits;
+		auto sub = (size_t)(ns >> shift) & (SubBucketCount - 1);
+		return SubBucketCount + shift * SubBucketCount + sub;
+	}
+
+	uint64_t Metrics::GetBucketLowerBound(size_t bucket)
+	{
+		if (bucket < SubBucketCount) {
+			return bucket;
+		}
+		auto shift = (bucket - SubBucketCount) / SubBucketCount;
+		auto sub = (bucket - SubBucketCount) % SubBucketCount;
+		return (uint64_t)(SubBucketCount + sub) << shift;
+	}
+
+	uint64_t Metrics::GetBucketUpperBound(size_t bucket)
+	{
+		if (bucket + 1 >= BucketCount) {
+			return UINT64_MAX;
+		}
+		return GetBucketLowerBound(bucket + 1) - 1;
+	}
+
+	void Metrics::Record(Operation op, uint64_t ns, uint64_t bytes)
+	{
+		if ((size_t)op >= OperationCount) {
+			return;
+		}
+		auto& stats = GetThreadShard().ops[(size_t)op];
+		stats.calls.Add(1);
+		stats.bytes.Add(bytes);
+		stats.total_ns.Add(ns);
+		stats.max_ns.Max(ns);
+		stats.buckets[GetBucket(ns)].Add(1);
+	}
+
+	bool Metrics::GetSnapshot(std::vector<OperationSnapshot>& ops)
+	{
+		ops.resize(OperationCount);
+		for (size_t i = 0; i < OperationCount; ++i) {
+			auto& s = ops[i];
+			s.op = (Operation)i;
+			s.name = OperationNames[i];
+			s.calls = s.bytes = s.total_ns = s.max_ns = 0;
+			s.buckets.assign(BucketCount, 0);
+		}
+
+		auto& r = GetRegistry();
+		std::lock_guard<std::mutex> guard(r.lock);
+		for (size_t i = 0; i < OperationCount; ++i) {
+			Merge(r.retired.ops[i], ops[i]);
+			for (auto shard : r.shards) {
+				Merge(shard->ops[i], ops[i]);
+			}
+		}
+		return true;
+	}
+
+	void Metrics::Reset()
+	{
+		auto& r = GetRegistry();
+		std::lock_guard<std::mutex> guard(r.lock);
+		for (size_t i = 0; i < OperationCount; ++i) {
+			Clear(r.retired.ops[i]);
+			for (auto shard : r.shards) {
+				Clear(shard->ops[i]);
+			}
+		}
+	}
+
+	std::string Metrics::ToJSON()
+	{
+		std::vector<OperationSnapshot> ops;
+		GetSnapshot(ops);
+
+		std::ostringstream os;
+		os << "{\"enabled\":" << (IsEnabled() ? "true" : "false") << ",\"operations\":[";
+		bool first{ true };
+		for (auto& s : ops) {
+			if (s.calls == 0) {
+				continue;
+			}
+			os << (first ? "" : ",") << "{\"name\":\"" << s.name << "\""
+				<< ",\"calls\":" << s.calls
+				<< ",\"bytes\":" << s.bytes
+				<< ",\"total_ns\":" << s.total_ns
+				<< ",\"max_ns\":" << s.max_ns
+				<< ",\"p50_ns\":" << s.Percentile(0.5)
+				<< ",\"p90_ns\":" << s.Percentile(0.9)
+				<< ",\"p99_ns\":" << s.Percentile(0.99)
+				<< ",\"p999_ns\":" << s.Percentile(0.999)
+				<< ",\"buckets\":[";
+			// non-empty buckets only, as [lower bound ns, count]
+			bool first_bucket{ true };
+			for (size_t i = 0; i < s.buckets.size(); ++i) {
+				if (s.buckets[i] != 0) {
+					os << (first_bucket ? "" : ",") << "[" << GetBucketLowerBound(i) << "," << s.buckets[i] << "]";
+					first_bucket = false;
+				}
+			}
+			os << "]}";
+			first = false;
+		}
+		os << "]}\n";
+		return os.str();
+	}
+
+	std::string Metrics::ToPrometheus()
+	{
+		std::vector<OperationSnapshot> ops;
+		GetSnapshot(ops);
+
+		std::ostringstream os;
+		os << "# HELP hdf5pp_operation_bytes_total Bytes transferred by hdf5pp operations.\n"
+			<< "# TYPE hdf5pp_operation_bytes_total counter\n";
+		for (auto& s : ops) {
+			os << "hdf5pp_operation_bytes_total{op=\"" << s.name << "\"} " << s.bytes << "\n";
+		}
+
+		os << "# HELP hdf5pp_operation_duration_seconds Latency of hdf5pp operations.\n"
+			<< "# TYPE hdf5pp_operation_duration_seconds histogram\n";
+		for (auto& s : ops) {
+			// a wrapper bucket is counted under a boundary once all of it lies below the boundary
+			size_t bucket{ 0 };
+			uint64_t cumulative{ 0 };
+			for (auto bound : PrometheusBounds) {
+				auto bound_ns = (uint64_t)(bound * 1e9);
+				while (bucket < s.buckets.size() && GetBucketUpperBound(bucket) <= bound_ns) {
+					cumulative += s.buckets[bucket++];
+				}
+				os << "hdf5pp_operation_duration_seconds_bucket{op=\"" << s.name << "\",le=\"" << bound << "\"} " << cumulative << "\n";
+			}
+			os << "hdf5pp_operation_duration_seconds_bucket{op=\"" << s.name << "\",le=\"+Inf\"} " << s.calls << "\n"
+				<< "hdf5pp_operation_duration_seconds_sum{op=\"" << s.name << "\"} " << (double)s.total_ns * 1e-9 << "\n"
+				<< "hdf5pp_operation_duration_seconds_count{op=\"" << s.name << "\"} " << s.calls << "\n";
+		}
+		return os.str();
+	}
+
+	bool Metrics::ExportJSON(const char* filename)
+	{
+		std::ofstream os(filename, std::ios::trunc);
+		os << ToJSON();
+		return os.good();
+	}
+
+	bool Metrics::ExportPrometheus(const char* filename)
+	{
+		std::ofstream os(filename, std::ios::trunc);
+		os << ToPrometheus();
+		return os.good();
+	}
+
+}
@@ -0,0 +1,82 @@
+// hdf5pp_metrics.h
+// HDF5::Metrics collects call counts, bytes and latency histograms of the main wrapper operations
+// the probes (hdf5pp_probe.h) record into it only when the library is built with HDF5PP_WITH_METRICS
+// defined; otherwise snapshots are empty
+// every thread records into its own shard without locking; snapshots merge all shards
+// histograms are log-linear (HDR style): 16 sub-buckets per power of two, i.e. ~6% resolution
+//
+#pragma once
+
+#include "hdf5pp_api.h"
+
+namespace HDF5 {
+
+	class HDF5PP_API Metrics
+	{
+	public:
+		enum class Operation {
+			DatasetRead,		// Dataset::Read
+			DatasetWrite,		// Dataset::Write
+			OpenObject,			// Location::OpenObject
+			OpenGroup,			// Location::OpenGroup
+			OpenDataset,		// Location::OpenDataset
+			OpenDatatype,		// Location::OpenDatatype
+			OpenAttribute,		// AttributedObject::OpenAttribute
+			CreateGroup,		// Location::CreateGroup
+			CreateDataset,		// Location::CreateDataset
+			CreateAttribute,	// AttributedObject::CreateAttribute
+			ReadAttribute,		// AttributedObject::ReadAttribute (includes the nested OpenAttribute)
+			FileCreate,			// File::Create
+			FileOpen,			// File::Open
+			FileFlush,			// Location::FlushFile
+			Count
+		};
+
+		// histogram geometry; latencies are in nanoseconds
+		static const size_t SubBucketBits = 4;
+		static const size_t SubBucketCount = 1 << SubBucketBits;
+		static const size_t MaxMagnitude = 40;	// values >= 2^41 ns (~37 minutes) land in the last bucket
+		static const size_t BucketCount = SubBucketCount * (MaxMagnitude - SubBucketBits + 2);
+
+		struct OperationSnapshot {
+			Operation op;
+			const char* name;
+			uint64_t calls{ 0 };
+			uint64_t bytes{ 0 };
+			uint64_t total_ns{ 0 };
+			uint64_t max_ns{ 0 };
+			std::vector<uint64_t> buckets;	// BucketCount counts
+
+			// returns the latency below which fraction q (0..1) of the calls fall, in nanoseconds
+			uint64_t Percentile(double q) const;
+		};
+
+		// Returns true if the library was built with HDF5PP_WITH_METRICS
+		static bool IsEnabled();
+
+		// Returns the name of an operation, e.g. "Dataset::Read"
+		static const char* GetName(Operation op);
+
+		// Returns the bucket a latency falls in, and the range [lower, upper] of latencies in a bucket
+		static size_t GetBucket(uint64_t ns);
+		static uint64_t GetBucketLowerBound(size_t bucket);
+		static uint64_t GetBucketUpperBound(size_t bucket);
+
+		// Records one call; used by the probes, but can also be called for user defined timings
+		static void Record(Operation op, uint64_t ns, uint64_t bytes);
+
+		// Retrieves the merged statistics of all threads, one entry per operation
+		static bool GetSnapshot(std::vector<OperationSnapshot>& ops);
+
+		// Clears all statistics; calls recorded concurrently with Reset may be partially kept
+		static void Reset();
+
+		// Formats a snapshot as JSON / as Prometheus text exposition format
+		static std::string ToJSON();
+		static std::string ToPrometheus();
+
+		// Writes a snapshot to a file (replacing it)
+		static bool ExportJSON(const char* filename);
+		static bool ExportPrometheus(const char* filename);
+	};
+}
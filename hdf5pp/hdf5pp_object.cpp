@@ -19,6 +19,7 @@ namespace HDF5 {
 	Object& Object::operator=(const Object& rhs)
 	{
 		if (this != &rhs) {
+			ClearAttributeCache();
 			DecrementReferenceCount();
 			m_hID = rhs.m_hID;
 			IncrementReferenceCount();
@@ -33,6 +34,7 @@ namespace HDF5 {
 			case H5I_GROUP:
 			case H5I_DATASET:
 			case H5I_DATATYPE:
+				ClearAttributeCache();
 				DecrementReferenceCount();
 				m_hID = hid;
 				return true;
@@ -41,6 +43,7 @@ namespace HDF5 {
 			}
 		}
 		else {
+			ClearAttributeCache();
 			DecrementReferenceCount();
 			m_hID = InvalidHandle;
 			return true;
@@ -0,0 +1,95 @@
+// hdf5pp_probe.h
+// instrumentation probes placed in the wrapper methods (library internal)
+// a probe times its enclosing scope into HDF5::Metrics when built with HDF5PP_WITH_METRICS and records
+// begin/end events into HDF5::Trace when built with HDF5PP_WITH_TRACE; with neither, the probes
+// expand to nothing and their arguments are not evaluated
+//
+#pragma once
+
+#include "hdf5pp_metrics.h"
+#include "hdf5pp_trace.h"
+
+#if defined(HDF5PP_WITH_METRICS) || defined(HDF5PP_WITH_TRACE)
+
+#include <chrono>
+
+namespace HDF5 {
+
+	class Probe
+	{
+	public:
+		// path: name of the object the operation works on, as passed by the caller
+		Probe(Metrics::Operation op, const char* path) : m_op(op)
+		{
+#ifdef HDF5PP_WITH_TRACE
+			if (Trace::IsActive()) {
+				m_traced = true;
+				Trace::Begin(op, path);
+			}
+#else
+			(void)path;
+#endif
+#ifdef HDF5PP_WITH_METRICS
+			m_start = std::chrono::steady_clock::now();
+#endif
+		}
+
+		// obj: the object the operation works on; its path is only looked up while tracing
+		Probe(Metrics::Operation op, hid_t obj) : m_op(op)
+		{
+#ifdef HDF5PP_WITH_TRACE
+			if (Trace::IsActive()) {
+				m_traced = true;
+				char path[64];
+				if (H5Iget_name(obj, path, sizeof(path)) < 0) {
+					path[0] = 0;
+				}
+				Trace::Begin(op, path);
+			}
+#else
+			(void)obj;
+#endif
+#ifdef HDF5PP_WITH_METRICS
+			m_start = std::chrono::steady_clock::now();
+#endif
+		}
+
+		~Probe()
+		{
+#ifdef HDF5PP_WITH_METRICS
+			auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count();
+			Metrics::Record(m_op, (uint64_t)ns, m_bytes);
+#endif
+			if (m_traced) {
+				Trace::End(m_op, m_bytes);
+			}
+		}
+
+		Probe(const Probe&) = delete;
+		Probe& operator=(const Probe&) = delete;
+
+		void SetBytes(uint64_t bytes) { m_bytes = bytes; }
+
+	private:
+		Metrics::Operation m_op;
+		uint64_t m_bytes{ 0 };
+		bool m_traced{ false };
+#ifdef HDF5PP_WITH_METRICS
+		std::chrono::steady_clock::time_point m_start;
+#endif
+	};
+}
+
+#define HDF5PP_PROBE(op) HDF5::Probe hdf5pp_probe_(HDF5::Metrics::Operation::op, (const char*)nullptr)
+#define HDF5PP_PROBE_NAME(op, name) HDF5::Probe hdf5pp_probe_(HDF5::Metrics::Operation::op, (const char*)(name))
+#define HDF5PP_PROBE_OBJECT(op, obj) HDF5::Probe hdf5pp_probe_(HDF5::Metrics::Operation::op, (hid_t)(obj))
+#define HDF5PP_PROBE_BYTES(n) hdf5pp_probe_.SetBytes(n)
+
+#else
+
+#define HDF5PP_PROBE(op) ((void)0)
+#define HDF5PP_PROBE_NAME(op, name) ((void)0)
+#define HDF5PP_PROBE_OBJECT(op, obj) ((void)0)
+#define HDF5PP_PROBE_BYTES(n) ((void)0)
+
+#endif
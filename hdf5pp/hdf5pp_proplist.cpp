@@ -1,5 +1,14 @@
 #include "pch.h"
 #include "hdf5pp_proplist.h"
+#include "hdf5pp_chunkplan.h"
+#include "hdf5pp_delta.h"
+#include "hdf5pp_dspace.h"
+#include "hdf5pp_filter.h"
+#include "hdf5pp_shuffle.h"
+#include "hdf5pp_quantize.h"
+#include "hdf5pp_vfd.h"
+
+#include <algorithm>
 
 namespace HDF5 {
 
@@ -176,6 +185,80 @@ namespace HDF5 {
 		}
 	}
 
+	//////////////////////////////////////////////////////////////////////////
+
+#ifdef _DEBUG
+	ObjectCreationPropertyList::ObjectCreationPropertyList(hid_t hid)
+	{
+		if (hid >= 0) {
+			if (H5I_GENPROP_LST == H5Iget_type(hid)) {
+				if (H5Pisa_class(hid, H5P_OBJECT_CREATE) > 0) {
+					m_hID = hid;
+				}
+				else {
+					assert(false && L"input hid_t is not a ObjectCreationPropertyList");
+#ifdef HDF5PP_USE_EXCEPTIONS
+					throw std::invalid_argument("input is not convertable to HDF5::ObjectCreationPropertyList");
+#endif
+				}
+			}
+			else {
+				assert(false && L"input hid_t is not a ObjectCreationPropertyList");
+#ifdef HDF5PP_USE_EXCEPTIONS
+				throw std::invalid_argument("input is not convertable to HDF5::ObjectCreationPropertyList");
+#endif
+			}
+		}
+	}
+#else
+	ObjectCreationPropertyList::ObjectCreationPropertyList(hid_t hid) : PropertyList(hid)
+	{
+
+	}
+#endif
+
+	ObjectCreationPropertyList::~ObjectCreationPropertyList()
+	{
+		// let PropertyList do its thing
+	}
+
+	bool ObjectCreationPropertyList::SetAttributePhaseChange(unsigned int max_compact, unsigned int min_dense)
+	{
+		return H5Pset_attr_phase_change(m_hID, max_compact, min_dense) >= 0;
+	}
+
+	bool ObjectCreationPropertyList::GetAttributePhaseChange(unsigned int& max_compact, unsigned int& min_dense)
+	{
+		return H5Pget_attr_phase_change(m_hID, &max_compact, &min_dense) >= 0;
+	}
+
+	bool ObjectCreationPropertyList::SetAttributeCreationOrder(CreationOrder order)
+	{
+		return H5Pset_attr_creation_order(m_hID, (unsigned int)order) >= 0;
+	}
+
+	bool ObjectCreationPropertyList::GetAttributeCreationOrder(CreationOrder& order)
+	{
+		unsigned int flags{ 0 };
+		auto rv = H5Pget_attr_creation_order(m_hID, &flags);
+		order = (CreationOrder)flags;
+		return rv >= 0;
+	}
+
+	bool ObjectCreationPropertyList::SetTrackTimes(bool track_times)
+	{
+		return H5Pset_obj_track_times(m_hID, track_times) >= 0;
+	}
+
+	bool ObjectCreationPropertyList::GetTrackTimes(bool& track_times)
+	{
+		hbool_t b{ false };
+		auto rv = H5Pget_obj_track_times(m_hID, &b);
+		track_times = b;
+		return rv >= 0;
+	}
+
+	//////////////////////////////////////////////////////////////////////////
 
 #ifdef _DEBUG
 	GroupCreationPropertyList::GroupCreationPropertyList(hid_t hid)
@@ -202,7 +285,7 @@ namespace HDF5 {
 		}
 	}
 #else
-	GroupCreationPropertyList::GroupCreationPropertyList(hid_t hid) : PropertyList(hid)
+	GroupCreationPropertyList::GroupCreationPropertyList(hid_t hid) : ObjectCreationPropertyList(hid)
 	{
 
 	}
@@ -250,6 +333,49 @@ namespace HDF5 {
 		}
 	}
 
+	bool GroupCreationPropertyList::SetLinkPhaseChange(unsigned int max_compact, unsigned int min_dense)
+	{
+		return H5Pset_link_phase_change(m_hID, max_compact, min_dense) >= 0;
+	}
+
+	bool GroupCreationPropertyList::GetLinkPhaseChange(unsigned int& max_compact, unsigned int& min_dense)
+	{
+		return H5Pget_link_phase_change(m_hID, &max_compact, &min_dense) >= 0;
+	}
+
+	bool GroupCreationPropertyList::SetEstimatedLinkInfo(unsigned int est_num_entries, unsigned int est_name_len)
+	{
+		return H5Pset_est_link_info(m_hID, est_num_entries, est_name_len) >= 0;
+	}
+
+	bool GroupCreationPropertyList::GetEstimatedLinkInfo(unsigned int& est_num_entries, unsigned int& est_name_len)
+	{
+		return H5Pget_est_link_info(m_hID, &est_num_entries, &est_name_len) >= 0;
+	}
+
+	bool GroupCreationPropertyList::SetLinkCreationOrder(CreationOrder order)
+	{
+		return H5Pset_link_creation_order(m_hID, (unsigned int)order) >= 0;
+	}
+
+	bool GroupCreationPropertyList::GetLinkCreationOrder(CreationOrder& order)
+	{
+		unsigned int flags{ 0 };
+		auto rv = H5Pget_link_creation_order(m_hID, &flags);
+		order = (CreationOrder)flags;
+		return rv >= 0;
+	}
+
+	bool GroupCreationPropertyList::SetLocalHeapSizeHint(size_t size_hint)
+	{
+		return H5Pset_local_heap_size_hint(m_hID, size_hint) >= 0;
+	}
+
+	bool GroupCreationPropertyList::GetLocalHeapSizeHint(size_t& size_hint)
+	{
+		return H5Pget_local_heap_size_hint(m_hID, &size_hint) >= 0;
+	}
+
 	//////////////////////////////////////////////////////////////////////////
 
 #ifdef _DEBUG
@@ -277,7 +403,7 @@ namespace HDF5 {
 		}
 	}
 #else
-	DatasetCreationPropertyList::DatasetCreationPropertyList(hid_t hid) : PropertyList(hid)
+	DatasetCreationPropertyList::DatasetCreationPropertyList(hid_t hid) : ObjectCreationPropertyList(hid)
 	{
 
 	}
@@ -325,7 +451,219 @@ namespace HDF5 {
 		}
 	}
 
+	bool DatasetCreationPropertyList::SetLayout(Layout layout)
+	{
+		return H5Pset_layout(m_hID, (H5D_layout_t)layout) >= 0;
+	}
+
+	bool DatasetCreationPropertyList::GetLayout(Layout& layout)
+	{
+		layout = (Layout)H5Pget_layout(m_hID);
+		return layout != Layout::Error;
+	}
+
+	bool DatasetCreationPropertyList::SetChunk(const std::vector<hsize_t>& dims)
+	{
+		return H5Pset_chunk(m_hID, (int)dims.size(), dims.data()) >= 0;
+	}
+
+	bool DatasetCreationPropertyList::GetChunk(std::vector<hsize_t>& dims)
+	{
+		dims.resize(H5S_MAX_RANK);
+		auto rank = H5Pget_chunk(m_hID, H5S_MAX_RANK, dims.data());
+		dims.resize(rank > 0 ? (size_t)rank : 0);
+		return rank >= 0;
+	}
+
+	bool DatasetCreationPropertyList::SetChunk(const ChunkPlanner& planner)
+	{
+		auto dims = planner.Plan();
+		return !dims.empty() && SetChunk(dims);
+	}
+
+	bool DatasetCreationPropertyList::SetDeflate(unsigned int level)
+	{
+		return H5Pset_deflate(m_hID, level) >= 0;
+	}
+
+	bool DatasetCreationPropertyList::SetShuffle()
+	{
+		return H5Pset_shuffle(m_hID) >= 0;
+	}
+
+	bool DatasetCreationPropertyList::SetFilter(H5Z_filter_t id, unsigned int flags, const std::vector<unsigned int>& cd_values /*= std::vector<unsigned int>()*/)
+	{
+		return H5Pset_filter(m_hID, id, flags, cd_values.size(), cd_values.data()) >= 0;
+	}
+
+	bool DatasetCreationPropertyList::SetLZ4(unsigned int block_size /*= 0*/)
+	{
+		return SetFilter(LZ4Filter::ID, H5Z_FLAG_OPTIONAL, { block_size });
+	}
+
+	bool DatasetCreationPropertyList::SetZstd(int level /*= 3*/)
+	{
+		return SetFilter(ZstdFilter::ID, H5Z_FLAG_OPTIONAL, { (unsigned int)level });
+	}
+
+	bool DatasetCreationPropertyList::SetByteShuffle()
+	{
+		return SetFilter(ShuffleFilter::ByteShuffleID, H5Z_FLAG_OPTIONAL);
+	}
+
+	bool DatasetCreationPropertyList::SetBitShuffle(unsigned int block_size /*= 0*/)
+	{
+		// the element size goes to cd_values[2] when the dataset is created
+		return SetFilter(ShuffleFilter::BitShuffleID, H5Z_FLAG_OPTIONAL, { 0, 0, 0, block_size, 0 });
+	}
+
+	bool DatasetCreationPropertyList::SetBitGroom(unsigned int nsb)
+	{
+		// the element size goes to cd_values[1] when the dataset is created
+		return SetFilter(QuantizeFilter::ID, H5Z_FLAG_OPTIONAL, QuantizeFilter::MakeParameters(QuantizeFilter::Method::BitGroom, nsb));
+	}
+
+	bool DatasetCreationPropertyList::SetBitRound(unsigned int nsb)
+	{
+		return SetFilter(QuantizeFilter::ID, H5Z_FLAG_OPTIONAL, QuantizeFilter::MakeParameters(QuantizeFilter::Method::BitRound, nsb));
+	}
+
+	bool DatasetCreationPropertyList::SetAbsoluteError(double bound)
+	{
+		return SetFilter(QuantizeFilter::ID, H5Z_FLAG_OPTIONAL, QuantizeFilter::MakeParameters(QuantizeFilter::Method::Absolute, bound));
+	}
+
+	bool DatasetCreationPropertyList::SetDelta(bool packed /*= true*/)
+	{
+		// the element size goes to cd_values[2] when the dataset is created
+		auto packing = packed ? DeltaFilter::Packing::FrameOfReference : DeltaFilter::Packing::Varint;
+		return SetFilter(DeltaFilter::ID, H5Z_FLAG_OPTIONAL, DeltaFilter::MakeParameters(DeltaFilter::Order::Delta, packing));
+	}
+
+	bool DatasetCreationPropertyList::SetDeltaOfDelta(bool packed /*= true*/)
+	{
+		auto packing = packed ? DeltaFilter::Packing::FrameOfReference : DeltaFilter::Packing::Varint;
+		return SetFilter(DeltaFilter::ID, H5Z_FLAG_OPTIONAL, DeltaFilter::MakeParameters(DeltaFilter::Order::DeltaOfDelta, packing));
+	}
+
+	int DatasetCreationPropertyList::GetFilterCount()
+	{
+		return H5Pget_nfilters(m_hID);
+	}
+
+	bool DatasetCreationPropertyList::SetAllocTime(AllocTime t)
+	{
+		return H5Pset_alloc_time(m_hID, (H5D_alloc_time_t)t) >= 0;
+	}
+
+	bool DatasetCreationPropertyList::GetAllocTime(AllocTime& t)
+	{
+		H5D_alloc_time_t v;
+		if (H5Pget_alloc_time(m_hID, &v) < 0) {
+			return false;
+		}
+		t = (AllocTime)v;
+		return true;
+	}
+
+	bool DatasetCreationPropertyList::SetFillTime(FillTime t)
+	{
+		return H5Pset_fill_time(m_hID, (H5D_fill_time_t)t) >= 0;
+	}
 
+	bool DatasetCreationPropertyList::GetFillTime(FillTime& t)
+	{
+		H5D_fill_time_t v;
+		if (H5Pget_fill_time(m_hID, &v) < 0) {
+			return false;
+		}
+		t = (FillTime)v;
+		return true;
+	}
+
+	bool DatasetCreationPropertyList::AddVirtualMapping(const Dataspace& vspace, const char* src_file, const char* src_dset, const Dataspace& src_space)
+	{
+		return H5Pset_virtual(m_hID, (hid_t)vspace, src_file, src_dset, (hid_t)src_space) >= 0;
+	}
+
+	namespace {
+		// the block a source of extent src_dims fills in a virtual dataset of the given rank
+		bool VirtualBlock(size_t rank, const std::vector<hsize_t>& src_dims, std::vector<hsize_t>& block)
+		{
+			if (src_dims.empty() || src_dims.size() > rank) {
+				return false;
+			}
+			block.assign(rank - src_dims.size(), 1);
+			block.insert(block.end(), src_dims.begin(), src_dims.end());
+			return true;
+		}
+	}
+
+	bool DatasetCreationPropertyList::AddVirtualMapping(const std::vector<hsize_t>& vdims, const std::vector<hsize_t>& start, const char* src_file, const char* src_dset, const std::vector<hsize_t>& src_dims)
+	{
+		std::vector<hsize_t> block;
+		if (start.size() != vdims.size() || !VirtualBlock(vdims.size(), src_dims, block)) {
+			return false;
+		}
+		Dataspace vspace(vdims);
+		Dataspace src_space(src_dims);
+		return vspace.SelectHyperslab(Dataspace::SelectionOperation::Set, start.data(), nullptr, block.data(), nullptr) &&
+			AddVirtualMapping(vspace, src_file, src_dset, src_space);
+	}
+
+	bool DatasetCreationPropertyList::AddVirtualSeries(const Dataspace& vspace, const char* src_file, const char* src_dset, const std::vector<hsize_t>& src_dims)
+	{
+		auto rank = H5Sget_simple_extent_ndims((hid_t)vspace);
+		std::vector<hsize_t> block;
+		if (rank <= 0 || !VirtualBlock((size_t)rank, src_dims, block)) {
+			return false;
+		}
+		// one block per source, repeated without end along the first dimension
+		std::vector<hsize_t> start(block.size(), 0), stride(block.size(), 1), count(block.size(), 1);
+		stride[0] = block[0];
+		count[0] = H5S_UNLIMITED;
+		Dataspace series;
+		Dataspace src_space(src_dims);
+		return series.Attach(H5Scopy((hid_t)vspace)) &&
+			series.SelectHyperslab(Dataspace::SelectionOperation::Set, start.data(), stride.data(), count.data(), block.data()) &&
+			AddVirtualMapping(series, src_file, src_dset, src_space);
+	}
+
+	bool DatasetCreationPropertyList::GetVirtualCount(size_t& count)
+	{
+		return H5Pget_virtual_count(m_hID, &count) >= 0;
+	}
+
+	bool DatasetCreationPropertyList::GetVirtualMapping(size_t index, std::string& src_file, std::string& src_dset, Dataspace& vspace, Dataspace& src_space)
+	{
+		auto file_len = H5Pget_virtual_filename(m_hID, index, nullptr, 0);
+		auto dset_len = H5Pget_virtual_dsetname(m_hID, index, nullptr, 0);
+		if (file_len < 0 || dset_len < 0) {
+			return false;
+		}
+		std::vector<char> buf((size_t)std::max(file_len, dset_len) + 1);
+		if (H5Pget_virtual_filename(m_hID, index, buf.data(), buf.size()) < 0) {
+			return false;
+		}
+		src_file.assign(buf.data(), (size_t)file_len);
+		if (H5Pget_virtual_dsetname(m_hID, index, buf.data(), buf.size()) < 0) {
+			return false;
+		}
+		src_dset.assign(buf.data(), (size_t)dset_len);
+
+		auto vspace_id = H5Pget_virtual_vspace(m_hID, index);
+		auto src_space_id = H5Pget_virtual_srcspace(m_hID, index);
+		// both attached before the results are combined; an identifier that could not be is closed here
+		auto vspace_ok = vspace_id >= 0 && vspace.Attach(vspace_id);
+		auto src_space_ok = src_space_id >= 0 && src_space.Attach(src_space_id);
+		if (vspace_id >= 0 && !vspace_ok) {
+			H5Sclose(vspace_id);
+		}
+		if (src_space_id >= 0 && !src_space_ok) {
+			H5Sclose(src_space_id);
+		}
+		return vspace_ok && src_space_ok;
+	}
 
 	//////////////////////////////////////////////////////////////////////////
 
@@ -402,6 +740,60 @@ namespace HDF5 {
 		}
 	}
 
+	bool DatasetAccessPropertyList::SetChunkCache(size_t nslots, size_t nbytes, double w0)
+	{
+		return H5Pset_chunk_cache(m_hID, nslots, nbytes, w0) >= 0;
+	}
+
+	bool DatasetAccessPropertyList::GetChunkCache(size_t& nslots, size_t& nbytes, double& w0)
+	{
+		return H5Pget_chunk_cache(m_hID, &nslots, &nbytes, &w0) >= 0;
+	}
+
+	bool DatasetAccessPropertyList::SetVirtualView(VirtualView view)
+	{
+		return H5Pset_virtual_view(m_hID, (H5D_vds_view_t)view) >= 0;
+	}
+
+	bool DatasetAccessPropertyList::GetVirtualView(VirtualView& view)
+	{
+		H5D_vds_view_t v;
+		if (H5Pget_virtual_view(m_hID, &v) < 0) {
+			return false;
+		}
+		view = (VirtualView)v;
+		return true;
+	}
+
+	bool DatasetAccessPropertyList::SetVirtualPrintfGap(hsize_t gap_size)
+	{
+		return H5Pset_virtual_printf_gap(m_hID, gap_size) >= 0;
+	}
+
+	bool DatasetAccessPropertyList::GetVirtualPrintfGap(hsize_t& gap_size)
+	{
+		return H5Pget_virtual_printf_gap(m_hID, &gap_size) >= 0;
+	}
+
+	bool DatasetAccessPropertyList::SetVirtualPrefix(const char* prefix)
+	{
+		return H5Pset_virtual_prefix(m_hID, prefix) >= 0;
+	}
+
+	bool DatasetAccessPropertyList::GetVirtualPrefix(std::string& prefix)
+	{
+		auto len = H5Pget_virtual_prefix(m_hID, nullptr, 0);
+		if (len < 0) {
+			return false;
+		}
+		std::vector<char> buf((size_t)len + 1);
+		if (H5Pget_virtual_prefix(m_hID, buf.data(), buf.size()) < 0) {
+			return false;
+		}
+		prefix.assign(buf.data(), (size_t)len);
+		return true;
+	}
+
 	//////////////////////////////////////////////////////////////////////////
 
 #ifdef _DEBUG
@@ -537,6 +929,11 @@ namespace HDF5 {
 		return H5Pget_file_space_strategy(m_hID, (H5F_fspace_strategy_t*)(&strategy), &persist, &threshold) >= 0;
 	}
 
+	bool FileCreationPropertyList::SetPagedAggregation(hsize_t page_size, bool persist /*= true*/, hsize_t threshold /*= 1*/)
+	{
+		return SetFileSpaceStrategy(FileSpaceStrategy::EmbededPageAggregator, persist, threshold) && SetFileSpacePageSize(page_size);
+	}
+
 	bool FileCreationPropertyList::SetSharedMesgIndexesCount(unsigned int nindexes)
 	{
 		return H5Pset_shared_mesg_nindexes(m_hID, nindexes) >= 0;
@@ -642,6 +1039,103 @@ namespace HDF5 {
 		}
 	}
 
+	bool FileAccessPropertyList::SetLibraryVersionBounds(H5F_libver_t low, H5F_libver_t high)
+	{
+		return H5Pset_libver_bounds(m_hID, low, high) >= 0;
+	}
+
+	bool FileAccessPropertyList::GetLibraryVersionBounds(H5F_libver_t& low, H5F_libver_t& high)
+	{
+		return H5Pget_libver_bounds(m_hID, &low, &high) >= 0;
+	}
+
+	bool FileAccessPropertyList::SetMDCConfig(H5AC_cache_config_t& cfg)
+	{
+		return H5Pset_mdc_config(m_hID, &cfg) >= 0;
+	}
+
+	bool FileAccessPropertyList::GetMDCConfig(H5AC_cache_config_t& cfg)
+	{
+		cfg.version = H5AC__CURR_CACHE_CONFIG_VERSION;
+		return H5Pget_mdc_config(m_hID, &cfg) >= 0;
+	}
+
+	bool FileAccessPropertyList::SetMDCImageConfig(H5AC_cache_image_config_t& cfg)
+	{
+		return H5Pset_mdc_image_config(m_hID, &cfg) >= 0;
+	}
+
+	bool FileAccessPropertyList::GetMDCImageConfig(H5AC_cache_image_config_t& cfg)
+	{
+		cfg.version = H5AC__CURR_CACHE_IMAGE_CONFIG_VERSION;
+		return H5Pget_mdc_image_config(m_hID, &cfg) >= 0;
+	}
+
+	bool FileAccessPropertyList::EnableMDCImage(int entry_ageout /*= H5AC__CACHE_IMAGE__ENTRY_AGEOUT__NONE*/)
+	{
+		H5F_libver_t low, high;
+		if (!GetLibraryVersionBounds(low, high)) {
+			return false;
+		}
+		if (low < H5F_LIBVER_V110) {
+			if (!SetLibraryVersionBounds(H5F_LIBVER_V110, high < H5F_LIBVER_V110 ? H5F_LIBVER_LATEST : high)) {
+				return false;
+			}
+		}
+
+		H5AC_cache_image_config_t cfg;
+		cfg.version = H5AC__CURR_CACHE_IMAGE_CONFIG_VERSION;
+		cfg.generate_image = true;
+		cfg.save_resize_status = false;
+		cfg.entry_ageout = entry_ageout;
+		return SetMDCImageConfig(cfg);
+	}
+
+	bool FileAccessPropertyList::SetPageBufferSize(size_t buf_size, unsigned int min_meta_perc /*= 0*/, unsigned int min_raw_perc /*= 0*/)
+	{
+		return H5Pset_page_buffer_size(m_hID, buf_size, min_meta_perc, min_raw_perc) >= 0;
+	}
+
+	bool FileAccessPropertyList::GetPageBufferSize(size_t& buf_size, unsigned int& min_meta_perc, unsigned int& min_raw_perc)
+	{
+		return H5Pget_page_buffer_size(m_hID, &buf_size, &min_meta_perc, &min_raw_perc) >= 0;
+	}
+
+	bool FileAccessPropertyList::SetSec2Driver()
+	{
+		return H5Pset_fapl_sec2(m_hID) >= 0;
+	}
+
+	bool FileAccessPropertyList::SetStdioDriver()
+	{
+		return H5Pset_fapl_stdio(m_hID) >= 0;
+	}
+
+	bool FileAccessPropertyList::SetCoreDriver(size_t increment, bool backing_store)
+	{
+		return H5Pset_fapl_core(m_hID, increment, backing_store) >= 0;
+	}
+
+	bool FileAccessPropertyList::SetDriver(const VirtualFileDriverFactory& factory)
+	{
+		auto id = factory.GetDriverID();
+		return id >= 0 && H5Pset_driver(m_hID, id, &factory) >= 0;
+	}
+
+	hid_t FileAccessPropertyList::GetDriver()
+	{
+		return H5Pget_driver(m_hID);
+	}
+
+	bool FileAccessPropertyList::SetFileImage(void* buf, size_t buf_len)
+	{
+		return H5Pset_file_image(m_hID, buf, buf_len) >= 0;
+	}
+
+	bool FileAccessPropertyList::SetFileImageCallbacks(H5FD_file_image_callbacks_t& callbacks)
+	{
+		return H5Pset_file_image_callbacks(m_hID, &callbacks) >= 0;
+	}
 
 	//////////////////////////////////////////////////////////////////////////
 
@@ -670,7 +1164,7 @@ namespace HDF5 {
 		}
 	}
 #else
-	DatatypeCreationPropertyList::DatatypeCreationPropertyList(hid_t hid) : PropertyList(hid)
+	DatatypeCreationPropertyList::DatatypeCreationPropertyList(hid_t hid) : ObjectCreationPropertyList(hid)
 	{
 
 	}
@@ -8,6 +8,10 @@
 
 namespace HDF5 {
 
+	class ChunkPlanner;
+	class Dataspace;
+	class VirtualFileDriverFactory;
+
 	class HDF5PP_API PropertyList : public Handle
 	{
 	public:
@@ -50,7 +54,37 @@ namespace HDF5 {
 		friend class Attribute;
 	};
 
-	class HDF5PP_API GroupCreationPropertyList : public PropertyList
+	// common base for group, dataset and committed datatype creation property lists
+	class HDF5PP_API ObjectCreationPropertyList : public PropertyList
+	{
+	public:
+		virtual ~ObjectCreationPropertyList();
+
+		enum class CreationOrder {
+			None = 0,															// creation order is not tracked
+			Tracked = H5P_CRT_ORDER_TRACKED,									// creation order is tracked, but not indexed
+			Indexed = H5P_CRT_ORDER_TRACKED | H5P_CRT_ORDER_INDEXED				// creation order is tracked and indexed
+		};
+
+		// Sets/Gets the thresholds for attribute storage switching from compact (in object header) to dense (fractal heap and B-tree)
+		// defaults are 8 and 6
+		bool SetAttributePhaseChange(unsigned int max_compact, unsigned int min_dense);
+		bool GetAttributePhaseChange(unsigned int& max_compact, unsigned int& min_dense);
+
+		// Sets/Gets tracking and indexing of attribute creation order
+		bool SetAttributeCreationOrder(CreationOrder order);
+		bool GetAttributeCreationOrder(CreationOrder& order);
+
+		// Sets/Gets whether times associated with an object are recorded
+		// disabling saves an object header update every time the object is modified
+		bool SetTrackTimes(bool track_times);
+		bool GetTrackTimes(bool& track_times);
+	protected:
+		ObjectCreationPropertyList() = default;
+		explicit ObjectCreationPropertyList(hid_t hid);
+	};
+
+	class HDF5PP_API GroupCreationPropertyList : public ObjectCreationPropertyList
 	{
 	public:
 		GroupCreationPropertyList();
@@ -58,12 +92,31 @@ namespace HDF5 {
 		virtual ~GroupCreationPropertyList();
 
 		bool Attach(hid_t hid) override;
+
+		// Sets/Gets the thresholds for link storage switching from compact (in object header) to dense (fractal heap and B-tree)
+		// defaults are 8 and 6; groups expected to hold many links should use a low max_compact
+		bool SetLinkPhaseChange(unsigned int max_compact, unsigned int min_dense);
+		bool GetLinkPhaseChange(unsigned int& max_compact, unsigned int& min_dense);
+
+		// Sets/Gets the estimated number of links and average link name length
+		// used to size the object header of a new-format group up front
+		bool SetEstimatedLinkInfo(unsigned int est_num_entries, unsigned int est_name_len);
+		bool GetEstimatedLinkInfo(unsigned int& est_num_entries, unsigned int& est_name_len);
+
+		// Sets/Gets tracking and indexing of link creation order
+		// an indexed creation order makes Iterate/Visit ByCreationOrder fast on large groups
+		bool SetLinkCreationOrder(CreationOrder order);
+		bool GetLinkCreationOrder(CreationOrder& order);
+
+		// Sets/Gets the local heap size hint for old-style (symbol table) groups
+		bool SetLocalHeapSizeHint(size_t size_hint);
+		bool GetLocalHeapSizeHint(size_t& size_hint);
 	protected:
 		explicit GroupCreationPropertyList(hid_t hid);
 		friend class Group;
 	};
 
-	class HDF5PP_API DatasetCreationPropertyList : public PropertyList
+	class HDF5PP_API DatasetCreationPropertyList : public ObjectCreationPropertyList
 	{
 	public:
 		DatasetCreationPropertyList();
@@ -71,6 +124,101 @@ namespace HDF5 {
 		virtual ~DatasetCreationPropertyList();
 
 		bool Attach(hid_t hid) override;
+
+		enum class Layout {
+			Error = H5D_LAYOUT_ERROR,
+			Compact = H5D_COMPACT,			// raw data is stored in the object header
+			Contiguous = H5D_CONTIGUOUS,	// raw data is stored in one block in the file
+			Chunked = H5D_CHUNKED,			// raw data is stored in separately allocated chunks
+			Virtual = H5D_VIRTUAL			// raw data is mapped from other datasets
+		};
+		// Sets/Gets the type of storage used to store the raw data
+		bool SetLayout(Layout layout);
+		bool GetLayout(Layout& layout);
+
+		// Sets/Gets the size of the chunks used to store a chunked layout dataset
+		// setting the chunk size also sets the layout to Chunked
+		bool SetChunk(const std::vector<hsize_t>& dims);
+		bool GetChunk(std::vector<hsize_t>& dims);
+
+		// Sets the chunk dims planned from the declared access patterns (see hdf5pp_chunkplan.h)
+		bool SetChunk(const ChunkPlanner& planner);
+
+		// Adds the deflate (gzip) compression filter, level 0-9, to the filter pipeline of a chunked dataset
+		bool SetDeflate(unsigned int level);
+
+		// Adds the shuffle filter, which regroups the bytes of multi-byte values; place it before a compression filter
+		bool SetShuffle();
+
+		// Adds filter id with flags (H5Z_FLAG_OPTIONAL: chunks it fails on are stored unfiltered) and parameters
+		// to the filter pipeline of a chunked dataset
+		bool SetFilter(H5Z_filter_t id, unsigned int flags, const std::vector<unsigned int>& cd_values = std::vector<unsigned int>());
+
+		// Adds the LZ4 (block_size 0: 1 GiB blocks) or Zstandard compression filter, as optional filters; the
+		// filter must be registered first (see hdf5pp_filter.h)
+		bool SetLZ4(unsigned int block_size = 0);
+		bool SetZstd(int level = 3);
+
+		// Adds the byte or bit transposition filter of ShuffleFilter (see hdf5pp_shuffle.h), which must be registered
+		// first; place it before a compression filter; block_size is the number of elements bit-transposed together,
+		// a multiple of 8 (0: about 8 KiB)
+		bool SetByteShuffle();
+		bool SetBitShuffle(unsigned int block_size = 0);
+
+		// Adds the lossy quantization filter of QuantizeFilter (see hdf5pp_quantize.h), which must be registered first,
+		// keeping nsb significant bits (1-24 for float, 1-53 for double) or rounding within an absolute error bound;
+		// place it first, before the shuffle and compression filters
+		bool SetBitGroom(unsigned int nsb);
+		bool SetBitRound(unsigned int nsb);
+		bool SetAbsoluteError(double bound);
+
+		// Adds the delta or delta-of-delta filter of DeltaFilter (see hdf5pp_delta.h), which must be registered first,
+		// for integer datasets; packed: frame of reference bit-packing, otherwise zig-zag varints; place it before a
+		// compression filter
+		bool SetDelta(bool packed = true);
+		bool SetDeltaOfDelta(bool packed = true);
+
+		// Returns the number of filters in the filter pipeline, or -1 on failure
+		int GetFilterCount();
+
+		enum class AllocTime {
+			Default = H5D_ALLOC_TIME_DEFAULT,		// depends on the layout: Early for Compact, Late for Contiguous, Incremental for Chunked
+			Early = H5D_ALLOC_TIME_EARLY,			// when the dataset is created
+			Late = H5D_ALLOC_TIME_LATE,				// when data is first written
+			Incremental = H5D_ALLOC_TIME_INCR		// chunk by chunk, as data is written
+		};
+		// Sets/Gets when storage is allocated for the raw data
+		bool SetAllocTime(AllocTime t);
+		bool GetAllocTime(AllocTime& t);
+
+		enum class FillTime {
+			Alloc = H5D_FILL_TIME_ALLOC,			// storage is filled with the fill value when it is allocated
+			Never = H5D_FILL_TIME_NEVER,			// never filled; unwritten elements are undefined
+			IfSet = H5D_FILL_TIME_IFSET				// filled when allocated only if a fill value is set
+		};
+		// Sets/Gets when the fill value is written to newly allocated storage
+		bool SetFillTime(FillTime t);
+		bool GetFillTime(FillTime& t);
+
+		// Adds a mapping to a virtual dataset, which stitches datasets of the same file (src_file ".") or of other
+		// files into one array without copying data; also sets the layout to Virtual
+		// the elements selected in vspace, whose extent is that of the virtual dataset, come from the elements
+		// selected in src_space of the source dataset; when the selection in vspace is unlimited, src_file and
+		// src_dset may name a series of sources printf style: %b is replaced by the block number, %% is a %
+		bool AddVirtualMapping(const Dataspace& vspace, const char* src_file, const char* src_dset, const Dataspace& src_space);
+
+		// Maps a whole source dataset of extent src_dims to the block at start of a virtual dataset of extent vdims
+		// a source of lower rank fills the last dimensions of the block, e.g. a 1D source is a row of a 2D dataset
+		bool AddVirtualMapping(const std::vector<hsize_t>& vdims, const std::vector<hsize_t>& start, const char* src_file, const char* src_dset, const std::vector<hsize_t>& src_dims);
+
+		// Maps a series of whole source datasets of extent src_dims along the first dimension of vspace, which
+		// must be unlimited: block b of the virtual dataset is the source whose names have %b replaced by b
+		bool AddVirtualSeries(const Dataspace& vspace, const char* src_file, const char* src_dset, const std::vector<hsize_t>& src_dims);
+
+		// Gets the number of mappings of a virtual dataset, and mapping index: the names of the source file and
+		// dataset, the selection in the virtual dataset and the selection in the source dataset
+		bool GetVirtualCount(size_t& count);
+		bool GetVirtualMapping(size_t index, std::string& src_file, std::string& src_dset, Dataspace& vspace, Dataspace& src_space);
 	protected:
 		explicit DatasetCreationPropertyList(hid_t hid);
 		friend class Dataset;
@@ -115,6 +263,11 @@ namespace HDF5 {
 		bool SetFileSpaceStrategy(FileSpaceStrategy strategy, bool persist, hsize_t threshold);
 		bool GetFileSpaceStrategy(FileSpaceStrategy& strategy, bool& persist, hsize_t& threshold);
 
+		// Sets paged aggregation: file space is allocated in pages of page_size bytes, so metadata and raw data
+		// end up in separate page-aligned blocks that a page buffer can serve; persisting free space lets
+		// partially used pages be reused after the file is reopened
+		bool SetPagedAggregation(hsize_t page_size, bool persist = true, hsize_t threshold = 1);
+
 		// Sets/Gets number of shared object header message indexes
 		bool SetSharedMesgIndexesCount(unsigned int nindexes);
 		bool GetSharedMesgIndexesCount(unsigned int& nindexes);
@@ -141,6 +294,53 @@ namespace HDF5 {
 
 		bool Attach(hid_t hid) override;
 
+		// Sets/Gets the range of library versions used when writing objects to the file
+		// defaults are H5F_LIBVER_EARLIEST and H5F_LIBVER_LATEST
+		bool SetLibraryVersionBounds(H5F_libver_t low, H5F_libver_t high);
+		bool GetLibraryVersionBounds(H5F_libver_t& low, H5F_libver_t& high);
+
+		// Sets/Gets the initial metadata cache configuration of files opened with this list
+		bool SetMDCConfig(H5AC_cache_config_t& cfg);
+		bool GetMDCConfig(H5AC_cache_config_t& cfg);
+
+		// Sets/Gets the metadata cache image configuration
+		// when generate_image is set, the contents of the metadata cache are written to the file as a single
+		// block on close and loaded with a single read on the next open, instead of piecemeal on demand
+		bool SetMDCImageConfig(H5AC_cache_image_config_t& cfg);
+		bool GetMDCImageConfig(H5AC_cache_image_config_t& cfg);
+
+		// Turns on cache image generation for files that are reopened often
+		// entry_ageout is the number of times an entry may be carried over unused from image to image
+		// (H5AC__CACHE_IMAGE__ENTRY_AGEOUT__NONE keeps all entries); also raises the low library
+		// version bound to H5F_LIBVER_V110, which cache images require
+		// the image is written when a file opened read-write with this list is closed; it is not
+		// supported with SWMR or parallel HDF5
+		bool EnableMDCImage(int entry_ageout = H5AC__CACHE_IMAGE__ENTRY_AGEOUT__NONE);
+
+		// Sets/Gets the page buffer size and the minimum percentages of it reserved for metadata and raw data pages
+		// only files created with paged aggregation can be opened with a page buffer; buf_size must be a
+		// multiple of the file space page size
+		bool SetPageBufferSize(size_t buf_size, unsigned int min_meta_perc = 0, unsigned int min_raw_perc = 0);
+		bool GetPageBufferSize(size_t& buf_size, unsigned int& min_meta_perc, unsigned int& min_raw_perc);
+
+		// Selects the file driver: POSIX I/O (the default), buffered C stdio, or memory (core), which grows
+		// the file image by increment bytes and writes it to the file on close if backing_store is set
+		bool SetSec2Driver();
+		bool SetStdioDriver();
+		bool SetCoreDriver(size_t increment, bool backing_store);
+
+		// Selects a driver written in C++ (see hdf5pp_vfd.h); the list keeps its own copy of factory
+		bool SetDriver(const VirtualFileDriverFactory& factory);
+
+		// Returns the identifier of the file driver (compare with H5FD_SEC2, H5FD_CORE, ...), or H5I_INVALID_HID
+		hid_t GetDriver();
+
+		// Sets the initial file image used by the core driver; buf is copied through the file image callbacks
+		// (by default with malloc and memcpy), so set the callbacks first
+		bool SetFileImage(void* buf, size_t buf_len);
+
+		// Sets the callbacks that allocate, copy and free the file image of this list and of files opened with it
+		bool SetFileImageCallbacks(H5FD_file_image_callbacks_t& callbacks);
 
 	protected:
 		explicit FileAccessPropertyList(hid_t hid);
@@ -155,12 +355,37 @@ namespace HDF5 {
 		virtual ~DatasetAccessPropertyList();
 
 		bool Attach(hid_t hid) override;
+
+		// Sets/Gets the raw data chunk cache of the dataset: number of hash table slots (ideally a prime about
+		// 100 times the number of chunks that fit in the cache), size in bytes, and the preemption policy w0
+		// (0 to 1; 1 evicts fully read or written chunks first)
+		// H5D_CHUNK_CACHE_NSLOTS_DEFAULT, H5D_CHUNK_CACHE_NBYTES_DEFAULT and H5D_CHUNK_CACHE_W0_DEFAULT keep the
+		// file's setting
+		bool SetChunkCache(size_t nslots, size_t nbytes, double w0);
+		bool GetChunkCache(size_t& nslots, size_t& nbytes, double& w0);
+
+		enum class VirtualView {
+			FirstMissing = H5D_VDS_FIRST_MISSING,	// up to the first missing source of a printf style mapping
+			LastAvailable = H5D_VDS_LAST_AVAILABLE	// up to the last source found; missing ones read as fill values
+		};
+		// Sets/Gets how far a virtual dataset with unlimited mappings extends
+		bool SetVirtualView(VirtualView view);
+		bool GetVirtualView(VirtualView& view);
+
+		// Sets/Gets how many missing sources of a printf style mapping are skipped before the search for more stops
+		bool SetVirtualPrintfGap(hsize_t gap_size);
+		bool GetVirtualPrintfGap(hsize_t& gap_size);
+
+		// Sets/Gets the directory prepended to the relative source file names of a virtual dataset; the default is
+		// the HDF5_VDS_PREFIX environment variable
+		bool SetVirtualPrefix(const char* prefix);
+		bool GetVirtualPrefix(std::string& prefix);
 	protected:
 		explicit DatasetAccessPropertyList(hid_t hid);
 		friend class Dataset;
 	};
 
-	class HDF5PP_API DatatypeCreationPropertyList : public PropertyList
+	class HDF5PP_API DatatypeCreationPropertyList : public ObjectCreationPropertyList
 	{
 	public:
 		DatatypeCreationPropertyList();
@@ -0,0 +1,423 @@
+#include "pch.h"
+#include "hdf5pp_quantize.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+namespace HDF5 {
+
+	namespace {
+
+		// the filter parameters are the method, the element size, then the number of significant bits, or the
+		// bits of the double bound, low half first
+		const size_t ParameterCount = 4;
+
+		template <typename T>
+		struct IEEE;
+
+		template <>
+		struct IEEE<float> {
+			typedef uint32_t Bits;
+			static const int MantissaBits = 23;
+			static const int Bias = 127;
+		};
+
+		template <>
+		struct IEEE<double> {
+			typedef uint64_t Bits;
+			static const int MantissaBits = 52;
+			static const int Bias = 1023;
+		};
+
+		template <typename T>
+		using BitsOf = typename IEEE<T>::Bits;
+
+		template <typename T>
+		BitsOf<T> SignMask()
+		{
+			return (BitsOf<T>)1 << (sizeof(T) * 8 - 1);
+		}
+
+		// all ones for infinities and NaNs
+		template <typename T>
+		BitsOf<T> ExponentMask()
+		{
+			return ~SignMask<T>() & ~(((BitsOf<T>)1 << IEEE<T>::MantissaBits) - 1);
+		}
+
+		// the number of mantissa bits below nsb significant bits, or -1 if T does not have nsb
+		template <typename T>
+		int DroppedBits(double nsb)
+		{
+			if (!(nsb >= 1 && nsb <= IEEE<T>::MantissaBits + 1) || nsb != std::floor(nsb)) {
+				return -1;
+			}
+			return IEEE<T>::MantissaBits + 1 - (int)nsb;
+		}
+
+		// the exponent of the grid of multiples of 2^k that rounds within bound; 2^k must be a finite T and bound
+		// a normal one
+		template <typename T>
+		bool GridExponent(double bound, int& k)
+		{
+			if (!std::isfinite(bound) || !(bound >= std::numeric_limits<T>::min())) {
+				return false;
+			}
+			k = std::ilogb(bound) + 1;
+			return k <= IEEE<T>::Bias;
+		}
+
+		// the loops on whole arrays are branch free, for the compiler to vectorize them
+		template <typename T>
+		void Groom(BitsOf<T>* v, size_t count, int drop)
+		{
+			typedef BitsOf<T> Bits;
+			if (drop <= 0) {
+				return;
+			}
+			const Bits sign = SignMask<T>();
+			const Bits exponent = ExponentMask<T>();
+			const Bits low = ((Bits)1 << drop) - 1;
+			for (size_t i = 0; i < count; ++i) {
+				Bits x = v[i];
+				// zeros, infinities and NaNs are kept; even elements are shaved, odd ones set
+				Bits keep = (Bits)0 - (Bits)((x & exponent) == exponent || (x & ~sign) == 0);
+				Bits set = (Bits)0 - (Bits)(i & 1);
+				Bits y = (x & ~low) | (low & set);
+				v[i] = (x & keep) | (y & ~keep);
+			}
+		}
+
+		template <typename T>
+		bool Round(BitsOf<T>* v, size_t count, int drop)
+		{
+			typedef BitsOf<T> Bits;
+			if (drop <= 0) {
+				return true;
+			}
+			const Bits exponent = ExponentMask<T>();
+			const Bits low = ((Bits)1 << drop) - 1;
+			const Bits half = (Bits)1 << (drop - 1);
+			Bits overflow{ 0 };
+			for (size_t i = 0; i < count; ++i) {
+				Bits x = v[i];
+				// a carry out of the mantissa steps the exponent up, as rounding should; infinities and NaNs are
+				// kept, and so are values that would round to infinity
+				Bits y = (x + half) & ~low;
+				Bits special = (Bits)((x & exponent) == exponent);
+				Bits bad = ~special & (Bits)((y & exponent) == exponent);
+				Bits keep = (Bits)0 - (special | bad);
+				overflow |= bad;
+				v[i] = (x & keep) | (y & ~keep);
+			}
+			return overflow == 0;
+		}
+
+		template <typename T>
+		bool RoundToGrid(BitsOf<T>* v, size_t count, int k)
+		{
+			typedef BitsOf<T> Bits;
+			const int m = IEEE<T>::MantissaBits;
+			const Bits sign = SignMask<T>();
+			const Bits exponent = ExponentMask<T>();
+			bool ok{ true };
+			for (size_t i = 0; i < count; ++i) {
+				Bits x = v[i];
+				if ((x & exponent) == exponent) {
+					continue;
+				}
+				// mantissa bit j (1 first) of x is worth 2^(e - j): the bits worth less than 2^k go
+				int keep = (int)((x & exponent) >> m) - IEEE<T>::Bias - k;
+				if (keep >= m) {
+					continue;
+				}
+				if (keep >= 0) {
+					int drop = m - keep;
+					Bits y = (x + ((Bits)1 << (drop - 1))) & ~(((Bits)1 << drop) - 1);
+					if ((y & exponent) == exponent) {
+						ok = false;
+						continue;
+					}
+					v[i] = y;
+				}
+				else if (keep == -1) {
+					// 2^(k - 1) <= |x| < 2^k
+					v[i] = (x & sign) | ((Bits)(k + IEEE<T>::Bias) << m);
+				}
+				else {
+					v[i] = x & sign;
+				}
+			}
+			return ok;
+		}
+
+		template <typename T>
+		bool CheckGroomed(const BitsOf<T>* v, size_t count, int drop)
+		{
+			typedef BitsOf<T> Bits;
+			if (drop <= 0) {
+				return true;
+			}
+			const Bits exponent = ExponentMask<T>();
+			const Bits low = ((Bits)1 << drop) - 1;
+			Bits bad{ 0 };
+			for (size_t i = 0; i < count; ++i) {
+				Bits x = v[i];
+				Bits t = x & low;
+				bad |= (Bits)((x & exponent) != exponent && t != 0 && t != low);
+			}
+			return bad == 0;
+		}
+
+		template <typename T>
+		bool CheckRounded(const BitsOf<T>* v, size_t count, int drop)
+		{
+			typedef BitsOf<T> Bits;
+			if (drop <= 0) {
+				return true;
+			}
+			const Bits exponent = ExponentMask<T>();
+			const Bits low = ((Bits)1 << drop) - 1;
+			Bits bad{ 0 };
+			for (size_t i = 0; i < count; ++i) {
+				Bits x = v[i];
+				bad |= (Bits)((x & exponent) != exponent && (x & low) != 0);
+			}
+			return bad == 0;
+		}
+
+		template <typename T>
+		bool CheckGrid(const BitsOf<T>* v, size_t count, int k)
+		{
+			typedef BitsOf<T> Bits;
+			const int m = IEEE<T>::MantissaBits;
+			const Bits sign = SignMask<T>();
+			const Bits exponent = ExponentMask<T>();
+			for (size_t i = 0; i < count; ++i) {
+				Bits x = v[i];
+				if ((x & exponent) == exponent) {
+					continue;
+				}
+				// values below 2^k are zeros
+				int keep = (int)((x & exponent) >> m) - IEEE<T>::Bias - k;
+				if (keep < 0 ? (x & ~sign) != 0 : keep < m && (x & (((Bits)1 << (m - keep)) - 1)) != 0) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		template <typename T>
+		bool QuantizeBits(BitsOf<T>* v, size_t count, QuantizeFilter::Method method, double param)
+		{
+			int drop{ -1 };
+			int k{ 0 };
+			switch (method) {
+			case QuantizeFilter::Method::BitGroom:
+				drop = DroppedBits<T>(param);
+				if (drop < 0) {
+					return false;
+				}
+				Groom<T>(v, count, drop);
+				return true;
+			case QuantizeFilter::Method::BitRound:
+				drop = DroppedBits<T>(param);
+				return drop >= 0 && Round<T>(v, count, drop);
+			case QuantizeFilter::Method::Absolute:
+				return GridExponent<T>(param, k) && RoundToGrid<T>(v, count, k);
+			}
+			return false;
+		}
+
+		template <typename T>
+		bool CheckBits(const BitsOf<T>* v, size_t count, QuantizeFilter::Method method, double param)
+		{
+			int drop{ -1 };
+			int k{ 0 };
+			switch (method) {
+			case QuantizeFilter::Method::BitGroom:
+				drop = DroppedBits<T>(param);
+				return drop >= 0 && CheckGroomed<T>(v, count, drop);
+			case QuantizeFilter::Method::BitRound:
+				drop = DroppedBits<T>(param);
+				return drop >= 0 && CheckRounded<T>(v, count, drop);
+			case QuantizeFilter::Method::Absolute:
+				return GridExponent<T>(param, k) && CheckGrid<T>(v, count, k);
+			}
+			return false;
+		}
+
+		template <typename T>
+		bool IsValid(QuantizeFilter::Method method, double param)
+		{
+			int k{ 0 };
+			return method == QuantizeFilter::Method::Absolute ? GridExponent<T>(param, k) : DroppedBits<T>(param) >= 0;
+		}
+
+		// values of T are not accessed through integer pointers: they go through a block of bits
+		template <typename T>
+		bool QuantizeValues(T* values, size_t count, QuantizeFilter::Method method, double param)
+		{
+			// even, so that BitGroom alternates across blocks
+			const size_t BlockSize = 1024;
+			BitsOf<T> block[BlockSize];
+			bool ok{ IsValid<T>(method, param) };
+			for (size_t i = 0; ok && i < count; i += BlockSize) {
+				auto n = std::min(BlockSize, count - i);
+				memcpy(block, values + i, n * sizeof(T));
+				ok = QuantizeBits<T>(block, n, method, param);
+				memcpy(values + i, block, n * sizeof(T));
+			}
+			return ok;
+		}
+
+		bool ParseParameters(const unsigned int* cd_values, size_t cd_nelmts, QuantizeFilter::Method& method, size_t& elem_size, double& param)
+		{
+			if (cd_nelmts < ParameterCount) {
+				return false;
+			}
+			method = (QuantizeFilter::Method)cd_values[0];
+			elem_size = cd_values[1];
+			switch (method) {
+			case QuantizeFilter::Method::BitGroom:
+			case QuantizeFilter::Method::BitRound:
+				param = cd_values[2];
+				return true;
+			case QuantizeFilter::Method::Absolute:
+			{
+				uint64_t bits = cd_values[2] | ((uint64_t)cd_values[3] << 32);
+				memcpy(&param, &bits, sizeof(param));
+				return true;
+			}
+			}
+			return false;
+		}
+
+		// copies in to out, then quantizes (encode) or checks (verify) the copy; chunks are buffers of the
+		// library, with no declared type
+		bool Process(bool encode, bool verify, const unsigned int* cd_values, size_t cd_nelmts, const void* in, size_t size, Filter::Buffer& out)
+		{
+			QuantizeFilter::Method method;
+			size_t elem_size{ 0 };
+			double param{ 0 };
+			if (!ParseParameters(cd_values, cd_nelmts, method, elem_size, param) || (elem_size != 4 && elem_size != 8) ||
+				size % elem_size != 0 || !out.Resize(size)) {
+				return false;
+			}
+			memcpy(out.GetData(), in, size);
+			auto count = size / elem_size;
+			if (elem_size == 4) {
+				auto v = (uint32_t*)out.GetData();
+				return encode ? QuantizeBits<float>(v, count, method, param) : !verify || CheckBits<float>(v, count, method, param);
+			}
+			auto v = (uint64_t*)out.GetData();
+			return encode ? QuantizeBits<double>(v, count, method, param) : !verify || CheckBits<double>(v, count, method, param);
+		}
+	}
+
+	QuantizeFilter::QuantizeFilter(bool verify /*= true*/)
+		: m_verify(verify)
+	{
+	}
+
+	unsigned int QuantizeFilter::GetSignificantBits(unsigned int digits)
+	{
+		return std::max(1u, (unsigned int)std::ceil(digits * std::log2(10.0)));
+	}
+
+	double QuantizeFilter::GetMaxError(Method method, double param)
+	{
+		switch (method) {
+		case Method::BitGroom:
+			return std::ldexp(1.0, 1 - (int)param);
+		case Method::BitRound:
+			return std::ldexp(1.0, -(int)param);
+		case Method::Absolute:
+			return param;
+		}
+		return 0;
+	}
+
+	bool QuantizeFilter::Quantize(float* values, size_t count, Method method, double param)
+	{
+		return QuantizeValues(values, count, method, param);
+	}
+
+	bool QuantizeFilter::Quantize(double* values, size_t count, Method method, double param)
+	{
+		return QuantizeValues(values, count, method, param);
+	}
+
+	std::vector<unsigned int> QuantizeFilter::MakeParameters(Method method, double param)
+	{
+		std::vector<unsigned int> cd_values(ParameterCount, 0);
+		cd_values[0] = (unsigned int)method;
+		if (method == Method::Absolute) {
+			uint64_t bits{ 0 };
+			memcpy(&bits, &param, sizeof(param));
+			cd_values[2] = (unsigned int)bits;
+			cd_values[3] = (unsigned int)(bits >> 32);
+		}
+		else {
+			cd_values[2] = param > 0 ? (unsigned int)param : 0;
+		}
+		return cd_values;
+	}
+
+	bool QuantizeFilter::GetBound(hid_t dcpl_id, Method& method, double& param)
+	{
+		unsigned int flags{ 0 };
+		std::vector<unsigned int> cd_values;
+		size_t elem_size{ 0 };
+		return GetParameters(dcpl_id, ID, flags, cd_values) && ParseParameters(cd_values.data(), cd_values.size(), method, elem_size, param);
+	}
+
+	const char* QuantizeFilter::GetName() const
+	{
+		return "hdf5pp quantize";
+	}
+
+	bool QuantizeFilter::Encode(const unsigned int* cd_values, size_t cd_nelmts, const void* in, size_t size, Buffer& out) const
+	{
+		return Process(true, m_verify, cd_values, cd_nelmts, in, size, out);
+	}
+
+	bool QuantizeFilter::Decode(const unsigned int* cd_values, size_t cd_nelmts, const void* in, size_t size, Buffer& out) const
+	{
+		return Process(false, m_verify, cd_values, cd_nelmts, in, size, out);
+	}
+
+	bool QuantizeFilter::CanApply(hid_t /*dcpl_id*/, hid_t type_id, hid_t /*space_id*/) const
+	{
+		// the bits are those of the processor's floats
+		return H5Tequal(type_id, H5T_NATIVE_FLOAT) > 0 || H5Tequal(type_id, H5T_NATIVE_DOUBLE) > 0;
+	}
+
+	bool QuantizeFilter::SetLocal(hid_t dcpl_id, hid_t type_id, hid_t space_id) const
+	{
+		unsigned int flags{ 0 };
+		std::vector<unsigned int> cd_values;
+		if (!GetParameters(dcpl_id, ID, flags, cd_values) || cd_values.size() < ParameterCount) {
+			return false;
+		}
+		// element size 0 makes Encode leave every chunk as it is
+		if (!CanApply(dcpl_id, type_id, space_id)) {
+			cd_values[1] = 0;
+			return SetParameters(dcpl_id, ID, flags, cd_values);
+		}
+		size_t elem_size = H5Tget_size(type_id);
+		cd_values[1] = (unsigned int)elem_size;
+
+		// a parameter the datatype cannot have fails the creation of the dataset
+		Method method;
+		double param{ 0 };
+		if (!ParseParameters(cd_values.data(), cd_values.size(), method, elem_size, param) ||
+			!(elem_size == 4 ? IsValid<float>(method, param) : elem_size == 8 && IsValid<double>(method, param))) {
+			return false;
+		}
+		return SetParameters(dcpl_id, ID, flags, cd_values);
+	}
+}
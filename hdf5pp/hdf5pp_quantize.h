@@ -0,0 +1,63 @@
+// hdf5pp_quantize.h
+// HDF5::QuantizeFilter is a lossy filter for float and double datasets: it keeps the precision the data really have
+// and sets the bits below it to patterns that the compression filter after it packs well
+// Method::BitGroom keeps nsb significant bits and alternately clears and sets the bits below them (relative error
+// below 2^(1 - nsb)); Method::BitRound rounds to nsb significant bits (relative error at most 2^-nsb);
+// Method::Absolute rounds to multiples of the largest power of 2 up to twice the bound (error at most the bound)
+// the method and its parameter are kept in the filter parameters (see GetBound), and reading a chunk checks that
+// its values hold no more precision than the method leaves, so a reader can rely on the bound
+// the relative bounds hold for normal values; infinities and NaNs are kept; a chunk with values that would round
+// to infinity is stored unquantized, the filter being optional
+// the filter has a testing identifier (DatasetCreationPropertyList::SetBitGroom, SetBitRound, SetAbsoluteError)
+//
+#pragma once
+
+#include "hdf5pp_filter.h"
+
+namespace HDF5 {
+
+	class HDF5PP_API QuantizeFilter : public Filter
+	{
+	public:
+		enum class Method {
+			BitGroom = 1,
+			BitRound = 2,
+			Absolute = 3
+		};
+
+		static const H5Z_filter_t ID = 257;
+
+		// verify: Decode fails on chunks holding more precision than their parameters allow
+		explicit QuantizeFilter(bool verify = true);
+
+		// Returns the number of significant bits for digits significant decimal digits
+		static unsigned int GetSignificantBits(unsigned int digits);
+
+		// Returns the largest error of method with param: relative to the value for BitGroom and BitRound, absolute
+		// for Absolute
+		static double GetMaxError(Method method, double param);
+
+		// Quantizes count values in place; param is the number of significant bits (1-24 for float, 1-53 for double)
+		// for BitGroom and BitRound, the error bound for Absolute; fails on values that would round to infinity
+		static bool Quantize(float* values, size_t count, Method method, double param);
+		static bool Quantize(double* values, size_t count, Method method, double param);
+
+		// Returns the filter parameters of method with param; the element size is set when the dataset is created
+		static std::vector<unsigned int> MakeParameters(Method method, double param);
+
+		// Gets the method and parameter of the quantization filter in the pipeline of dcpl_id; false if there is none
+		static bool GetBound(hid_t dcpl_id, Method& method, double& param);
+
+		bool IsVerifying() const { return m_verify; }
+
+		H5Z_filter_t GetID() const override { return ID; }
+		const char* GetName() const override;
+		bool Encode(const unsigned int* cd_values, size_t cd_nelmts, const void* in, size_t size, Buffer& out) const override;
+		bool Decode(const unsigned int* cd_values, size_t cd_nelmts, const void* in, size_t size, Buffer& out) const override;
+		bool CanApply(hid_t dcpl_id, hid_t type_id, hid_t space_id) const override;
+		bool SetLocal(hid_t dcpl_id, hid_t type_id, hid_t space_id) const override;
+
+	protected:
+		bool m_verify;
+	};
+}
@@ -0,0 +1,432 @@
+#include "pch.h"
+#include "hdf5pp_shard.h"
+#include "hdf5pp_dset.h"
+#include "hdf5pp_dspace.h"
+#include "hdf5pp_file.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace HDF5 {
+
+	namespace {
+
+		// a block handed to a worker (rows > 0), the stop request (rows == 0), and the replies to both
+		struct Message {
+			uint32_t slot;
+			uint32_t ok;
+			uint64_t rows;
+		};
+
+		// the part of the writer a worker needs
+		struct ShardSpec {
+			std::string filename;
+			const char* dataset_name;
+			Datatype* dtype;
+			std::vector<hsize_t> row_dims;
+			const PropertyList* dcpl;
+			size_t block_rows;
+			size_t block_bytes;
+			char* slots;			// the worker's slots
+		};
+
+#ifndef _WIN32
+		bool SendMessage(int sock, const Message& msg)
+		{
+#ifdef MSG_NOSIGNAL
+			const int flags = MSG_NOSIGNAL;
+#else
+			const int flags = 0;
+#endif
+			auto p = (const char*)&msg;
+			size_t done{ 0 };
+			while (done < sizeof(msg)) {
+				auto n = send(sock, p + done, sizeof(msg) - done, flags);
+				if (n < 0 && errno == EINTR) {
+					continue;
+				}
+				if (n <= 0) {
+					return false;
+				}
+				done += (size_t)n;
+			}
+			return true;
+		}
+
+		// false if the peer went away
+		bool ReceiveMessage(int sock, Message& msg)
+		{
+			auto p = (char*)&msg;
+			size_t done{ 0 };
+			while (done < sizeof(msg)) {
+				auto n = recv(sock, p + done, sizeof(msg) - done, 0);
+				if (n < 0 && errno == EINTR) {
+					continue;
+				}
+				if (n <= 0) {
+					return false;
+				}
+				done += (size_t)n;
+			}
+			return true;
+		}
+
+		// the worker process: appends the blocks it receives to its shard until asked to stop; returns the exit code
+		int RunWorker(int sock, const ShardSpec& spec)
+		{
+			auto rank = spec.row_dims.size() + 1;
+			std::vector<hsize_t> dims(1, 0), max_dims(1, H5S_UNLIMITED);
+			dims.insert(dims.end(), spec.row_dims.begin(), spec.row_dims.end());
+			max_dims.insert(max_dims.end(), spec.row_dims.begin(), spec.row_dims.end());
+
+			DatasetCreationPropertyList dcpl;
+			if (spec.dcpl->IsValid()) {
+				dcpl.Attach(H5Pcopy((hid_t)*spec.dcpl));
+			}
+			DatasetCreationPropertyList::Layout layout;
+			if (!dcpl.GetLayout(layout) || layout != DatasetCreationPropertyList::Layout::Chunked) {
+				auto chunk = dims;
+				chunk[0] = spec.block_rows;
+				dcpl.SetChunk(chunk);
+			}
+
+			File f;
+			if (!f.Create(spec.filename.c_str(), H5F_ACC_TRUNC)) {
+				return 1;
+			}
+			auto dset = f.CreateDataset(spec.dataset_name, *spec.dtype, Dataspace(dims, max_dims), PropertyList(), dcpl);
+			if (!dset.IsValid()) {
+				return 1;
+			}
+
+			std::vector<hsize_t> start(rank, 0), count = dims;
+			Message msg;
+			while (ReceiveMessage(sock, msg)) {
+				if (msg.rows == 0) {
+					// the file is closed for good when dset goes too; everything is on disk by then
+					msg.ok = f.FlushFile(Location::FlushScope::Local) && f.Close();
+					SendMessage(sock, msg);
+					return msg.ok ? 0 : 1;
+				}
+				count[0] = msg.rows;
+				dims[0] = start[0] + msg.rows;
+				Dataspace mem_dspace(count);
+				msg.ok = dset.SetExtent(dims);
+				if (msg.ok) {
+					auto file_dspace = dset.GetDataspace();
+					msg.ok = file_dspace.SelectHyperslab(Dataspace::SelectionOperation::Set, start.data(), nullptr, count.data(), nullptr) &&
+						dset.Write(*spec.dtype, mem_dspace, file_dspace, spec.slots + msg.slot * spec.block_bytes);
+				}
+				start[0] += msg.rows;
+				if (!SendMessage(sock, msg) || !msg.ok) {
+					return 1;
+				}
+			}
+			// the writer went away without asking to stop
+			return 1;
+		}
+#endif
+	}
+
+	ShardedWriter::ShardedWriter()
+	{
+	}
+
+	ShardedWriter::~ShardedWriter()
+	{
+		Abort();
+	}
+
+	std::string ShardedWriter::GetShardName(unsigned int k) const
+	{
+		return m_filename + "." + std::to_string(k);
+	}
+
+	bool ShardedWriter::Start(const char* filename, const char* dataset_name, const Datatype& dtype, const std::vector<hsize_t>& row_dims,
+		const PropertyList& dcpl /*= PropertyList()*/, const Config& cfg /*= Config()*/)
+	{
+#ifdef _WIN32
+		return false;
+#else
+		if (!m_pids.empty() || cfg.workers == 0 || cfg.slots == 0) {
+			return false;
+		}
+		m_filename = filename;
+		m_datasetName = dataset_name;
+		m_dtype.reset(new Datatype(dtype));
+		m_rowDims = row_dims;
+		m_cfg = cfg;
+		m_rowBytes = m_dtype->GetSize();
+		for (auto d : row_dims) {
+			m_rowBytes *= (size_t)d;
+		}
+		if (m_rowBytes == 0) {
+			return false;
+		}
+		m_blockRows = std::max<size_t>(1, cfg.block_size / m_rowBytes);
+		auto block_bytes = m_blockRows * m_rowBytes;
+		m_sharedSize = block_bytes * cfg.slots * cfg.workers;
+		auto shared = mmap(nullptr, m_sharedSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+		if (shared == MAP_FAILED) {
+			m_sharedSize = 0;
+			return false;
+		}
+		m_shared = (char*)shared;
+		m_rows = m_blocks = 0;
+		m_current = nullptr;
+		m_fill = 0;
+		m_failed = false;
+
+		ShardSpec spec;
+		spec.dataset_name = m_datasetName.c_str();
+		spec.dtype = m_dtype.get();
+		spec.row_dims = m_rowDims;
+		spec.dcpl = &dcpl;
+		spec.block_rows = m_blockRows;
+		spec.block_bytes = block_bytes;
+		for (unsigned int w = 0; w < cfg.workers; ++w) {
+			int pair[2];
+			if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) < 0) {
+				Stop();
+				return false;
+			}
+#ifdef SO_NOSIGPIPE
+			int on{ 1 };
+			setsockopt(pair[0], SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+			setsockopt(pair[1], SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+			auto pid = fork();
+			if (pid == 0) {
+				// only this worker's end stays open, so every worker sees the writer go away
+				for (auto s : m_sockets) {
+					close(s);
+				}
+				close(pair[0]);
+				spec.filename = GetShardName(w);
+				spec.slots = m_shared + (size_t)w * cfg.slots * block_bytes;
+				// skip the exit handlers: they belong to the writer's process and its HDF5 objects
+				_exit(RunWorker(pair[1], spec));
+			}
+			close(pair[1]);
+			if (pid < 0) {
+				close(pair[0]);
+				Stop();
+				return false;
+			}
+			m_pids.push_back((int)pid);
+			m_sockets.push_back(pair[0]);
+			m_free.emplace_back();
+			for (unsigned int s = cfg.slots; s > 0; --s) {
+				m_free.back().push_back(s - 1);
+			}
+		}
+		return true;
+#endif
+	}
+
+	bool ShardedWriter::WaitReply(unsigned int w, bool& stopped)
+	{
+#ifdef _WIN32
+		return false;
+#else
+		Message msg;
+		if (!ReceiveMessage(m_sockets[w], msg) || !msg.ok) {
+			m_failed = true;
+			return false;
+		}
+		stopped = msg.rows == 0;
+		if (!stopped) {
+			m_free[w].push_back(msg.slot);
+		}
+		return true;
+#endif
+	}
+
+	bool ShardedWriter::AcquireSlot()
+	{
+		auto w = (unsigned int)(m_blocks % m_cfg.workers);
+		bool stopped{ false };
+		while (m_free[w].empty()) {
+			if (!WaitReply(w, stopped) || stopped) {
+				return false;
+			}
+		}
+		m_slot = m_free[w].back();
+		m_free[w].pop_back();
+		m_current = m_shared + ((size_t)w * m_cfg.slots + m_slot) * m_blockRows * m_rowBytes;
+		m_fill = 0;
+		return true;
+	}
+
+	bool ShardedWriter::Dispatch()
+	{
+#ifdef _WIN32
+		return false;
+#else
+		auto w = (unsigned int)(m_blocks % m_cfg.workers);
+		Message msg{ m_slot, 1, m_fill };
+		if (!SendMessage(m_sockets[w], msg)) {
+			m_failed = true;
+			return false;
+		}
+		++m_blocks;
+		m_current = nullptr;
+		m_fill = 0;
+		return true;
+#endif
+	}
+
+	bool ShardedWriter::Append(const void* buf, size_t nrows)
+	{
+		if (m_pids.empty() || m_failed) {
+			return false;
+		}
+		auto src = (const char*)buf;
+		while (nrows > 0) {
+			if (m_current == nullptr && !AcquireSlot()) {
+				return false;
+			}
+			auto n = std::min(nrows, m_blockRows - m_fill);
+			memcpy(m_current + m_fill * m_rowBytes, src, n * m_rowBytes);
+			m_fill += n;
+			m_rows += n;
+			src += n * m_rowBytes;
+			nrows -= n;
+			if (m_fill == m_blockRows && !Dispatch()) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool ShardedWriter::Finish()
+	{
+#ifdef _WIN32
+		return false;
+#else
+		if (m_pids.empty()) {
+			return false;
+		}
+		bool ok = !m_failed && (m_current == nullptr || m_fill == 0 || Dispatch());
+		// every worker writes out what it has, closes its shard and answers the stop request last
+		for (unsigned int w = 0; ok && w < m_cfg.workers; ++w) {
+			Message msg{ 0, 1, 0 };
+			ok = SendMessage(m_sockets[w], msg);
+		}
+		for (unsigned int w = 0; ok && w < m_cfg.workers; ++w) {
+			bool stopped{ false };
+			while (ok && !stopped) {
+				ok = WaitReply(w, stopped);
+			}
+		}
+		ok = Stop() && ok;
+		return ok && WriteMaster();
+#endif
+	}
+
+	void ShardedWriter::Abort()
+	{
+		if (!m_pids.empty()) {
+			Stop();
+		}
+	}
+
+	bool ShardedWriter::Stop()
+	{
+		bool clean{ true };
+#ifndef _WIN32
+		for (auto s : m_sockets) {
+			close(s);
+		}
+		for (auto pid : m_pids) {
+			int status{ 0 };
+			while (waitpid((pid_t)pid, &status, 0) < 0) {
+				if (errno != EINTR) {
+					status = -1;
+					break;
+				}
+			}
+			clean = clean && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+		}
+		if (m_shared != nullptr) {
+			munmap(m_shared, m_sharedSize);
+		}
+#endif
+		m_sockets.clear();
+		m_pids.clear();
+		m_free.clear();
+		m_shared = nullptr;
+		m_sharedSize = 0;
+		m_current = nullptr;
+		return clean;
+	}
+
+	bool ShardedWriter::WriteMaster()
+	{
+		auto rank = m_rowDims.size() + 1;
+		std::vector<hsize_t> vdims(1, m_rows);
+		vdims.insert(vdims.end(), m_rowDims.begin(), m_rowDims.end());
+		std::vector<hsize_t> start(rank, 0), stride(rank, 1), count(rank, 1), block = vdims;
+
+		// block b is in shard b % workers, at row (b / workers) * block rows; only the last block may be partial
+		hsize_t workers = m_cfg.workers, block_rows = m_blockRows;
+		auto last_rows = m_rows - (m_blocks > 0 ? (m_blocks - 1) * block_rows : 0);
+		DatasetCreationPropertyList dcpl;
+		for (hsize_t w = 0; w < workers && w < m_blocks; ++w) {
+			auto blocks = (m_blocks - w + workers - 1) / workers;
+			bool has_last = (m_blocks - 1) % workers == w;
+			auto full = (has_last && last_rows < block_rows) ? blocks - 1 : blocks;
+
+			std::vector<hsize_t> shard_dims = vdims;
+			shard_dims[0] = full * block_rows + (full < blocks ? last_rows : 0);
+			auto src_file = GetShardName((unsigned int)w);
+			auto slash = src_file.find_last_of("/\\");
+			if (slash != std::string::npos) {
+				src_file.erase(0, slash + 1);	// found next to the master file
+			}
+
+			if (full > 0) {
+				Dataspace vspace(vdims), src_space(shard_dims);
+				start[0] = w * block_rows;
+				stride[0] = workers * block_rows;
+				count[0] = full;
+				block[0] = block_rows;
+				std::vector<hsize_t> src_start(rank, 0), src_block = shard_dims;
+				src_block[0] = full * block_rows;
+				if (!vspace.SelectHyperslab(Dataspace::SelectionOperation::Set, start.data(), stride.data(), count.data(), block.data()) ||
+					!src_space.SelectHyperslab(Dataspace::SelectionOperation::Set, src_start.data(), nullptr, src_block.data(), nullptr) ||
+					!dcpl.AddVirtualMapping(vspace, src_file.c_str(), m_datasetName.c_str(), src_space)) {
+					return false;
+				}
+			}
+			if (full < blocks) {
+				Dataspace vspace(vdims), src_space(shard_dims);
+				std::vector<hsize_t> last_start(rank, 0), last_count = shard_dims;
+				last_start[0] = (m_blocks - 1) * block_rows;
+				last_count[0] = last_rows;
+				std::vector<hsize_t> src_start(rank, 0);
+				src_start[0] = full * block_rows;
+				if (!vspace.SelectHyperslab(Dataspace::SelectionOperation::Set, last_start.data(), nullptr, last_count.data(), nullptr) ||
+					!src_space.SelectHyperslab(Dataspace::SelectionOperation::Set, src_start.data(), nullptr, last_count.data(), nullptr) ||
+					!dcpl.AddVirtualMapping(vspace, src_file.c_str(), m_datasetName.c_str(), src_space)) {
+					return false;
+				}
+			}
+		}
+
+		File f;
+		if (!f.Create(m_filename.c_str(), H5F_ACC_TRUNC)) {
+			return false;
+		}
+		// with no rows there is nothing to map, and the dataset is an ordinary empty one
+		auto dset = f.CreateDataset(m_datasetName.c_str(), *m_dtype, Dataspace(vdims), PropertyList(), m_blocks > 0 ? dcpl : DatasetCreationPropertyList());
+		return dset.IsValid() && f.Close();
+	}
+}
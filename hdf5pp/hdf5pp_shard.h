@@ -0,0 +1,94 @@
+// hdf5pp_shard.h
+// HDF5::ShardedWriter spreads the rows appended to one logical dataset over worker processes, each writing its
+// own shard file, so that filters and the library's own work run on as many cores as there are workers
+// rows are handed to the workers in blocks through shared memory, block b to worker b % workers; Finish then
+// writes the master file, whose virtual dataset maps the blocks of every shard back in order (one mapping per
+// shard, plus one for the last block if it is partial), so readers see a single dataset
+// POSIX only (fork); Start must be called while no other thread is using the HDF5 library
+//
+#pragma once
+
+#include "hdf5pp_dtype.h"
+#include "hdf5pp_proplist.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace HDF5 {
+
+	class HDF5PP_API ShardedWriter
+	{
+	public:
+		struct Config {
+			Config() : workers(4), block_size(4 * 1024 * 1024), slots(2) {}
+
+			unsigned int workers;	// worker processes, one shard each
+			size_t block_size;		// bytes handed to a worker at a time, rounded down to whole rows (one at least)
+			unsigned int slots;		// blocks in flight per worker; Append waits for one of them to be written
+		};
+
+		ShardedWriter();
+		ShardedWriter(const ShardedWriter&) = delete;
+		ShardedWriter& operator=(const ShardedWriter&) = delete;
+		virtual ~ShardedWriter();		// calls Abort if Finish was not called
+
+		// Starts the workers for dataset_name of the master file filename, a dataset of rows of row_dims elements
+		// of dtype (no dims: one element per row); shard k is filename.k, next to the master file, with a
+		// dataset of the same name created with dcpl, chunked by blocks unless dcpl sets a chunk size
+		bool Start(const char* filename, const char* dataset_name, const Datatype& dtype, const std::vector<hsize_t>& row_dims,
+			const PropertyList& dcpl = PropertyList(), const Config& cfg = Config());
+
+		// Copies nrows rows, laid out in memory as dtype, to the shared blocks, handing each full block to its worker
+		bool Append(const void* buf, size_t nrows);
+
+		// Hands over the last partial block, waits for the workers to close their shards and writes the master file
+		bool Finish();
+
+		// Stops the workers without writing the master file; the shards are left as they are
+		void Abort();
+
+		// Returns the number of rows appended so far / the number of rows in a block
+		hsize_t GetRowCount() const { return m_rows; }
+		size_t GetBlockRows() const { return m_blockRows; }
+
+		// Returns the file name of shard k
+		std::string GetShardName(unsigned int k) const;
+
+	protected:
+		// takes a free slot of the worker of the current block, waiting for one if needed
+		bool AcquireSlot();
+
+		// hands the current block to its worker
+		bool Dispatch();
+
+		// waits for the next reply of worker w; a written block frees its slot
+		bool WaitReply(unsigned int w, bool& stopped);
+
+		// closes the sockets, reaps the workers and releases the shared memory; true if all workers exited cleanly
+		bool Stop();
+
+		bool WriteMaster();
+
+		std::string m_filename;
+		std::string m_datasetName;
+		std::unique_ptr<Datatype> m_dtype;
+		std::vector<hsize_t> m_rowDims;
+		Config m_cfg;
+
+		size_t m_rowBytes{ 0 };
+		size_t m_blockRows{ 0 };
+		char* m_shared{ nullptr };					// workers * slots blocks
+		size_t m_sharedSize{ 0 };
+		std::vector<int> m_pids;
+		std::vector<int> m_sockets;					// parent end of each worker's socket pair
+		std::vector<std::vector<unsigned int>> m_free;	// free slots of each worker
+
+		hsize_t m_rows{ 0 };
+		hsize_t m_blocks{ 0 };						// blocks handed over
+		char* m_current{ nullptr };					// slot of the block being filled, if any
+		unsigned int m_slot{ 0 };
+		size_t m_fill{ 0 };							// rows in the current block
+		bool m_failed{ false };
+	};
+}
@@ -0,0 +1,506 @@
+#include "pch.h"
+#include "hdf5pp_shuffle.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define HDF5PP_SHUFFLE_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// lets the AVX2 kernels be compiled without enabling AVX2 for the whole library; MSVC needs no flag for intrinsics
+#if defined(HDF5PP_SHUFFLE_X86) && (defined(__GNUC__) || defined(__clang__))
+#define HDF5PP_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define HDF5PP_TARGET_AVX2
+#endif
+
+namespace HDF5 {
+
+	namespace {
+
+		// the bitshuffle plugin version written into cd_values[0] and [1]
+		const unsigned int BitShuffleMajor = 0;
+		const unsigned int BitShuffleMinor = 4;
+
+		const size_t BitShuffleTargetBlockBytes = 8192;
+		const size_t BitShuffleMinBlock = 128;
+
+		// transposes the 8x8 bit matrix of the bytes of x: bit e of byte k becomes bit k of byte e
+		inline uint64_t TransposeBits8x8(uint64_t x)
+		{
+			uint64_t t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAULL;
+			x = x ^ t ^ (t << 7);
+			t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL;
+			x = x ^ t ^ (t << 14);
+			t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL;
+			return x ^ t ^ (t << 28);
+		}
+
+		// byte transposition of the elements from first on
+		void ByteShuffleScalar(const uint8_t* in, uint8_t* out, size_t count, size_t elem_size, size_t first)
+		{
+			for (size_t i = first; i < count; ++i) {
+				for (size_t j = 0; j < elem_size; ++j) {
+					out[j * count + i] = in[i * elem_size + j];
+				}
+			}
+		}
+
+		void ByteUnshuffleScalar(const uint8_t* in, uint8_t* out, size_t count, size_t elem_size, size_t first)
+		{
+			for (size_t i = first; i < count; ++i) {
+				for (size_t j = 0; j < elem_size; ++j) {
+					out[i * elem_size + j] = in[j * count + i];
+				}
+			}
+		}
+
+		// splits a row of 8 * nb bytes into 8 rows of nb bytes, row k holding bit k of every byte, from byte
+		// 8 * first on
+		void BitRowsScalar(const uint8_t* row, uint8_t* out, size_t nb, size_t first)
+		{
+			for (size_t b = first; b < nb; ++b) {
+				uint64_t x{ 0 };
+				for (size_t e = 0; e < 8; ++e) {
+					x |= (uint64_t)row[8 * b + e] << (8 * e);
+				}
+				x = TransposeBits8x8(x);
+				for (size_t k = 0; k < 8; ++k) {
+					out[k * nb + b] = (uint8_t)(x >> (8 * k));
+				}
+			}
+		}
+
+		void UnbitRowsScalar(const uint8_t* in, uint8_t* row, size_t nb, size_t first)
+		{
+			for (size_t b = first; b < nb; ++b) {
+				uint64_t x{ 0 };
+				for (size_t k = 0; k < 8; ++k) {
+					x |= (uint64_t)in[k * nb + b] << (8 * k);
+				}
+				x = TransposeBits8x8(x);
+				for (size_t e = 0; e < 8; ++e) {
+					row[8 * b + e] = (uint8_t)(x >> (8 * e));
+				}
+			}
+		}
+
+#ifdef HDF5PP_SHUFFLE_X86
+		// 16 elements at a time: log2(S) passes that each split even and odd bytes; returns the elements done
+		template <size_t S>
+		size_t ByteShuffleSSE2(const uint8_t* in, uint8_t* out, size_t count)
+		{
+			const __m128i low = _mm_set1_epi16(0x00ff);
+			size_t i = 0;
+			for (; i + 16 <= count; i += 16) {
+				__m128i v[S], w[S];
+				for (size_t k = 0; k < S; ++k) {
+					v[k] = _mm_loadu_si128((const __m128i*)(in + i * S + 16 * k));
+				}
+				for (size_t pass = 1; pass < S; pass *= 2) {
+					for (size_t k = 0; k < S / 2; ++k) {
+						w[k] = _mm_packus_epi16(_mm_and_si128(v[2 * k], low), _mm_and_si128(v[2 * k + 1], low));
+						w[k + S / 2] = _mm_packus_epi16(_mm_srli_epi16(v[2 * k], 8), _mm_srli_epi16(v[2 * k + 1], 8));
+					}
+					std::copy(w, w + S, v);
+				}
+				for (size_t j = 0; j < S; ++j) {
+					_mm_storeu_si128((__m128i*)(out + j * count + i), v[j]);
+				}
+			}
+			return i;
+		}
+
+		// the inverse passes interleave the bytes again
+		template <size_t S>
+		size_t ByteUnshuffleSSE2(const uint8_t* in, uint8_t* out, size_t count)
+		{
+			size_t i = 0;
+			for (; i + 16 <= count; i += 16) {
+				__m128i v[S], w[S];
+				for (size_t j = 0; j < S; ++j) {
+					v[j] = _mm_loadu_si128((const __m128i*)(in + j * count + i));
+				}
+				for (size_t pass = 1; pass < S; pass *= 2) {
+					for (size_t k = 0; k < S / 2; ++k) {
+						w[2 * k] = _mm_unpacklo_epi8(v[k], v[k + S / 2]);
+						w[2 * k + 1] = _mm_unpackhi_epi8(v[k], v[k + S / 2]);
+					}
+					std::copy(w, w + S, v);
+				}
+				for (size_t k = 0; k < S; ++k) {
+					_mm_storeu_si128((__m128i*)(out + i * S + 16 * k), v[k]);
+				}
+			}
+			return i;
+		}
+
+		// movemask collects the top bit of 16 bytes; shifting left brings the next bit to the top
+		size_t BitRowsSSE2(const uint8_t* row, uint8_t* out, size_t nb, size_t first)
+		{
+			size_t b = first;
+			for (; b + 2 <= nb; b += 2) {
+				auto v = _mm_loadu_si128((const __m128i*)(row + 8 * b));
+				for (size_t k = 8; k-- > 0;) {
+					auto m = (unsigned int)_mm_movemask_epi8(v);
+					out[k * nb + b] = (uint8_t)m;
+					out[k * nb + b + 1] = (uint8_t)(m >> 8);
+					v = _mm_slli_epi16(v, 1);
+				}
+			}
+			return b;
+		}
+
+		size_t UnbitRowsSSE2(const uint8_t* in, uint8_t* row, size_t nb, size_t first)
+		{
+			const __m128i low = _mm_set1_epi16(0x00ff);
+			size_t b = first;
+			for (; b + 2 <= nb; b += 2) {
+				// bytes b and b + 1 of the 8 bit rows, then byte b of every row followed by byte b + 1 of every row
+				short w[8];
+				for (size_t k = 0; k < 8; ++k) {
+					w[k] = (short)(in[k * nb + b] | (in[k * nb + b + 1] << 8));
+				}
+				auto v = _mm_set_epi16(w[7], w[6], w[5], w[4], w[3], w[2], w[1], w[0]);
+				v = _mm_packus_epi16(_mm_and_si128(v, low), _mm_srli_epi16(v, 8));
+				for (size_t e = 8; e-- > 0;) {
+					auto m = (unsigned int)_mm_movemask_epi8(v);
+					row[8 * b + e] = (uint8_t)m;
+					row[8 * b + 8 + e] = (uint8_t)(m >> 8);
+					v = _mm_slli_epi16(v, 1);
+				}
+			}
+			return b;
+		}
+
+		HDF5PP_TARGET_AVX2 size_t BitRowsAVX2(const uint8_t* row, uint8_t* out, size_t nb, size_t first)
+		{
+			size_t b = first;
+			for (; b + 4 <= nb; b += 4) {
+				auto v = _mm256_loadu_si256((const __m256i*)(row + 8 * b));
+				for (size_t k = 8; k-- > 0;) {
+					auto m = (uint32_t)_mm256_movemask_epi8(v);
+					for (size_t p = 0; p < 4; ++p) {
+						out[k * nb + b + p] = (uint8_t)(m >> (8 * p));
+					}
+					v = _mm256_slli_epi16(v, 1);
+				}
+			}
+			return b;
+		}
+
+		HDF5PP_TARGET_AVX2 size_t UnbitRowsAVX2(const uint8_t* in, uint8_t* row, size_t nb, size_t first)
+		{
+			// gathers bytes b to b + 3 of the 8 bit rows and regroups them by byte position: 4x4 transposes in the
+			// lanes, then the halves for rows 0-3 and 4-7 side by side
+			const __m256i by_position = _mm256_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15,
+				0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+			const __m256i halves = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+			size_t b = first;
+			for (; b + 4 <= nb; b += 4) {
+				int d[8];
+				for (size_t k = 0; k < 8; ++k) {
+					auto p = in + k * nb + b;
+					d[k] = (int)((uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+				}
+				auto v = _mm256_setr_epi32(d[0], d[1], d[2], d[3], d[4], d[5], d[6], d[7]);
+				v = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(v, by_position), halves);
+				for (size_t e = 8; e-- > 0;) {
+					auto m = (uint32_t)_mm256_movemask_epi8(v);
+					for (size_t p = 0; p < 4; ++p) {
+						row[8 * (b + p) + e] = (uint8_t)(m >> (8 * p));
+					}
+					v = _mm256_slli_epi16(v, 1);
+				}
+			}
+			return b;
+		}
+
+		bool CpuHasAVX2()
+		{
+#ifdef _MSC_VER
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7) {
+				return false;
+			}
+			// the OS must save the YMM registers
+			__cpuid(info, 1);
+			if ((info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 6) != 6) {
+				return false;
+			}
+			__cpuidex(info, 7, 0);
+			return (info[1] & (1 << 5)) != 0;
+#else
+			return __builtin_cpu_supports("avx2") != 0;
+#endif
+		}
+#endif
+
+		size_t ByteShuffleFast(const uint8_t* in, uint8_t* out, size_t count, size_t elem_size, ShuffleFilter::Kernel kernel)
+		{
+#ifdef HDF5PP_SHUFFLE_X86
+			if (kernel != ShuffleFilter::Kernel::Scalar) {
+				switch (elem_size) {
+				case 2: return ByteShuffleSSE2<2>(in, out, count);
+				case 4: return ByteShuffleSSE2<4>(in, out, count);
+				case 8: return ByteShuffleSSE2<8>(in, out, count);
+				}
+			}
+#endif
+			return 0;
+		}
+
+		size_t ByteUnshuffleFast(const uint8_t* in, uint8_t* out, size_t count, size_t elem_size, ShuffleFilter::Kernel kernel)
+		{
+#ifdef HDF5PP_SHUFFLE_X86
+			if (kernel != ShuffleFilter::Kernel::Scalar) {
+				switch (elem_size) {
+				case 2: return ByteUnshuffleSSE2<2>(in, out, count);
+				case 4: return ByteUnshuffleSSE2<4>(in, out, count);
+				case 8: return ByteUnshuffleSSE2<8>(in, out, count);
+				}
+			}
+#endif
+			return 0;
+		}
+
+		void ByteShuffleKernel(const uint8_t* in, uint8_t* out, size_t count, size_t elem_size, ShuffleFilter::Kernel kernel)
+		{
+			ByteShuffleScalar(in, out, count, elem_size, ByteShuffleFast(in, out, count, elem_size, kernel));
+		}
+
+		void ByteUnshuffleKernel(const uint8_t* in, uint8_t* out, size_t count, size_t elem_size, ShuffleFilter::Kernel kernel)
+		{
+			ByteUnshuffleScalar(in, out, count, elem_size, ByteUnshuffleFast(in, out, count, elem_size, kernel));
+		}
+
+		// tmp holds count * elem_size bytes
+		void BitShuffleKernel(const uint8_t* in, uint8_t* out, size_t count, size_t elem_size, ShuffleFilter::Kernel kernel, uint8_t* tmp)
+		{
+			ByteShuffleKernel(in, tmp, count, elem_size, kernel);
+			auto nb = count / 8;
+			for (size_t j = 0; j < elem_size; ++j) {
+				auto row = tmp + j * count;
+				auto rows = out + j * 8 * nb;
+				size_t b{ 0 };
+#ifdef HDF5PP_SHUFFLE_X86
+				if (kernel == ShuffleFilter::Kernel::AVX2) {
+					b = BitRowsAVX2(row, rows, nb, b);
+				}
+				if (kernel != ShuffleFilter::Kernel::Scalar) {
+					b = BitRowsSSE2(row, rows, nb, b);
+				}
+#endif
+				BitRowsScalar(row, rows, nb, b);
+			}
+		}
+
+		void BitUnshuffleKernel(const uint8_t* in, uint8_t* out, size_t count, size_t elem_size, ShuffleFilter::Kernel kernel, uint8_t* tmp)
+		{
+			auto nb = count / 8;
+			for (size_t j = 0; j < elem_size; ++j) {
+				auto rows = in + j * 8 * nb;
+				auto row = tmp + j * count;
+				size_t b{ 0 };
+#ifdef HDF5PP_SHUFFLE_X86
+				if (kernel == ShuffleFilter::Kernel::AVX2) {
+					b = UnbitRowsAVX2(rows, row, nb, b);
+				}
+				if (kernel != ShuffleFilter::Kernel::Scalar) {
+					b = UnbitRowsSSE2(rows, row, nb, b);
+				}
+#endif
+				UnbitRowsScalar(rows, row, nb, b);
+			}
+			ByteUnshuffleKernel(tmp, out, count, elem_size, kernel);
+		}
+
+		bool Resolve(ShuffleFilter::Kernel& kernel)
+		{
+			if (kernel == ShuffleFilter::Kernel::Auto) {
+				kernel = ShuffleFilter::GetBestKernel();
+			}
+			return ShuffleFilter::IsSupported(kernel);
+		}
+	}
+
+	ShuffleFilter::ShuffleFilter(Mode mode /*= Mode::Bit*/, Kernel kernel /*= Kernel::Auto*/)
+		: m_mode(mode)
+		, m_kernel(kernel)
+	{
+	}
+
+	bool ShuffleFilter::IsSupported(Kernel kernel)
+	{
+		switch (kernel) {
+		case Kernel::Auto:
+		case Kernel::Scalar:
+			return true;
+#ifdef HDF5PP_SHUFFLE_X86
+		case Kernel::SSE2:
+			return true;
+		case Kernel::AVX2: {
+			static const bool avx2 = CpuHasAVX2();
+			return avx2;
+		}
+#else
+		case Kernel::SSE2:
+		case Kernel::AVX2:
+			return false;
+#endif
+		}
+		return false;
+	}
+
+	ShuffleFilter::Kernel ShuffleFilter::GetBestKernel()
+	{
+		if (IsSupported(Kernel::AVX2)) {
+			return Kernel::AVX2;
+		}
+		return IsSupported(Kernel::SSE2) ? Kernel::SSE2 : Kernel::Scalar;
+	}
+
+	bool ShuffleFilter::ByteShuffle(const void* in, void* out, size_t count, size_t elem_size, Kernel kernel /*= Kernel::Auto*/)
+	{
+		if (elem_size == 0 || !Resolve(kernel)) {
+			return false;
+		}
+		ByteShuffleKernel((const uint8_t*)in, (uint8_t*)out, count, elem_size, kernel);
+		return true;
+	}
+
+	bool ShuffleFilter::ByteUnshuffle(const void* in, void* out, size_t count, size_t elem_size, Kernel kernel /*= Kernel::Auto*/)
+	{
+		if (elem_size == 0 || !Resolve(kernel)) {
+			return false;
+		}
+		ByteUnshuffleKernel((const uint8_t*)in, (uint8_t*)out, count, elem_size, kernel);
+		return true;
+	}
+
+	bool ShuffleFilter::BitShuffle(const void* in, void* out, size_t count, size_t elem_size, Kernel kernel /*= Kernel::Auto*/)
+	{
+		if (elem_size == 0 || count % 8 != 0 || !Resolve(kernel)) {
+			return false;
+		}
+		std::vector<uint8_t> tmp(count * elem_size);
+		BitShuffleKernel((const uint8_t*)in, (uint8_t*)out, count, elem_size, kernel, tmp.data());
+		return true;
+	}
+
+	bool ShuffleFilter::BitUnshuffle(const void* in, void* out, size_t count, size_t elem_size, Kernel kernel /*= Kernel::Auto*/)
+	{
+		if (elem_size == 0 || count % 8 != 0 || !Resolve(kernel)) {
+			return false;
+		}
+		std::vector<uint8_t> tmp(count * elem_size);
+		BitUnshuffleKernel((const uint8_t*)in, (uint8_t*)out, count, elem_size, kernel, tmp.data());
+		return true;
+	}
+
+	size_t ShuffleFilter::GetDefaultBlockSize(size_t elem_size)
+	{
+		// must not change: data is decoded with the block size it was encoded with
+		auto block = BitShuffleTargetBlockBytes / std::max<size_t>(elem_size, 1);
+		return std::max(block / 8 * 8, BitShuffleMinBlock);
+	}
+
+	H5Z_filter_t ShuffleFilter::GetID() const
+	{
+		return m_mode == Mode::Byte ? ByteShuffleID : BitShuffleID;
+	}
+
+	const char* ShuffleFilter::GetName() const
+	{
+		return m_mode == Mode::Byte ? "hdf5pp byte shuffle" : "bitshuffle; see https://github.com/kiyo-masui/bitshuffle";
+	}
+
+	bool ShuffleFilter::Encode(const unsigned int* cd_values, size_t cd_nelmts, const void* in, size_t size, Buffer& out) const
+	{
+		return Transform(true, cd_values, cd_nelmts, in, size, out);
+	}
+
+	bool ShuffleFilter::Decode(const unsigned int* cd_values, size_t cd_nelmts, const void* in, size_t size, Buffer& out) const
+	{
+		return Transform(false, cd_values, cd_nelmts, in, size, out);
+	}
+
+	bool ShuffleFilter::Transform(bool encode, const unsigned int* cd_values, size_t cd_nelmts, const void* in, size_t size, Buffer& out) const
+	{
+		auto kernel = m_kernel;
+		if (!Resolve(kernel) || !out.Resize(size)) {
+			return false;
+		}
+		auto src = (const uint8_t*)in;
+		auto dst = (uint8_t*)out.GetData();
+
+		if (m_mode == Mode::Byte) {
+			// as the library's filter: the bytes after the last whole element are copied
+			size_t elem_size = cd_nelmts > 0 ? cd_values[0] : 1;
+			auto count = elem_size > 1 ? size / elem_size : 0;
+			if (encode) {
+				ByteShuffleKernel(src, dst, count, elem_size, kernel);
+			}
+			else {
+				ByteUnshuffleKernel(src, dst, count, elem_size, kernel);
+			}
+			auto done = count * elem_size;
+			memcpy(dst + done, src + done, size - done);
+			return true;
+		}
+
+		// as the bitshuffle plugin: whole blocks, then the largest multiple of 8 elements left, then the last
+		// elements copied; its LZ4 and Zstandard modes (cd_values[4]) are not supported
+		if (cd_nelmts < 3 || cd_values[2] == 0 || (cd_nelmts > 4 && cd_values[4] != 0)) {
+			return false;
+		}
+		size_t elem_size = cd_values[2];
+		size_t block = cd_nelmts > 3 && cd_values[3] != 0 ? cd_values[3] : GetDefaultBlockSize(elem_size);
+		if (size % elem_size != 0 || block % 8 != 0) {
+			return false;
+		}
+		auto count = size / elem_size;
+		std::vector<uint8_t> tmp(std::min(block, count) * elem_size);
+		size_t i{ 0 };
+		while (i + 8 <= count) {
+			auto n = std::min(block, (count - i) / 8 * 8);
+			if (encode) {
+				BitShuffleKernel(src + i * elem_size, dst + i * elem_size, n, elem_size, kernel, tmp.data());
+			}
+			else {
+				BitUnshuffleKernel(src + i * elem_size, dst + i * elem_size, n, elem_size, kernel, tmp.data());
+			}
+			i += n;
+		}
+		memcpy(dst + i * elem_size, src + i * elem_size, (count - i) * elem_size);
+		return true;
+	}
+
+	bool ShuffleFilter::SetLocal(hid_t dcpl_id, hid_t type_id, hid_t /*space_id*/) const
+	{
+		auto elem_size = H5Tget_size(type_id);
+		unsigned int flags{ 0 };
+		std::vector<unsigned int> cd_values;
+		if (elem_size == 0 || !GetParameters(dcpl_id, GetID(), flags, cd_values)) {
+			return false;
+		}
+		if (m_mode == Mode::Byte) {
+			cd_values.assign(1, (unsigned int)elem_size);
+		}
+		else {
+			// block size (0: default) and compression set by the user are kept
+			cd_values.resize(std::max<size_t>(cd_values.size(), 5));
+			cd_values[0] = BitShuffleMajor;
+			cd_values[1] = BitShuffleMinor;
+			cd_values[2] = (unsigned int)elem_size;
+		}
+		return SetParameters(dcpl_id, GetID(), flags, cd_values);
+	}
+}
@@ -0,0 +1,69 @@
+// hdf5pp_shuffle.h
+// HDF5::ShuffleFilter transposes the bytes (Mode::Byte) or the bits (Mode::Bit) of the elements of a chunk, so that
+// the compression filter after it in the pipeline sees long runs of similar bytes
+// Mode::Byte writes the same format as the library's shuffle filter, but the library does not let its predefined
+// filters be replaced, so it registers under the testing identifier ByteShuffleID
+// (DatasetCreationPropertyList::SetByteShuffle)
+// Mode::Bit registers under the identifier of the bitshuffle plugin and writes its format without compression
+// (cd_values[4] 0), so put a compression filter after it (DatasetCreationPropertyList::SetBitShuffle)
+// the transpositions use SSE2 or AVX2 where the processor has them, scalar code otherwise; byte transposition has
+// no AVX2 kernel and uses SSE2 when asked for AVX2
+//
+#pragma once
+
+#include "hdf5pp_filter.h"
+
+namespace HDF5 {
+
+	class HDF5PP_API ShuffleFilter : public Filter
+	{
+	public:
+		enum class Mode {
+			Byte,		// byte j of every element together, for j = 0 to the element size
+			Bit			// bit k of byte j of every element together, blocks of elements at a time
+		};
+
+		enum class Kernel {
+			Auto,		// the best one the processor supports
+			Scalar,
+			SSE2,
+			AVX2
+		};
+
+		static const H5Z_filter_t ByteShuffleID = 256;
+		static const H5Z_filter_t BitShuffleID = 32008;
+
+		explicit ShuffleFilter(Mode mode = Mode::Bit, Kernel kernel = Kernel::Auto);
+
+		// Returns true if the processor supports kernel
+		static bool IsSupported(Kernel kernel);
+
+		// Returns the kernel Auto stands for
+		static Kernel GetBestKernel();
+
+		// Transposes count elements of elem_size bytes from in to out, which must not overlap: byte j of element i
+		// goes to out[j * count + i]; the bit transposition needs count to be a multiple of 8 and puts bit k of
+		// byte j of element i at bit i % 8 of out[(j * 8 + k) * count / 8 + i / 8]
+		static bool ByteShuffle(const void* in, void* out, size_t count, size_t elem_size, Kernel kernel = Kernel::Auto);
+		static bool ByteUnshuffle(const void* in, void* out, size_t count, size_t elem_size, Kernel kernel = Kernel::Auto);
+		static bool BitShuffle(const void* in, void* out, size_t count, size_t elem_size, Kernel kernel = Kernel::Auto);
+		static bool BitUnshuffle(const void* in, void* out, size_t count, size_t elem_size, Kernel kernel = Kernel::Auto);
+
+		// Returns the number of elements bit-transposed together when cd_values[3] is 0, as the bitshuffle plugin
+		static size_t GetDefaultBlockSize(size_t elem_size);
+
+		Mode GetMode() const { return m_mode; }
+
+		H5Z_filter_t GetID() const override;
+		const char* GetName() const override;
+		bool Encode(const unsigned int* cd_values, size_t cd_nelmts, const void* in, size_t size, Buffer& out) const override;
+		bool Decode(const unsigned int* cd_values, size_t cd_nelmts, const void* in, size_t size, Buffer& out) const override;
+		bool SetLocal(hid_t dcpl_id, hid_t type_id, hid_t space_id) const override;
+
+	protected:
+		bool Transform(bool encode, const unsigned int* cd_values, size_t cd_nelmts, const void* in, size_t size, Buffer& out) const;
+
+		Mode m_mode;
+		Kernel m_kernel;
+	};
+}
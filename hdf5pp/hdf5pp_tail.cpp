@@ -0,0 +1,247 @@
+#include "pch.h"
+#include "hdf5pp_tail.h"
+#include "hdf5pp_dspace.h"
+
+#include <algorithm>
+#ifdef __linux__
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace HDF5 {
+
+	TailReader::TailReader(const File& file, const Config& cfg /*= Config()*/)
+		: m_file(file), m_cfg(cfg)
+	{
+#ifdef __linux__
+		std::string filename;
+		if (m_cfg.notify && m_file.GetFileName(filename)) {
+			m_notify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+			if (m_notify >= 0 && (inotify_add_watch(m_notify, filename.c_str(), IN_MODIFY) < 0 || pipe2(m_wakePipe, O_NONBLOCK | O_CLOEXEC) < 0)) {
+				close(m_notify);
+				m_notify = -1;
+			}
+		}
+#endif
+	}
+
+	TailReader::~TailReader()
+	{
+		Stop();
+#ifdef __linux__
+		if (m_notify >= 0) {
+			close(m_notify);
+			close(m_wakePipe[0]);
+			close(m_wakePipe[1]);
+		}
+#endif
+	}
+
+	bool TailReader::Watch(const char* name, const Datatype& mem_dtype, RowsCallback cb, void* data, bool from_start /*= false*/)
+	{
+		auto dset = m_file.OpenDataset(name);
+		if (!dset.IsValid() || cb == nullptr) {
+			return false;
+		}
+		hsize_t rows{ 0 };
+		if (!from_start) {
+			auto dspace = dset.GetDataspace();
+			auto rank = dspace.GetSimpleExtentDimsCount();
+			if (rank <= 0) {
+				return false;
+			}
+			std::vector<hsize_t> dims((size_t)rank);
+			if (dspace.GetSimpleExtentDims(dims.data()) < 0) {
+				return false;
+			}
+			rows = dims[0];
+		}
+		std::lock_guard<std::mutex> guard(m_lock);
+		m_watched.emplace_back(new Watched{ name, dset, mem_dtype, cb, data, rows, true });
+		return true;
+	}
+
+	bool TailReader::Unwatch(const char* name)
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+		auto it = std::find_if(m_watched.begin(), m_watched.end(), [name](const std::shared_ptr<Watched>& w) { return w->name == name; });
+		if (it == m_watched.end()) {
+			return false;
+		}
+		// a poll in progress may still hold it
+		(*it)->watching = false;
+		m_watched.erase(it);
+		return true;
+	}
+
+	bool TailReader::Poll(hsize_t* rows /*= nullptr*/)
+	{
+		std::lock_guard<std::mutex> poll_guard(m_pollLock);
+		// polled without m_lock held, so that the callbacks can change the watches
+		std::vector<std::shared_ptr<Watched>> watched;
+		{
+			std::lock_guard<std::mutex> guard(m_lock);
+			watched = m_watched;
+		}
+		bool ok{ true };
+		hsize_t total{ 0 };
+		for (auto& w : watched) {
+			if (!IsWatching(*w)) {
+				continue;
+			}
+			hsize_t n{ 0 };
+			ok = PollOne(*w, n) && ok;
+			total += n;
+		}
+		if (rows != nullptr) {
+			*rows = total;
+		}
+		return ok;
+	}
+
+	bool TailReader::IsWatching(const Watched& w)
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+		return w.watching;
+	}
+
+	bool TailReader::PollOne(Watched& w, hsize_t& rows)
+	{
+		rows = 0;
+		// picks up the metadata the writer flushed since the last poll
+		if (!w.dset.Refresh()) {
+			return false;
+		}
+		auto file_dspace = w.dset.GetDataspace();
+		auto rank = file_dspace.GetSimpleExtentDimsCount();
+		if (rank <= 0) {
+			return false;
+		}
+		std::vector<hsize_t> dims((size_t)rank);
+		if (file_dspace.GetSimpleExtentDims(dims.data()) < 0) {
+			return false;
+		}
+		if (dims[0] < w.rows) {
+			w.rows = dims[0];
+		}
+		if (dims[0] == w.rows) {
+			return true;
+		}
+
+		size_t row_bytes = w.mem_dtype.GetSize();
+		for (int i = 1; i < rank; ++i) {
+			row_bytes *= (size_t)dims[i];
+		}
+		if (row_bytes == 0) {
+			w.rows = dims[0];
+			return true;
+		}
+		std::vector<hsize_t> start((size_t)rank, 0), count = dims;
+		while (w.rows < dims[0]) {
+			count[0] = std::min<hsize_t>(dims[0] - w.rows, std::max<size_t>(m_cfg.max_rows, 1));
+			start[0] = w.rows;
+			m_buffer.resize((size_t)count[0] * row_bytes);
+			Dataspace mem_dspace(count);
+			if (!file_dspace.SelectHyperslab(Dataspace::SelectionOperation::Set, start.data(), nullptr, count.data(), nullptr) ||
+				!w.dset.Read(w.mem_dtype, mem_dspace, file_dspace, m_buffer.data())) {
+				return false;
+			}
+			w.cb(w.name.c_str(), start[0], count[0], m_buffer.data(), w.data);
+			w.rows += count[0];
+			rows += count[0];
+			// the callback may have unwatched the dataset
+			if (!IsWatching(w)) {
+				break;
+			}
+		}
+		return true;
+	}
+
+	bool TailReader::WaitForChange(unsigned int timeout_ms)
+	{
+#ifdef __linux__
+		if (m_notify >= 0) {
+			pollfd fds[2] = { { m_notify, POLLIN, 0 }, { m_wakePipe[0], POLLIN, 0 } };
+			if (poll(fds, 2, (int)timeout_ms) <= 0 || (fds[0].revents & POLLIN) == 0) {
+				return false;
+			}
+			// one wake up covers all the writes so far
+			char events[4096];
+			while (read(m_notify, events, sizeof(events)) > 0) {
+			}
+			return true;
+		}
+#endif
+		std::unique_lock<std::mutex> lock(m_runLock);
+		m_wake.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this] { return m_stop; });
+		return false;
+	}
+
+	bool TailReader::Start()
+	{
+		hbool_t threadsafe{ false };
+		if (H5is_library_threadsafe(&threadsafe) < 0 || !threadsafe) {
+			return false;
+		}
+		std::lock_guard<std::mutex> guard(m_runLock);
+		if (m_thread.joinable()) {
+			return false;
+		}
+		m_stop = false;
+		m_thread = std::thread(&TailReader::Run, this);
+		return true;
+	}
+
+	void TailReader::Stop()
+	{
+		{
+			std::lock_guard<std::mutex> guard(m_runLock);
+			m_stop = true;
+		}
+		m_wake.notify_all();
+#ifdef __linux__
+		if (m_notify >= 0) {
+			char c{ 0 };
+			auto rv = write(m_wakePipe[1], &c, 1);
+			(void)rv;
+		}
+#endif
+		if (m_thread.joinable()) {
+			m_thread.join();
+		}
+#ifdef __linux__
+		if (m_notify >= 0) {
+			char c;
+			while (read(m_wakePipe[0], &c, 1) > 0) {
+			}
+		}
+#endif
+		// so that WaitForChange called after Stop waits again
+		std::lock_guard<std::mutex> guard(m_runLock);
+		m_stop = false;
+	}
+
+	void TailReader::Run()
+	{
+		double interval = m_cfg.min_interval_ms;
+		for (;;) {
+			{
+				std::lock_guard<std::mutex> guard(m_runLock);
+				if (m_stop) {
+					break;
+				}
+			}
+			hsize_t rows{ 0 };
+			Poll(&rows);
+			if (rows > 0) {
+				interval = m_cfg.min_interval_ms;
+			}
+			else {
+				interval = std::min(interval * std::max(m_cfg.backoff, 1.0), (double)std::max(m_cfg.max_interval_ms, m_cfg.min_interval_ms));
+			}
+			WaitForChange((unsigned int)interval);
+		}
+	}
+}
@@ -0,0 +1,102 @@
+// hdf5pp_tail.h
+// HDF5::TailReader follows datasets of a file open for SWMR reading (H5F_ACC_RDONLY | H5F_ACC_SWMR_READ) while a
+// writer appends to them along their first dimension, and hands only the rows appended since the last poll to
+// a callback, in pieces of at most max_rows rows
+// polls run on demand (Poll) or on a background thread (Start), which requires a thread-safe build of the HDF5
+// library: the wait between polls is min_interval_ms after a poll that found rows and grows by backoff up to
+// max_interval_ms while nothing changes; with notify (Linux only, inotify) a write to the file ends the wait early
+//
+#pragma once
+
+#include "hdf5pp_dset.h"
+#include "hdf5pp_dtype.h"
+#include "hdf5pp_file.h"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace HDF5 {
+
+	class HDF5PP_API TailReader
+	{
+	public:
+		struct Config {
+			Config() : min_interval_ms(10), max_interval_ms(1000), backoff(2.0), max_rows(65536), notify(true) {}
+
+			unsigned int min_interval_ms;	// wait after a poll that delivered rows
+			unsigned int max_interval_ms;	// longest wait while nothing changes
+			double backoff;					// factor the wait grows by after every poll without new rows
+			size_t max_rows;				// rows read and handed to the callback at a time
+			bool notify;					// wake up on writes to the file (inotify), where available
+		};
+
+		// called with rows [first_row, first_row + rows) of dataset name, laid out in buf as the watch's memory type;
+		// buf is only valid during the call; the callback may call Watch and Unwatch, but not Poll
+		typedef void (*RowsCallback)(const char* name, hsize_t first_row, hsize_t rows, const void* buf, void* data);
+
+		// keeps a handle to file for as long as it exists
+		TailReader(const File& file, const Config& cfg = Config());
+		TailReader(const TailReader&) = delete;
+		TailReader& operator=(const TailReader&) = delete;
+		virtual ~TailReader();
+
+		// Follows dataset name, read as mem_dtype; rows already there are delivered on the next poll if from_start,
+		// otherwise only rows appended after this call are
+		bool Watch(const char* name, const Datatype& mem_dtype, RowsCallback cb, void* data, bool from_start = false);
+
+		// Stops following dataset name
+		bool Unwatch(const char* name);
+
+		// Refreshes every watched dataset and delivers new rows on the calling thread; rows, if given, receives the
+		// number of rows delivered; a dataset that shrinks is followed from its new end
+		bool Poll(hsize_t* rows = nullptr);
+
+		// Waits up to timeout_ms for a write to the file; returns true if one was seen, false on timeout or when
+		// change notification is not available (the wait still lasts timeout_ms)
+		bool WaitForChange(unsigned int timeout_ms);
+
+		// Starts polling on a background thread; fails if the HDF5 library is not thread-safe or polling is running
+		bool Start();
+
+		// Stops the background thread
+		void Stop();
+
+		// Returns true if writes to the file are being watched (inotify)
+		bool IsNotifying() const { return m_notify >= 0; }
+
+	protected:
+		struct Watched {
+			std::string name;
+			Dataset dset;
+			Datatype mem_dtype;
+			RowsCallback cb;
+			void* data;
+			hsize_t rows;		// rows delivered so far
+			bool watching;		// false once unwatched, guarded by m_lock
+		};
+
+		bool IsWatching(const Watched& w);
+
+		bool PollOne(Watched& w, hsize_t& rows);
+		void Run();
+
+		File m_file;
+		Config m_cfg;
+		int m_notify{ -1 };					// inotify descriptor, or -1
+		int m_wakePipe[2]{ -1, -1 };		// ends a wait on m_notify when stopping
+
+		std::mutex m_pollLock;				// serializes polls, held while the callbacks run; guards m_buffer
+		std::mutex m_lock;					// guards the watches
+		std::vector<std::shared_ptr<Watched>> m_watched;
+		std::vector<char> m_buffer;
+
+		std::mutex m_runLock;				// guards m_stop, with m_wake
+		std::condition_variable m_wake;
+		bool m_stop{ false };
+		std::thread m_thread;
+	};
+}
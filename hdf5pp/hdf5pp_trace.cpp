@@ -0,0 +1,219 @@
+#include "pch.h"
+#include "hdf5pp_trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+
+namespace HDF5 {
+
+	namespace {
+
+		const size_t MaxPathLength = 63;
+
+		struct Event {
+			std::atomic<uint64_t> seq{ 0 };		// ring index + 1 of the stored event; 0 while it is being written
+			uint64_t ts_ns{ 0 };
+			uint64_t bytes{ 0 };
+			uint32_t tid{ 0 };
+			uint8_t op{ 0 };
+			char phase{ 0 };
+			char path[MaxPathLength + 1];
+		};
+
+		struct Buffer {
+			explicit Buffer(size_t capacity) : events(new Event[capacity]), mask(capacity - 1) {}
+
+			std::unique_ptr<Event[]> events;
+			size_t mask;
+			std::atomic<uint64_t> head{ 0 };
+		};
+
+		std::atomic<bool> g_active{ false };
+		std::atomic<Buffer*> g_buffer{ nullptr };
+		std::atomic<uint32_t> g_nextThreadId{ 0 };
+		std::mutex g_lock;	// serializes Start, Stop and ToJSON
+
+		// buffers replaced by Start are kept, since other threads may still be writing into them
+		std::vector<Buffer*>& RetiredBuffers()
+		{
+			static auto retired = new std::vector<Buffer*>;
+			return *retired;
+		}
+
+		std::chrono::steady_clock::time_point Origin()
+		{
+			static const auto origin = std::chrono::steady_clock::now();
+			return origin;
+		}
+
+		uint32_t ThreadId()
+		{
+			thread_local uint32_t tid = g_nextThreadId.fetch_add(1, std::memory_order_relaxed) + 1;
+			return tid;
+		}
+
+		void Write(char phase, Metrics::Operation op, const char* path, uint64_t bytes)
+		{
+			auto buffer = g_buffer.load(std::memory_order_acquire);
+			if (buffer == nullptr) {
+				return;
+			}
+			auto ts = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - Origin()).count();
+			auto index = buffer->head.fetch_add(1, std::memory_order_relaxed);
+			auto& e = buffer->events[index & buffer->mask];
+			e.seq.store(0, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			e.ts_ns = (uint64_t)ts;
+			e.bytes = bytes;
+			e.tid = ThreadId();
+			e.op = (uint8_t)op;
+			e.phase = phase;
+			size_t len{ 0 };
+			if (path != nullptr) {
+				for (; len < MaxPathLength && path[len] != 0; ++len) {
+					e.path[len] = path[len];
+				}
+			}
+			e.path[len] = 0;
+			e.seq.store(index + 1, std::memory_order_release);
+		}
+
+		void WriteString(std::ostream& os, const char* str)
+		{
+			os << '"';
+			for (auto p = str; *p != 0; ++p) {
+				auto c = (unsigned char)*p;
+				if (c == '"' || c == '\\') {
+					os << '\\' << (char)c;
+				}
+				else if (c < 0x20) {
+					char esc[8];
+					snprintf(esc, sizeof(esc), "\\u%04x", c);
+					os << esc;
+				}
+				else {
+					os << (char)c;
+				}
+			}
+			os << '"';
+		}
+	}
+
+	bool Trace::Start(size_t capacity /*= 1 << 16*/)
+	{
+		if (capacity == 0) {
+			return false;
+		}
+		size_t rounded{ 1 };
+		while (rounded < capacity) {
+			rounded <<= 1;
+		}
+		Origin();
+
+		std::lock_guard<std::mutex> guard(g_lock);
+		g_active.store(false, std::memory_order_relaxed);
+		// a new buffer even for the same size: resetting the current one would race with threads still writing to it
+		auto buffer = g_buffer.load(std::memory_order_relaxed);
+		if (buffer != nullptr) {
+			RetiredBuffers().push_back(buffer);
+		}
+		g_buffer.store(new Buffer(rounded), std::memory_order_release);
+		g_active.store(true, std::memory_order_release);
+		return true;
+	}
+
+	void Trace::Stop()
+	{
+		std::lock_guard<std::mutex> guard(g_lock);
+		g_active.store(false, std::memory_order_release);
+	}
+
+	bool Trace::IsActive()
+	{
+		return g_active.load(std::memory_order_relaxed);
+	}
+
+	bool Trace::IsEnabled()
+	{
+#ifdef HDF5PP_WITH_TRACE
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	void Trace::Begin(Metrics::Operation op, const char* path)
+	{
+		if (IsActive()) {
+			Write('B', op, path, 0);
+		}
+	}
+
+	void Trace::End(Metrics::Operation op, uint64_t bytes)
+	{
+		// not checked against IsActive, so that a span begun before Stop is still closed
+		Write('E', op, nullptr, bytes);
+	}
+
+	std::string Trace::ToJSON()
+	{
+		std::ostringstream os;
+		os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+		std::lock_guard<std::mutex> guard(g_lock);
+		auto buffer = g_buffer.load(std::memory_order_acquire);
+		if (buffer != nullptr) {
+			auto head = buffer->head.load(std::memory_order_acquire);
+			auto capacity = (uint64_t)buffer->mask + 1;
+			auto first = head > capacity ? head - capacity : 0;
+			bool comma{ false };
+			char ts[32];
+			for (auto index = first; index < head; ++index) {
+				auto& slot = buffer->events[index & buffer->mask];
+				if (slot.seq.load(std::memory_order_acquire) != index + 1) {
+					continue; // being written or already overwritten
+				}
+				auto ts_ns = slot.ts_ns;
+				auto bytes = slot.bytes;
+				auto tid = slot.tid;
+				auto op = (Metrics::Operation)slot.op;
+				auto phase = slot.phase;
+				char path[MaxPathLength + 1];
+				memcpy(path, slot.path, sizeof(path));
+				path[MaxPathLength] = 0;
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (slot.seq.load(std::memory_order_relaxed) != index + 1) {
+					continue; // overwritten while copying
+				}
+
+				snprintf(ts, sizeof(ts), "%.3f", ts_ns / 1000.0);
+				os << (comma ? ",\n" : "\n") << "{\"name\":\"" << Metrics::GetName(op) << "\",\"cat\":\"hdf5\",\"ph\":\"" << phase
+					<< "\",\"ts\":" << ts << ",\"pid\":1,\"tid\":" << tid << ",\"args\":{";
+				if (phase == 'B') {
+					os << "\"path\":";
+					WriteString(os, path);
+				}
+				else {
+					os << "\"bytes\":" << bytes;
+				}
+				os << "}}";
+				comma = true;
+			}
+		}
+		os << "\n]}\n";
+		return os.str();
+	}
+
+	bool Trace::Dump(const char* filename)
+	{
+		std::ofstream os(filename, std::ios::trunc);
+		os << ToJSON();
+		return os.good();
+	}
+
+}
@@ -0,0 +1,44 @@
+// hdf5pp_trace.h
+// HDF5::Trace records begin/end events of the wrapped HDF5 operations (operation, object path, bytes, thread)
+// into a fixed size lock-free ring buffer, and dumps them in Chrome trace / Perfetto JSON format
+// (open in chrome://tracing or ui.perfetto.dev) to see which calls overlap or serialize across threads
+// the probes are compiled in only when the library is built with HDF5PP_WITH_TRACE defined; when compiled
+// in but not started, a probe costs one atomic load
+// once the buffer is full the oldest events are overwritten
+//
+#pragma once
+
+#include "hdf5pp_api.h"
+#include "hdf5pp_metrics.h"
+
+namespace HDF5 {
+
+	class HDF5PP_API Trace
+	{
+	public:
+		// Starts recording into a new ring buffer of capacity events (rounded up to a power of 2)
+		// any previously recorded events are discarded; the previous buffer stays allocated until the process exits
+		static bool Start(size_t capacity = 1 << 16);
+
+		// Stops recording; recorded events are kept until the next Start
+		static void Stop();
+
+		// Returns true if events are being recorded
+		static bool IsActive();
+
+		// Returns true if the library was built with HDF5PP_WITH_TRACE
+		static bool IsEnabled();
+
+		// Records a begin / end event for the calling thread; used by the probes, but can also be
+		// called to mark user defined spans (begin and end must be nested per thread)
+		// Begin records only while active; End records whenever a buffer exists
+		static void Begin(Metrics::Operation op, const char* path);
+		static void End(Metrics::Operation op, uint64_t bytes);
+
+		// Formats the recorded events as Chrome trace JSON
+		static std::string ToJSON();
+
+		// Writes the recorded events as Chrome trace JSON to a file (replacing it)
+		static bool Dump(const char* filename);
+	};
+}
@@ -0,0 +1,290 @@
+#include "pch.h"
+#include "hdf5pp_vfd.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <string>
+
+#if H5_VERSION_GE(1, 13, 2)
+#include <H5FDdevelop.h>
+#endif
+
+namespace HDF5 {
+
+	namespace {
+
+		// the per file structure handed to the library; H5FD_t must come first, the library fills it in
+		struct DriverFile {
+			H5FD_t pub;
+			VirtualFileDriver* driver;
+			VirtualFileDriverFactory* factory;	// the settings the file was opened with
+		};
+
+		VirtualFileDriver* DriverOf(const H5FD_t* file)
+		{
+			return ((const DriverFile*)file)->driver;
+		}
+
+		// runs a driver method; exceptions must not unwind through the library
+		template <typename F>
+		herr_t Call(F f)
+		{
+			try {
+				return f() ? 0 : -1;
+			}
+			catch (...) {
+				return -1;
+			}
+		}
+
+		template <typename F>
+		haddr_t CallAddress(F f)
+		{
+			try {
+				return f();
+			}
+			catch (...) {
+				return HADDR_UNDEF;
+			}
+		}
+
+		void* FaplGet(H5FD_t* file)
+		{
+			try {
+				return ((DriverFile*)file)->factory->Clone();
+			}
+			catch (...) {
+				return nullptr;
+			}
+		}
+
+		void* FaplCopy(const void* fapl)
+		{
+			try {
+				return ((const VirtualFileDriverFactory*)fapl)->Clone();
+			}
+			catch (...) {
+				return nullptr;
+			}
+		}
+
+		herr_t FaplFree(void* fapl)
+		{
+			delete (VirtualFileDriverFactory*)fapl;
+			return 0;
+		}
+
+		H5FD_t* Open(const char* name, unsigned flags, hid_t fapl, haddr_t maxaddr)
+		{
+			auto factory = (const VirtualFileDriverFactory*)H5Pget_driver_info(fapl);
+			if (factory == nullptr) {
+				return nullptr;
+			}
+			DriverFile* file{ nullptr };
+			try {
+				file = new DriverFile{};
+				file->factory = factory->Clone();
+				file->driver = factory->Open(name, flags, maxaddr);
+			}
+			catch (...) {
+			}
+			if (file != nullptr && (file->driver == nullptr || file->factory == nullptr)) {
+				delete file->driver;
+				delete file->factory;
+				delete file;
+				file = nullptr;
+			}
+			return file != nullptr ? &file->pub : nullptr;
+		}
+
+		herr_t Close(H5FD_t* file)
+		{
+			auto df = (DriverFile*)file;
+			auto rv = Call([df]() { return df->driver->Close(); });
+			delete df->driver;
+			delete df->factory;
+			delete df;
+			return rv;
+		}
+
+		int Compare(const H5FD_t* f1, const H5FD_t* f2)
+		{
+			try {
+				return DriverOf(f1)->Compare(*DriverOf(f2));
+			}
+			catch (...) {
+				return f1 < f2 ? -1 : (f1 > f2 ? 1 : 0);
+			}
+		}
+
+		// the library also queries the driver without a file, before opening one (e.g. to check for SWMR
+		// support); those queries get no features
+		herr_t Query(const H5FD_t* file, unsigned long* flags)
+		{
+			*flags = 0;
+			return file == nullptr ? 0 : Call([file, flags]() { *flags = DriverOf(file)->GetFeatureFlags(); return true; });
+		}
+
+		haddr_t GetEOA(const H5FD_t* file, H5FD_mem_t type)
+		{
+			return CallAddress([file, type]() { return DriverOf(file)->GetEOA(type); });
+		}
+
+		herr_t SetEOA(H5FD_t* file, H5FD_mem_t type, haddr_t addr)
+		{
+			return Call([file, type, addr]() { return DriverOf(file)->SetEOA(type, addr); });
+		}
+
+		haddr_t GetEOF(const H5FD_t* file, H5FD_mem_t type)
+		{
+			return CallAddress([file, type]() { return DriverOf(file)->GetEOF(type); });
+		}
+
+		herr_t GetHandle(H5FD_t* file, hid_t /*fapl*/, void** file_handle)
+		{
+			return Call([file, file_handle]() { *file_handle = DriverOf(file)->GetHandle(); return *file_handle != nullptr; });
+		}
+
+		herr_t Read(H5FD_t* file, H5FD_mem_t type, hid_t /*dxpl*/, haddr_t addr, size_t size, void* buf)
+		{
+			return Call([=]() { return DriverOf(file)->Read(type, addr, size, buf); });
+		}
+
+		herr_t Write(H5FD_t* file, H5FD_mem_t type, hid_t /*dxpl*/, haddr_t addr, size_t size, const void* buf)
+		{
+			return Call([=]() { return DriverOf(file)->Write(type, addr, size, buf); });
+		}
+
+		herr_t Flush(H5FD_t* file, hid_t /*dxpl*/, hbool_t closing)
+		{
+			return Call([file, closing]() { return DriverOf(file)->Flush(closing != 0); });
+		}
+
+		herr_t Truncate(H5FD_t* file, hid_t /*dxpl*/, hbool_t closing)
+		{
+			return Call([file, closing]() { return DriverOf(file)->Truncate(closing != 0); });
+		}
+
+		herr_t Lock(H5FD_t* file, hbool_t rw)
+		{
+			return Call([file, rw]() { return DriverOf(file)->Lock(rw != 0); });
+		}
+
+		herr_t Unlock(H5FD_t* file)
+		{
+			return Call([file]() { return DriverOf(file)->Unlock(); });
+		}
+
+		// registered drivers by name; the names are referenced by the registered classes
+		struct Driver {
+			hid_t id;
+			int value;		// driver value, in the range left for testing (256-511), kept for the name
+		};
+
+		std::mutex g_driversMutex;
+		std::map<std::string, Driver> g_drivers;
+	}
+
+	haddr_t VirtualFileDriver::GetEOA(H5FD_mem_t /*type*/) const
+	{
+		return m_eoa;
+	}
+
+	bool VirtualFileDriver::SetEOA(H5FD_mem_t /*type*/, haddr_t addr)
+	{
+		m_eoa = addr;
+		return true;
+	}
+
+	bool VirtualFileDriver::Truncate(bool /*closing*/)
+	{
+		return true;
+	}
+
+	bool VirtualFileDriver::Flush(bool /*closing*/)
+	{
+		return true;
+	}
+
+	bool VirtualFileDriver::Lock(bool /*rw*/)
+	{
+		return true;
+	}
+
+	bool VirtualFileDriver::Unlock()
+	{
+		return true;
+	}
+
+	bool VirtualFileDriver::Close()
+	{
+		return true;
+	}
+
+	int VirtualFileDriver::Compare(const VirtualFileDriver& rhs) const
+	{
+		return this < &rhs ? -1 : (this > &rhs ? 1 : 0);
+	}
+
+	unsigned long VirtualFileDriver::GetFeatureFlags() const
+	{
+		return H5FD_FEAT_AGGREGATE_METADATA | H5FD_FEAT_ACCUMULATE_METADATA | H5FD_FEAT_DATA_SIEVE | H5FD_FEAT_AGGREGATE_SMALLDATA;
+	}
+
+	void* VirtualFileDriver::GetHandle()
+	{
+		return nullptr;
+	}
+
+	hid_t VirtualFileDriverFactory::GetDriverID() const
+	{
+		std::lock_guard<std::mutex> lock(g_driversMutex);
+		auto it = g_drivers.find(GetName());
+		if (it == g_drivers.end()) {
+			it = g_drivers.emplace(GetName(), Driver{ H5I_INVALID_HID, 256 + (int)g_drivers.size() }).first;
+		}
+		// registered drivers go away when the library is closed
+		else if (H5Iis_valid(it->second.id) > 0) {
+			return it->second.id;
+		}
+		if (it->second.value > 511) {
+			return H5I_INVALID_HID;
+		}
+
+		H5FD_class_t cls{};
+#ifdef H5FD_CLASS_VERSION
+		cls.version = H5FD_CLASS_VERSION;
+		cls.value = (H5FD_class_value_t)it->second.value;
+#endif
+		cls.name = it->first.c_str();
+		cls.maxaddr = (haddr_t)INT64_MAX;
+		cls.fc_degree = H5F_CLOSE_WEAK;
+		cls.fapl_get = FaplGet;
+		cls.fapl_copy = FaplCopy;
+		cls.fapl_free = FaplFree;
+		cls.open = HDF5::Open;
+		cls.close = HDF5::Close;
+		cls.cmp = HDF5::Compare;
+		cls.query = Query;
+		cls.get_eoa = HDF5::GetEOA;
+		cls.set_eoa = HDF5::SetEOA;
+		cls.get_eof = HDF5::GetEOF;
+		cls.get_handle = HDF5::GetHandle;
+		cls.read = HDF5::Read;
+		cls.write = HDF5::Write;
+		cls.flush = HDF5::Flush;
+		cls.truncate = HDF5::Truncate;
+		cls.lock = HDF5::Lock;
+		cls.unlock = HDF5::Unlock;
+		// metadata and raw data kept apart (H5FD_FLMAP_DICHOTOMY), as by the default driver
+		H5FD_mem_t map[H5FD_MEM_NTYPES] = H5FD_FLMAP_DICHOTOMY;
+		std::copy(map, map + H5FD_MEM_NTYPES, cls.fl_map);
+
+		it->second.id = H5FDregister(&cls);
+		return it->second.id;
+	}
+
+}
@@ -0,0 +1,89 @@
+// hdf5pp_vfd.h
+// HDF5::VirtualFileDriver is the base class of virtual file drivers written in C++: every byte level operation
+// on a file opened through the driver goes to one VirtualFileDriver object, which the library adapts to an
+// H5FD_class_t registered under the driver's name
+// HDF5::VirtualFileDriverFactory holds the settings of a driver and creates the VirtualFileDriver of every file
+// opened with it; FileAccessPropertyList::SetDriver stores a copy of the factory in the property list
+// drivers are called by the library one at a time; they must not throw (exceptions are caught and reported as
+// failures) and files they write must be readable by the default driver
+//
+#pragma once
+
+#include "hdf5pp_api.h"
+
+namespace HDF5 {
+
+	class HDF5PP_API VirtualFileDriver
+	{
+	public:
+		VirtualFileDriver() = default;
+		VirtualFileDriver(const VirtualFileDriver&) = delete;
+		VirtualFileDriver& operator=(const VirtualFileDriver&) = delete;
+		virtual ~VirtualFileDriver() = default;
+
+		// Reads size bytes at addr; bytes past the end of file read as zeros
+		virtual bool Read(H5FD_mem_t type, haddr_t addr, size_t size, void* buf) = 0;
+
+		// Writes size bytes at addr, extending the file if needed
+		virtual bool Write(H5FD_mem_t type, haddr_t addr, size_t size, const void* buf) = 0;
+
+		// Returns the end of file, the size of the underlying storage; HADDR_UNDEF on failure
+		virtual haddr_t GetEOF(H5FD_mem_t type) const = 0;
+
+		// Gets/Sets the end of allocation, the end of the address space the library has allocated
+		// the defaults keep it in m_eoa
+		virtual haddr_t GetEOA(H5FD_mem_t type) const;
+		virtual bool SetEOA(H5FD_mem_t type, haddr_t addr);
+
+		// Makes the end of file match the end of allocation; called when the file is flushed and closed
+		// the default does nothing
+		virtual bool Truncate(bool closing);
+
+		// Writes data held by the driver to storage; the default does nothing
+		virtual bool Flush(bool closing);
+
+		// Takes a lock on the file, exclusive if rw is set, shared otherwise, without waiting / releases it
+		// the defaults do nothing
+		virtual bool Lock(bool rw);
+		virtual bool Unlock();
+
+		// Closes the file; the object is deleted afterwards, whether it succeeds or not
+		virtual bool Close();
+
+		// Orders two files of the same driver: negative, 0 or positive; the library treats files comparing
+		// equal as the same file; the default compares the objects, so no two opens are the same file
+		virtual int Compare(const VirtualFileDriver& rhs) const;
+
+		// Returns the H5FD_FEAT_* flags telling the library which optimizations it may use with the driver
+		// the default allows metadata aggregation and accumulation, small data aggregation and data sieving
+		virtual unsigned long GetFeatureFlags() const;
+
+		// Returns the low level handle of the file (see File::GetVFDHandle), nullptr if there is none
+		virtual void* GetHandle();
+
+	protected:
+		haddr_t m_eoa{ 0 };
+	};
+
+	class HDF5PP_API VirtualFileDriverFactory
+	{
+	public:
+		virtual ~VirtualFileDriverFactory() = default;
+
+		// Returns the name the driver is registered under; one name per driver type
+		virtual const char* GetName() const = 0;
+
+		// Returns a new copy of this factory, with the same settings; property lists hold their own copies, so
+		// state such as statistics is shared by the copies and the files opened through them
+		virtual VirtualFileDriverFactory* Clone() const = 0;
+
+		// Opens name with the H5F_ACC_* flags (creating or truncating it if they say so); maxaddr is the largest
+		// address the library will use; returns nullptr on failure
+		virtual VirtualFileDriver* Open(const char* name, unsigned int flags, haddr_t maxaddr) const = 0;
+
+		// Returns the identifier of the driver (see FileAccessPropertyList::GetDriver), registering it with the
+		// library on first use; H5I_INVALID_HID on failure
+		hid_t GetDriverID() const;
+	};
+
+}
@@ -0,0 +1,455 @@
+#include "pch.h"
+#include "hdf5pp_vfd_cache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace HDF5 {
+
+	struct BlockCacheDriverFactory::Counters {
+		std::atomic<uint64_t> hits{ 0 };
+		std::atomic<uint64_t> misses{ 0 };
+		std::atomic<uint64_t> read_ahead{ 0 };
+		std::atomic<uint64_t> read_ahead_hits{ 0 };
+		std::atomic<uint64_t> bypassed{ 0 };
+		std::atomic<uint64_t> file_reads{ 0 };
+		std::atomic<uint64_t> file_bytes{ 0 };
+	};
+
+	namespace {
+
+		const uint64_t NoBlock = UINT64_MAX;
+
+		// copies the part of [start, start + len) that overlaps [addr, addr + size) from data to buf, which holds
+		// [addr, addr + size)
+		void CopyOverlap(haddr_t addr, size_t size, char* buf, haddr_t start, const char* data, size_t len)
+		{
+			auto from = std::max(addr, start);
+			auto to = std::min(addr + size, start + len);
+			if (from < to) {
+				memcpy(buf + (from - addr), data + (from - start), (size_t)(to - from));
+			}
+		}
+
+		class BlockCacheDriver : public VirtualFileDriver
+		{
+		public:
+			BlockCacheDriver(VirtualFileDriver* file, const BlockCacheDriverFactory::Config& cfg, const std::shared_ptr<BlockCacheDriverFactory::Counters>& counters);
+			~BlockCacheDriver() override;
+
+			bool Read(H5FD_mem_t type, haddr_t addr, size_t size, void* buf) override;
+			bool Write(H5FD_mem_t type, haddr_t addr, size_t size, const void* buf) override;
+			haddr_t GetEOF(H5FD_mem_t type) const override;
+			haddr_t GetEOA(H5FD_mem_t type) const override;
+			bool SetEOA(H5FD_mem_t type, haddr_t addr) override;
+			bool Truncate(bool closing) override;
+			bool Flush(bool closing) override;
+			bool Lock(bool rw) override;
+			bool Unlock() override;
+			bool Close() override;
+			int Compare(const VirtualFileDriver& rhs) const override;
+			unsigned long GetFeatureFlags() const override;
+			void* GetHandle() override;
+
+		protected:
+			struct Block {
+				std::vector<char> data;
+				bool read_ahead;	// read ahead and not used yet
+			};
+			typedef std::list<std::pair<uint64_t, Block>> BlockList;
+
+			// copies the part of a cached block overlapping [addr, addr + size) to buf, marking it most recently
+			// used; returns false if the block is not cached; requires m_cacheMutex
+			bool CopyFromCache(uint64_t index, haddr_t addr, size_t size, char* buf);
+
+			// adds a block as the most recently used, evicting the least recently used; requires m_cacheMutex
+			void Insert(uint64_t index, const char* data, bool read_ahead);
+
+			// reads count blocks from index on; requires m_ioMutex
+			bool ReadBlocks(H5FD_mem_t type, uint64_t index, uint64_t count, std::vector<char>& data);
+
+			// number of blocks holding the file; requires m_ioMutex
+			uint64_t GetBlockCount(H5FD_mem_t type) const;
+
+			void RunReadAhead();
+			void StopReadAhead();
+
+			std::unique_ptr<VirtualFileDriver> m_file;
+			BlockCacheDriverFactory::Config m_cfg;
+			std::shared_ptr<BlockCacheDriverFactory::Counters> m_counters;
+			size_t m_maxBlocks;
+
+			mutable std::mutex m_ioMutex;		// serializes the calls to m_file; taken before m_cacheMutex
+			std::mutex m_cacheMutex;			// guards everything below
+			BlockList m_blocks;					// most recently used first
+			std::unordered_map<uint64_t, BlockList::iterator> m_index;
+
+			uint64_t m_lastBlock{ NoBlock };	// last block of the previous read
+			unsigned int m_streak{ 0 };			// reads in a row that continued the previous one
+			uint64_t m_aheadNext{ 0 };			// blocks [m_aheadNext, m_aheadEnd) are to be read ahead
+			uint64_t m_aheadEnd{ 0 };
+			bool m_stop{ false };
+			std::condition_variable m_wake;
+			std::thread m_thread;
+		};
+
+		BlockCacheDriver::BlockCacheDriver(VirtualFileDriver* file, const BlockCacheDriverFactory::Config& cfg, const std::shared_ptr<BlockCacheDriverFactory::Counters>& counters)
+			: m_file(file), m_cfg(cfg), m_counters(counters), m_maxBlocks(std::max(cfg.cache_size / cfg.block_size, (size_t)1))
+		{
+		}
+
+		BlockCacheDriver::~BlockCacheDriver()
+		{
+			StopReadAhead();
+		}
+
+		bool BlockCacheDriver::CopyFromCache(uint64_t index, haddr_t addr, size_t size, char* buf)
+		{
+			auto it = m_index.find(index);
+			if (it == m_index.end()) {
+				return false;
+			}
+			m_blocks.splice(m_blocks.begin(), m_blocks, it->second);
+			auto& block = it->second->second;
+			if (block.read_ahead) {
+				block.read_ahead = false;
+				++m_counters->read_ahead_hits;
+			}
+			++m_counters->hits;
+			CopyOverlap(addr, size, buf, index * m_cfg.block_size, block.data.data(), block.data.size());
+			return true;
+		}
+
+		void BlockCacheDriver::Insert(uint64_t index, const char* data, bool read_ahead)
+		{
+			if (m_index.size() >= m_maxBlocks) {
+				m_index.erase(m_blocks.back().first);
+				m_blocks.pop_back();
+			}
+			m_blocks.emplace_front(index, Block{ std::vector<char>(data, data + m_cfg.block_size), read_ahead });
+			m_index[index] = m_blocks.begin();
+		}
+
+		bool BlockCacheDriver::ReadBlocks(H5FD_mem_t type, uint64_t index, uint64_t count, std::vector<char>& data)
+		{
+			data.resize((size_t)(count * m_cfg.block_size));
+			++m_counters->file_reads;
+			m_counters->file_bytes += data.size();
+			return m_file->Read(type, index * m_cfg.block_size, data.size(), data.data());
+		}
+
+		uint64_t BlockCacheDriver::GetBlockCount(H5FD_mem_t type) const
+		{
+			auto eof = m_file->GetEOF(type);
+			return eof == HADDR_UNDEF ? 0 : (eof + m_cfg.block_size - 1) / m_cfg.block_size;
+		}
+
+		bool BlockCacheDriver::Read(H5FD_mem_t type, haddr_t addr, size_t size, void* buf)
+		{
+			if (size == 0) {
+				return true;
+			}
+			if (size >= m_cfg.bypass_size) {
+				std::lock_guard<std::mutex> io(m_ioMutex);
+				++m_counters->bypassed;
+				++m_counters->file_reads;
+				m_counters->file_bytes += size;
+				return m_file->Read(type, addr, size, buf);
+			}
+
+			auto out = (char*)buf;
+			const uint64_t bs = m_cfg.block_size;
+			const uint64_t first = addr / bs;
+			const uint64_t last = (addr + size - 1) / bs;
+			bool sequential;
+			{
+				// a read starting in or right after the block where the previous one ended continues a stream
+				std::lock_guard<std::mutex> lock(m_cacheMutex);
+				m_streak = (m_lastBlock != NoBlock && (first == m_lastBlock || first == m_lastBlock + 1)) ? m_streak + 1 : 0;
+				m_lastBlock = last;
+				sequential = m_cfg.read_ahead > 0 && m_streak >= 2;
+			}
+
+			for (uint64_t index = first; index <= last; ) {
+				{
+					std::lock_guard<std::mutex> lock(m_cacheMutex);
+					if (CopyFromCache(index, addr, size, out)) {
+						++index;
+						continue;
+					}
+				}
+
+				// reads the run of missing blocks with one call, and when not reading ahead in the background,
+				// the blocks following the read of a stream too
+				std::lock_guard<std::mutex> io(m_ioMutex);
+				uint64_t count{ 1 };
+				{
+					std::lock_guard<std::mutex> lock(m_cacheMutex);
+					// read ahead meanwhile
+					if (CopyFromCache(index, addr, size, out)) {
+						++index;
+						continue;
+					}
+					while (index + count <= last && m_index.count(index + count) == 0) {
+						++count;
+					}
+				}
+				uint64_t ahead{ 0 };
+				if (sequential && !m_cfg.async && index + count > last) {
+					auto blocks = GetBlockCount(type);
+					ahead = blocks > last + 1 ? std::min((uint64_t)m_cfg.read_ahead, blocks - last - 1) : 0;
+				}
+				std::vector<char> data;
+				if (!ReadBlocks(type, index, count + ahead, data)) {
+					return false;
+				}
+				m_counters->misses += count;
+				CopyOverlap(addr, size, out, index * bs, data.data(), (size_t)(count * bs));
+
+				std::lock_guard<std::mutex> lock(m_cacheMutex);
+				for (uint64_t i = 0; i < count + ahead; ++i) {
+					if (i < count || m_index.count(index + i) == 0) {
+						Insert(index + i, data.data() + i * bs, i >= count);
+						if (i >= count) {
+							++m_counters->read_ahead;
+						}
+					}
+				}
+				index += count;
+			}
+
+			if (sequential && m_cfg.async) {
+				// moves the read-ahead window once half of it has been read, or when the stream jumped back
+				std::lock_guard<std::mutex> lock(m_cacheMutex);
+				auto end = last + 1 + m_cfg.read_ahead;
+				if (m_aheadEnd < last + 1 + m_cfg.read_ahead / 2 || m_aheadEnd > end) {
+					if (m_aheadNext < last + 1 || m_aheadNext > end) {
+						m_aheadNext = last + 1;
+					}
+					m_aheadEnd = end;
+					if (!m_thread.joinable()) {
+						m_thread = std::thread(&BlockCacheDriver::RunReadAhead, this);
+					}
+					m_wake.notify_one();
+				}
+			}
+			return true;
+		}
+
+		void BlockCacheDriver::RunReadAhead()
+		{
+			const uint64_t bs = m_cfg.block_size;
+			for (;;) {
+				uint64_t index, count;
+				{
+					std::unique_lock<std::mutex> lock(m_cacheMutex);
+					m_wake.wait(lock, [this]() { return m_stop || m_aheadNext < m_aheadEnd; });
+					if (m_stop) {
+						return;
+					}
+					index = m_aheadNext;
+					count = m_aheadEnd - m_aheadNext;
+					m_aheadNext = m_aheadEnd;
+				}
+
+				std::lock_guard<std::mutex> io(m_ioMutex);
+				{
+					std::lock_guard<std::mutex> lock(m_cacheMutex);
+					while (count > 0 && m_index.count(index) != 0) {
+						++index;
+						--count;
+					}
+				}
+				auto blocks = GetBlockCount(H5FD_MEM_DEFAULT);
+				count = index < blocks ? std::min(count, blocks - index) : 0;
+				std::vector<char> data;
+				if (count == 0 || !ReadBlocks(H5FD_MEM_DEFAULT, index, count, data)) {
+					continue;
+				}
+				std::lock_guard<std::mutex> lock(m_cacheMutex);
+				for (uint64_t i = 0; i < count; ++i) {
+					if (m_index.count(index + i) == 0) {
+						Insert(index + i, data.data() + i * bs, true);
+						++m_counters->read_ahead;
+					}
+				}
+			}
+		}
+
+		void BlockCacheDriver::StopReadAhead()
+		{
+			if (!m_thread.joinable()) {
+				return;
+			}
+			{
+				std::lock_guard<std::mutex> lock(m_cacheMutex);
+				m_stop = true;
+			}
+			m_wake.notify_one();
+			m_thread.join();
+		}
+
+		bool BlockCacheDriver::Write(H5FD_mem_t type, haddr_t addr, size_t size, const void* buf)
+		{
+			if (size == 0) {
+				return true;
+			}
+			std::lock_guard<std::mutex> io(m_ioMutex);
+			auto ok = m_file->Write(type, addr, size, buf);
+
+			// cached blocks take the new bytes; after a failed write the file content is unknown, so they go
+			std::lock_guard<std::mutex> lock(m_cacheMutex);
+			const uint64_t bs = m_cfg.block_size;
+			for (uint64_t index = addr / bs; index <= (addr + size - 1) / bs; ++index) {
+				auto it = m_index.find(index);
+				if (it == m_index.end()) {
+					continue;
+				}
+				if (ok) {
+					CopyOverlap(index * bs, (size_t)bs, it->second->second.data.data(), addr, (const char*)buf, size);
+				}
+				else {
+					m_blocks.erase(it->second);
+					m_index.erase(it);
+				}
+			}
+			return ok;
+		}
+
+		haddr_t BlockCacheDriver::GetEOF(H5FD_mem_t type) const
+		{
+			std::lock_guard<std::mutex> io(m_ioMutex);
+			return m_file->GetEOF(type);
+		}
+
+		haddr_t BlockCacheDriver::GetEOA(H5FD_mem_t type) const
+		{
+			std::lock_guard<std::mutex> io(m_ioMutex);
+			return m_file->GetEOA(type);
+		}
+
+		bool BlockCacheDriver::SetEOA(H5FD_mem_t type, haddr_t addr)
+		{
+			std::lock_guard<std::mutex> io(m_ioMutex);
+			return m_file->SetEOA(type, addr);
+		}
+
+		bool BlockCacheDriver::Truncate(bool closing)
+		{
+			std::lock_guard<std::mutex> io(m_ioMutex);
+			if (!m_file->Truncate(closing)) {
+				return false;
+			}
+
+			// blocks past the new end of file go, the bytes past it in the last block read as zeros
+			auto eof = m_file->GetEOF(H5FD_MEM_DEFAULT);
+			std::lock_guard<std::mutex> lock(m_cacheMutex);
+			const uint64_t bs = m_cfg.block_size;
+			for (auto it = m_blocks.begin(); it != m_blocks.end(); ) {
+				auto start = it->first * bs;
+				if (eof != HADDR_UNDEF && start >= eof) {
+					m_index.erase(it->first);
+					it = m_blocks.erase(it);
+					continue;
+				}
+				if (eof != HADDR_UNDEF && start + bs > eof) {
+					memset(it->second.data.data() + (eof - start), 0, (size_t)(start + bs - eof));
+				}
+				++it;
+			}
+			return true;
+		}
+
+		bool BlockCacheDriver::Flush(bool closing)
+		{
+			std::lock_guard<std::mutex> io(m_ioMutex);
+			return m_file->Flush(closing);
+		}
+
+		bool BlockCacheDriver::Lock(bool rw)
+		{
+			std::lock_guard<std::mutex> io(m_ioMutex);
+			return m_file->Lock(rw);
+		}
+
+		bool BlockCacheDriver::Unlock()
+		{
+			std::lock_guard<std::mutex> io(m_ioMutex);
+			return m_file->Unlock();
+		}
+
+		bool BlockCacheDriver::Close()
+		{
+			StopReadAhead();
+			return m_file->Close();
+		}
+
+		int BlockCacheDriver::Compare(const VirtualFileDriver& rhs) const
+		{
+			return m_file->Compare(*((const BlockCacheDriver&)rhs).m_file);
+		}
+
+		unsigned long BlockCacheDriver::GetFeatureFlags() const
+		{
+			return m_file->GetFeatureFlags();
+		}
+
+		void* BlockCacheDriver::GetHandle()
+		{
+			return m_file->GetHandle();
+		}
+	}
+
+	BlockCacheDriverFactory::BlockCacheDriverFactory(const Config& cfg /*= Config()*/, const VirtualFileDriverFactory& file /*= Sec2DriverFactory()*/)
+		: m_cfg(cfg), m_file(file.Clone()), m_counters(std::make_shared<Counters>())
+	{
+	}
+
+	BlockCacheDriverFactory::BlockCacheDriverFactory(const BlockCacheDriverFactory& rhs)
+		: VirtualFileDriverFactory(rhs), m_cfg(rhs.m_cfg), m_file(rhs.m_file->Clone()), m_counters(rhs.m_counters)
+	{
+	}
+
+	VirtualFileDriver* BlockCacheDriverFactory::Open(const char* name, unsigned int flags, haddr_t maxaddr) const
+	{
+		if (m_cfg.block_size == 0) {
+			return nullptr;
+		}
+		std::unique_ptr<VirtualFileDriver> file(m_file->Open(name, flags, maxaddr));
+		if (!file) {
+			return nullptr;
+		}
+		return new BlockCacheDriver(file.release(), m_cfg, m_counters);
+	}
+
+	BlockCacheDriverFactory::Stats BlockCacheDriverFactory::GetStats() const
+	{
+		Stats s;
+		s.hits = m_counters->hits;
+		s.misses = m_counters->misses;
+		s.read_ahead = m_counters->read_ahead;
+		s.read_ahead_hits = m_counters->read_ahead_hits;
+		s.bypassed = m_counters->bypassed;
+		s.file_reads = m_counters->file_reads;
+		s.file_bytes = m_counters->file_bytes;
+		return s;
+	}
+
+	void BlockCacheDriverFactory::ResetStats()
+	{
+		m_counters->hits = 0;
+		m_counters->misses = 0;
+		m_counters->read_ahead = 0;
+		m_counters->read_ahead_hits = 0;
+		m_counters->bypassed = 0;
+		m_counters->file_reads = 0;
+		m_counters->file_bytes = 0;
+	}
+
+}
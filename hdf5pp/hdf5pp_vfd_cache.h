@@ -0,0 +1,59 @@
+// hdf5pp_vfd_cache.h
+// HDF5::BlockCacheDriverFactory selects a driver layered over another one (Sec2DriverFactory by default) that
+// keeps a per file LRU cache of fixed size blocks: small, scattered reads (B-tree nodes, object headers) are
+// served from blocks read whole, and sequential streams are read ahead, on a background thread unless async
+// is off; writes go straight through to the underlying driver and update the cached blocks
+// the counters are shared by the factory and all its copies, so they cover every file opened through it
+//
+#pragma once
+
+#include "hdf5pp_vfd_sec2.h"
+
+#include <memory>
+
+namespace HDF5 {
+
+	class HDF5PP_API BlockCacheDriverFactory : public VirtualFileDriverFactory
+	{
+	public:
+		struct Config {
+			Config() : block_size(64 * 1024), cache_size(64 * 1024 * 1024), read_ahead(8), bypass_size(1024 * 1024), async(true) {}
+
+			size_t block_size;		// bytes per cache block, and the smallest read issued to the file
+			size_t cache_size;		// bytes of blocks kept per file
+			unsigned int read_ahead;	// blocks read ahead once reads are sequential; 0 disables read-ahead
+			size_t bypass_size;		// reads of at least this many bytes go straight to the file, uncached
+			bool async;				// read ahead on a background thread instead of extending the read that detected the stream
+		};
+
+		struct Stats {
+			uint64_t hits{ 0 };				// blocks found in the cache
+			uint64_t misses{ 0 };			// blocks read on demand
+			uint64_t read_ahead{ 0 };		// blocks read ahead of a sequential stream
+			uint64_t read_ahead_hits{ 0 };	// read-ahead blocks used before being evicted
+			uint64_t bypassed{ 0 };			// reads sent straight to the file
+			uint64_t file_reads{ 0 };		// reads issued to the underlying driver, and their bytes
+			uint64_t file_bytes{ 0 };
+		};
+
+		explicit BlockCacheDriverFactory(const Config& cfg = Config(), const VirtualFileDriverFactory& file = Sec2DriverFactory());
+		BlockCacheDriverFactory(const BlockCacheDriverFactory& rhs);
+		BlockCacheDriverFactory& operator=(const BlockCacheDriverFactory&) = delete;
+
+		const char* GetName() const override { return "hdf5pp_block_cache"; }
+		VirtualFileDriverFactory* Clone() const override { return new BlockCacheDriverFactory(*this); }
+		VirtualFileDriver* Open(const char* name, unsigned int flags, haddr_t maxaddr) const override;
+
+		// Retrieves / resets the counters of all files opened through this factory and its copies
+		Stats GetStats() const;
+		void ResetStats();
+
+		struct Counters;
+
+	protected:
+		Config m_cfg;
+		std::unique_ptr<VirtualFileDriverFactory> m_file;
+		std::shared_ptr<Counters> m_counters;
+	};
+
+}
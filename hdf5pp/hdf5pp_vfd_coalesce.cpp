@@ -0,0 +1,275 @@
+#include "pch.h"
+#include "hdf5pp_vfd_coalesce.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fcntl.h>
+#include <vector>
+
+namespace HDF5 {
+
+	struct CoalescingDriverFactory::Counters {
+		std::atomic<uint64_t> writes{ 0 };
+		std::atomic<uint64_t> write_bytes{ 0 };
+		std::atomic<uint64_t> extents{ 0 };
+		std::atomic<uint64_t> extent_bytes{ 0 };
+		std::atomic<uint64_t> read_backs{ 0 };
+	};
+
+	namespace {
+
+		// size bytes aligned to alignment, within storage
+		char* AlignedBuffer(std::vector<char>& storage, size_t size, size_t alignment)
+		{
+			if (storage.empty()) {
+				storage.resize(size + alignment);
+			}
+			return (char*)(((uintptr_t)storage.data() + alignment - 1) & ~(uintptr_t)(alignment - 1));
+		}
+
+		class CoalescingDriver : public Sec2Driver
+		{
+		public:
+			CoalescingDriver(const CoalescingDriverFactory::Config& cfg, const std::shared_ptr<CoalescingDriverFactory::Counters>& counters);
+
+			bool Open(const char* name, unsigned int flags);
+
+			bool Read(H5FD_mem_t type, haddr_t addr, size_t size, void* buf) override;
+			bool Write(H5FD_mem_t type, haddr_t addr, size_t size, const void* buf) override;
+			haddr_t GetEOF(H5FD_mem_t type) const override;
+			bool Truncate(bool closing) override;
+			bool Flush(bool closing) override;
+			bool Close() override;
+
+			// the descriptor does not see buffered data, so it is not offered as a POSIX handle
+			unsigned long GetFeatureFlags() const override { return VirtualFileDriver::GetFeatureFlags(); }
+
+		protected:
+			// writes the buffered extent to the file, aligned at both ends if direct
+			bool FlushBuffer();
+
+			// fills the bytes of the aligned block at block that are outside [lo, hi) from the file (direct)
+			bool ReadBack(haddr_t block, haddr_t lo, haddr_t hi);
+
+			// reads through the aligned read buffer (direct)
+			bool ReadDirect(haddr_t addr, size_t size, char* out);
+
+			CoalescingDriverFactory::Config m_cfg;
+			std::shared_ptr<CoalescingDriverFactory::Counters> m_counters;
+			haddr_t m_alignment;
+			size_t m_capacity;
+
+			std::vector<char> m_storage;		// the write buffer: m_buf[0] holds file offset m_window
+			char* m_buf;
+			std::vector<char> m_readStorage;	// aligned buffer of reads and read backs, allocated on first use
+			haddr_t m_window{ 0 };
+			haddr_t m_lo{ 0 };					// buffered extent [m_lo, m_hi), empty if equal
+			haddr_t m_hi{ 0 };
+			haddr_t m_size{ 0 };				// end of file, buffered data included; m_eof is the size of the file
+		};
+
+		CoalescingDriver::CoalescingDriver(const CoalescingDriverFactory::Config& cfg, const std::shared_ptr<CoalescingDriverFactory::Counters>& counters)
+			: m_cfg(cfg), m_counters(counters), m_alignment(cfg.alignment),
+			m_capacity((cfg.buffer_size + cfg.alignment - 1) / cfg.alignment * cfg.alignment)
+		{
+			m_buf = AlignedBuffer(m_storage, m_capacity, m_cfg.alignment);
+		}
+
+		bool CoalescingDriver::Open(const char* name, unsigned int flags)
+		{
+			int extra_flags{ 0 };
+			if (m_cfg.direct) {
+#ifdef O_DIRECT
+				extra_flags = O_DIRECT;
+#else
+				return false;
+#endif
+			}
+			if (!OpenFile(name, flags, extra_flags)) {
+				return false;
+			}
+			m_size = m_eof;
+			return true;
+		}
+
+		bool CoalescingDriver::Read(H5FD_mem_t type, haddr_t addr, size_t size, void* buf)
+		{
+			if (size == 0) {
+				return true;
+			}
+			if (m_lo < m_hi && addr < m_hi && addr + size > m_lo) {
+				if (addr >= m_lo && addr + size <= m_hi) {
+					memcpy(buf, m_buf + (addr - m_window), size);
+					return true;
+				}
+				if (!FlushBuffer()) {
+					return false;
+				}
+			}
+			return m_cfg.direct ? ReadDirect(addr, size, (char*)buf) : Sec2Driver::Read(type, addr, size, buf);
+		}
+
+		bool CoalescingDriver::ReadDirect(haddr_t addr, size_t size, char* out)
+		{
+			auto buf = AlignedBuffer(m_readStorage, m_capacity, m_cfg.alignment);
+			while (size > 0) {
+				auto lo = addr & ~(m_alignment - 1);
+				auto hi = std::min((addr + size + m_alignment - 1) & ~(m_alignment - 1), lo + m_capacity);
+				auto n = ReadAt(buf, (size_t)(hi - lo), lo);
+				if (n < 0) {
+					return false;
+				}
+				// past the end of file
+				memset(buf + n, 0, (size_t)(hi - lo - n));
+				auto len = (size_t)std::min((haddr_t)size, hi - addr);
+				memcpy(out, buf + (addr - lo), len);
+				out += len;
+				addr += len;
+				size -= len;
+			}
+			return true;
+		}
+
+		bool CoalescingDriver::Write(H5FD_mem_t /*type*/, haddr_t addr, size_t size, const void* buf)
+		{
+			++m_counters->writes;
+			m_counters->write_bytes += size;
+			auto p = (const char*)buf;
+			auto end = addr + size;
+			while (size > 0) {
+				// merges with the buffered extent if it touches it and starts within the buffer
+				if (m_lo < m_hi && (addr > m_hi || addr + size < m_lo || addr < m_window || addr >= m_window + m_capacity)) {
+					if (!FlushBuffer()) {
+						return false;
+					}
+				}
+				if (m_lo == m_hi) {
+					m_window = addr & ~(m_alignment - 1);
+					m_lo = m_hi = addr;
+				}
+				auto n = (size_t)std::min((haddr_t)size, m_window + m_capacity - addr);
+				memcpy(m_buf + (addr - m_window), p, n);
+				m_lo = std::min(m_lo, addr);
+				m_hi = std::max(m_hi, addr + n);
+				addr += n;
+				p += n;
+				size -= n;
+			}
+			m_size = std::max(m_size, end);
+			return true;
+		}
+
+		bool CoalescingDriver::FlushBuffer()
+		{
+			if (m_lo == m_hi) {
+				return true;
+			}
+			auto lo = m_lo;
+			auto hi = m_hi;
+			if (m_cfg.direct) {
+				auto head = lo & ~(m_alignment - 1);
+				auto tail = (hi + m_alignment - 1) & ~(m_alignment - 1);
+				if (head < lo && !ReadBack(head, lo, hi)) {
+					return false;
+				}
+				if (hi < tail && (tail - m_alignment != head || head == lo) && !ReadBack(tail - m_alignment, lo, hi)) {
+					return false;
+				}
+				lo = head;
+				hi = tail;
+			}
+			// the base class write extends m_eof, the size of the file, past m_size by the padding
+			if (!Sec2Driver::Write(H5FD_MEM_DEFAULT, lo, (size_t)(hi - lo), m_buf + (lo - m_window))) {
+				return false;
+			}
+			++m_counters->extents;
+			m_counters->extent_bytes += hi - lo;
+			m_lo = m_hi = m_window;
+			return true;
+		}
+
+		bool CoalescingDriver::ReadBack(haddr_t block, haddr_t lo, haddr_t hi)
+		{
+			auto buf = AlignedBuffer(m_readStorage, m_capacity, m_cfg.alignment);
+			int64_t n{ 0 };
+			if (block < m_eof) {
+				n = ReadAt(buf, (size_t)m_alignment, block);
+				if (n < 0) {
+					return false;
+				}
+			}
+			memset(buf + n, 0, (size_t)(m_alignment - n));
+			++m_counters->read_backs;
+
+			auto dst = m_buf + (block - m_window);
+			if (block < lo) {
+				memcpy(dst, buf, (size_t)(std::min(lo, block + m_alignment) - block));
+			}
+			if (hi < block + m_alignment) {
+				auto from = std::max(hi, block) - block;
+				memcpy(dst + from, buf + from, (size_t)(m_alignment - from));
+			}
+			return true;
+		}
+
+		haddr_t CoalescingDriver::GetEOF(H5FD_mem_t /*type*/) const
+		{
+			return m_size;
+		}
+
+		bool CoalescingDriver::Truncate(bool closing)
+		{
+			if (!FlushBuffer() || !Sec2Driver::Truncate(closing)) {
+				return false;
+			}
+			m_size = m_eof;
+			return true;
+		}
+
+		bool CoalescingDriver::Flush(bool /*closing*/)
+		{
+			return FlushBuffer();
+		}
+
+		bool CoalescingDriver::Close()
+		{
+			auto flushed = FlushBuffer();
+			return Sec2Driver::Close() && flushed;
+		}
+	}
+
+	CoalescingDriverFactory::CoalescingDriverFactory(const Config& cfg /*= Config()*/)
+		: m_cfg(cfg), m_counters(std::make_shared<Counters>())
+	{
+	}
+
+	VirtualFileDriver* CoalescingDriverFactory::Open(const char* name, unsigned int flags, haddr_t /*maxaddr*/) const
+	{
+		if (m_cfg.alignment == 0 || (m_cfg.alignment & (m_cfg.alignment - 1)) != 0 || m_cfg.buffer_size == 0) {
+			return nullptr;
+		}
+		std::unique_ptr<CoalescingDriver> driver(new CoalescingDriver(m_cfg, m_counters));
+		return driver->Open(name, flags) ? driver.release() : nullptr;
+	}
+
+	CoalescingDriverFactory::Stats CoalescingDriverFactory::GetStats() const
+	{
+		Stats s;
+		s.writes = m_counters->writes;
+		s.write_bytes = m_counters->write_bytes;
+		s.extents = m_counters->extents;
+		s.extent_bytes = m_counters->extent_bytes;
+		s.read_backs = m_counters->read_backs;
+		return s;
+	}
+
+	void CoalescingDriverFactory::ResetStats()
+	{
+		m_counters->writes = 0;
+		m_counters->write_bytes = 0;
+		m_counters->extents = 0;
+		m_counters->extent_bytes = 0;
+		m_counters->read_backs = 0;
+	}
+
+}
@@ -0,0 +1,54 @@
+// hdf5pp_vfd_coalesce.h
+// HDF5::CoalescingDriverFactory selects a driver that gathers writes in a buffer and writes them out as large
+// extents starting at multiples of the alignment: adjacent and overlapping writes merge until the buffer is
+// full or a write lands elsewhere; reads see the buffered data; the buffer is written out when the file is
+// flushed (Location::FlushFile) or closed
+// with direct set, the file is opened with O_DIRECT (Linux only) to bypass the OS page cache: every transfer
+// goes through aligned buffers, and the partial blocks at the ends of an extent are read back from the file
+// first; either way the file ends up the same, byte for byte, as one written by the default driver
+//
+#pragma once
+
+#include "hdf5pp_vfd_sec2.h"
+
+#include <memory>
+
+namespace HDF5 {
+
+	class HDF5PP_API CoalescingDriverFactory : public VirtualFileDriverFactory
+	{
+	public:
+		struct Config {
+			Config() : buffer_size(8 * 1024 * 1024), alignment(4096), direct(false) {}
+
+			size_t buffer_size;		// bytes merged before they are written, rounded up to a multiple of alignment
+			size_t alignment;		// a power of two; with direct, at least the logical block size of the device
+			bool direct;			// open with O_DIRECT; opening fails where it is not available
+		};
+
+		struct Stats {
+			uint64_t writes{ 0 };			// writes from the library, and their bytes
+			uint64_t write_bytes{ 0 };
+			uint64_t extents{ 0 };			// writes to the file, and their bytes, alignment padding included
+			uint64_t extent_bytes{ 0 };
+			uint64_t read_backs{ 0 };		// partial blocks read back to fill an aligned extent (direct only)
+		};
+
+		explicit CoalescingDriverFactory(const Config& cfg = Config());
+
+		const char* GetName() const override { return "hdf5pp_coalescing"; }
+		VirtualFileDriverFactory* Clone() const override { return new CoalescingDriverFactory(*this); }
+		VirtualFileDriver* Open(const char* name, unsigned int flags, haddr_t maxaddr) const override;
+
+		// Retrieves / resets the counters of all files opened through this factory and its copies
+		Stats GetStats() const;
+		void ResetStats();
+
+		struct Counters;
+
+	protected:
+		Config m_cfg;
+		std::shared_ptr<Counters> m_counters;
+	};
+
+}
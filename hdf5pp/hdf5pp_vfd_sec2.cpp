@@ -0,0 +1,229 @@
+#include "pch.h"
+#include "hdf5pp_vfd_sec2.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <memory>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#ifdef _WIN32
+#include <io.h>
+#include <share.h>
+#else
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+namespace HDF5 {
+
+	Sec2Driver* Sec2Driver::Open(const char* name, unsigned int flags)
+	{
+		std::unique_ptr<Sec2Driver> driver(new Sec2Driver());
+		return driver->OpenFile(name, flags) ? driver.release() : nullptr;
+	}
+
+	bool Sec2Driver::OpenFile(const char* name, unsigned int flags, int extra_flags /*= 0*/)
+	{
+		int oflags = ((flags & H5F_ACC_RDWR) ? O_RDWR : O_RDONLY) | extra_flags;
+		if (flags & H5F_ACC_TRUNC) {
+			oflags |= O_TRUNC;
+		}
+		if (flags & H5F_ACC_CREAT) {
+			oflags |= O_CREAT;
+		}
+		if (flags & H5F_ACC_EXCL) {
+			oflags |= O_EXCL;
+		}
+
+#ifdef _WIN32
+		if (_sopen_s(&m_fd, name, oflags | _O_BINARY, _SH_DENYNO, _S_IREAD | _S_IWRITE) != 0) {
+			m_fd = -1;
+			return false;
+		}
+		struct _stat64 st;
+		BY_HANDLE_FILE_INFORMATION info;
+		if (_fstat64(m_fd, &st) != 0 || !GetFileInformationByHandle((HANDLE)_get_osfhandle(m_fd), &info)) {
+			return false;
+		}
+		m_device = info.dwVolumeSerialNumber;
+		m_inode = ((uint64_t)info.nFileIndexHigh << 32) | info.nFileIndexLow;
+#else
+		m_fd = open(name, oflags, 0666);
+		if (m_fd < 0) {
+			return false;
+		}
+		struct stat st;
+		if (fstat(m_fd, &st) != 0) {
+			return false;
+		}
+		m_device = (uint64_t)st.st_dev;
+		m_inode = (uint64_t)st.st_ino;
+#endif
+		m_eof = (haddr_t)st.st_size;
+		return true;
+	}
+
+#ifdef _WIN32
+	// Windows has no positioned I/O on descriptors; the library calls a driver from one thread at a time
+	int64_t Sec2Driver::ReadAt(void* buf, size_t size, haddr_t addr)
+	{
+		if (_lseeki64(m_fd, (__int64)addr, SEEK_SET) < 0) {
+			return -1;
+		}
+		return _read(m_fd, buf, (unsigned int)std::min(size, (size_t)INT_MAX));
+	}
+
+	int64_t Sec2Driver::WriteAt(const void* buf, size_t size, haddr_t addr)
+	{
+		if (_lseeki64(m_fd, (__int64)addr, SEEK_SET) < 0) {
+			return -1;
+		}
+		return _write(m_fd, buf, (unsigned int)std::min(size, (size_t)INT_MAX));
+	}
+#else
+	int64_t Sec2Driver::ReadAt(void* buf, size_t size, haddr_t addr)
+	{
+		ssize_t n;
+		do {
+			n = pread(m_fd, buf, std::min(size, (size_t)INT_MAX), (off_t)addr);
+		} while (n < 0 && errno == EINTR);
+		return n;
+	}
+
+	int64_t Sec2Driver::WriteAt(const void* buf, size_t size, haddr_t addr)
+	{
+		ssize_t n;
+		do {
+			n = pwrite(m_fd, buf, std::min(size, (size_t)INT_MAX), (off_t)addr);
+		} while (n < 0 && errno == EINTR);
+		return n;
+	}
+#endif
+
+	Sec2Driver::~Sec2Driver()
+	{
+		Sec2Driver::Close();
+	}
+
+	bool Sec2Driver::Read(H5FD_mem_t /*type*/, haddr_t addr, size_t size, void* buf)
+	{
+		auto p = (char*)buf;
+		while (size > 0) {
+			auto n = ReadAt(p, size, addr);
+			if (n < 0) {
+				return false;
+			}
+			if (n == 0) {
+				// end of file
+				memset(p, 0, size);
+				break;
+			}
+			p += n;
+			addr += (haddr_t)n;
+			size -= (size_t)n;
+		}
+		return true;
+	}
+
+	bool Sec2Driver::Write(H5FD_mem_t /*type*/, haddr_t addr, size_t size, const void* buf)
+	{
+		auto p = (const char*)buf;
+		while (size > 0) {
+			auto n = WriteAt(p, size, addr);
+			if (n <= 0) {
+				return false;
+			}
+			p += n;
+			addr += (haddr_t)n;
+			size -= (size_t)n;
+		}
+		m_eof = std::max(m_eof, addr);
+		return true;
+	}
+
+	haddr_t Sec2Driver::GetEOF(H5FD_mem_t /*type*/) const
+	{
+		return m_eof;
+	}
+
+	bool Sec2Driver::Truncate(bool /*closing*/)
+	{
+		if (m_eoa == m_eof) {
+			return true;
+		}
+#ifdef _WIN32
+		if (_chsize_s(m_fd, (__int64)m_eoa) != 0) {
+#else
+		if (ftruncate(m_fd, (off_t)m_eoa) != 0) {
+#endif
+			return false;
+		}
+		m_eof = m_eoa;
+		return true;
+	}
+
+	bool Sec2Driver::Lock(bool rw)
+	{
+#ifdef _WIN32
+		OVERLAPPED ov = {};
+		return LockFileEx((HANDLE)_get_osfhandle(m_fd), (rw ? LOCKFILE_EXCLUSIVE_LOCK : 0) | LOCKFILE_FAIL_IMMEDIATELY, 0, MAXDWORD, MAXDWORD, &ov) != 0;
+#else
+		// file systems without locks do not prevent opening files, as with the default driver
+		return flock(m_fd, (rw ? LOCK_EX : LOCK_SH) | LOCK_NB) == 0 || errno == ENOSYS;
+#endif
+	}
+
+	bool Sec2Driver::Unlock()
+	{
+#ifdef _WIN32
+		OVERLAPPED ov = {};
+		return UnlockFileEx((HANDLE)_get_osfhandle(m_fd), 0, MAXDWORD, MAXDWORD, &ov) != 0;
+#else
+		return flock(m_fd, LOCK_UN) == 0 || errno == ENOSYS;
+#endif
+	}
+
+	bool Sec2Driver::Close()
+	{
+		if (m_fd < 0) {
+			return true;
+		}
+#ifdef _WIN32
+		auto rv = _close(m_fd) == 0;
+#else
+		auto rv = close(m_fd) == 0;
+#endif
+		m_fd = -1;
+		return rv;
+	}
+
+	int Sec2Driver::Compare(const VirtualFileDriver& rhs) const
+	{
+		auto& other = (const Sec2Driver&)rhs;
+		if (m_device != other.m_device) {
+			return m_device < other.m_device ? -1 : 1;
+		}
+		if (m_inode != other.m_inode) {
+			return m_inode < other.m_inode ? -1 : 1;
+		}
+		return 0;
+	}
+
+	unsigned long Sec2Driver::GetFeatureFlags() const
+	{
+		return VirtualFileDriver::GetFeatureFlags() | H5FD_FEAT_POSIX_COMPAT_HANDLE;
+	}
+
+	void* Sec2Driver::GetHandle()
+	{
+		return &m_fd;
+	}
+
+	VirtualFileDriver* Sec2DriverFactory::Open(const char* name, unsigned int flags, haddr_t /*maxaddr*/) const
+	{
+		return Sec2Driver::Open(name, flags);
+	}
+
+}
@@ -0,0 +1,60 @@
+// hdf5pp_vfd_sec2.h
+// HDF5::Sec2Driver is the reference VirtualFileDriver: unbuffered POSIX I/O on a file descriptor, like the
+// library's default sec2 driver, whose files it reads and writes; other drivers can start from it
+//
+#pragma once
+
+#include "hdf5pp_vfd.h"
+
+#include <cstdint>
+
+namespace HDF5 {
+
+	class HDF5PP_API Sec2Driver : public VirtualFileDriver
+	{
+	public:
+		// Opens name with the H5F_ACC_* flags; returns nullptr on failure
+		static Sec2Driver* Open(const char* name, unsigned int flags);
+		~Sec2Driver() override;
+
+		bool Read(H5FD_mem_t type, haddr_t addr, size_t size, void* buf) override;
+		bool Write(H5FD_mem_t type, haddr_t addr, size_t size, const void* buf) override;
+		haddr_t GetEOF(H5FD_mem_t type) const override;
+		bool Truncate(bool closing) override;
+		bool Lock(bool rw) override;
+		bool Unlock() override;
+		bool Close() override;
+
+		// files are the same if they have the same device and inode (volume and file index on Windows)
+		int Compare(const VirtualFileDriver& rhs) const override;
+
+		unsigned long GetFeatureFlags() const override;
+
+		// returns a pointer to the file descriptor (int)
+		void* GetHandle() override;
+
+	protected:
+		Sec2Driver() = default;
+
+		// opens the descriptor and reads the size and identity of the file; extra_flags are added to the open flags
+		bool OpenFile(const char* name, unsigned int flags, int extra_flags = 0);
+
+		// one positioned read / write of up to size bytes; returns the bytes transferred, -1 on failure
+		int64_t ReadAt(void* buf, size_t size, haddr_t addr);
+		int64_t WriteAt(const void* buf, size_t size, haddr_t addr);
+
+		int m_fd{ -1 };
+		haddr_t m_eof{ 0 };
+		uint64_t m_device{ 0 };
+		uint64_t m_inode{ 0 };
+	};
+
+	class HDF5PP_API Sec2DriverFactory : public VirtualFileDriverFactory
+	{
+	public:
+		const char* GetName() const override { return "hdf5pp_sec2"; }
+		VirtualFileDriverFactory* Clone() const override { return new Sec2DriverFactory(*this); }
+		VirtualFileDriver* Open(const char* name, unsigned int flags, haddr_t maxaddr) const override;
+	};
+
+}
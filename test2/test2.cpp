@@ -14,6 +14,14 @@ int main()
 
 
 	auto grp = f.CreateGroup("group1");
+
+	// group meant to hold many links: go dense early and index creation order
+	HDF5::GroupCreationPropertyList gcpl;
+	gcpl.SetLinkPhaseChange(4, 2);
+	gcpl.SetEstimatedLinkInfo(1000, 16);
+	gcpl.SetLinkCreationOrder(HDF5::ObjectCreationPropertyList::CreationOrder::Indexed);
+	gcpl.SetAttributeCreationOrder(HDF5::ObjectCreationPropertyList::CreationOrder::Tracked);
+	auto index_grp = f.CreateGroup("index", HDF5::PropertyList(), gcpl);
 	auto aa = f.CreateAttribute("attr1", HDF5::IntegerPDT::Native_LONG, HDF5::Dataspace());
 	long v{ -123 };
 	aa.Write(HDF5::IntegerPDT::Native_LONG, &v);
@@ -33,6 +41,11 @@ int main()
 	std::vector<double> foo = { 1.2, 2.3, 3.4, 4.5 };
 	grp.SetAttribute("test_double", foo);
 
+	// same type and shape; data is overwritten in place
+	foo[0] = 9.8;
+	grp.SetAttribute("test_double", foo);
+	grp.SetAttribute("test_double", foo);
+
 	// test string attribute
 	grp.AddAttributeFormat("test_str_with_format", "this is a test string with %d", v2);
 
@@ -75,6 +88,247 @@ int main()
 	grp.AddDataset("ddset_2d", vvv.data(), 3, 4 * 5);
 	grp.AddDataset("ddset_3d", vvv.data(), 3, 4, 5);
 
+	// namespace catalog: one recursive visit, stored in the file and next to it
+	HDF5::Catalog cat;
+	cat.Build(f, { "test_double", "test_str_with_format" });
+	cat.Save(f);
+	cat.Save("test2.h5cat");
+
+	HDF5::Catalog cat2;
+	cat2.Load(f);
+	HDF5::Catalog::Item item;
+	cat2.Find("/group1/dset_3d", item);
+	std::vector<std::string> names;
+	cat2.List("/group1", names);
+
+	// paged file with a page buffer; statistics are appended to test2_pb.json on close
+	HDF5::File::PagingConfig paging;
+	paging.min_meta_perc = 25;
+	paging.stats_filename = "test2_pb.json";
+	HDF5::Trace::Start();
+	HDF5::File pf;
+	pf.CreatePaged("test2_paged.h5", H5F_ACC_TRUNC, paging);
+	pf.AddDataset("dset_1d", vvv);
+	pf.Close();
+	pf.OpenPaged("test2_paged.h5", H5F_ACC_RDONLY, paging);
+	HDF5::FileMetrics pfm(pf);
+	auto pdset = pf.OpenDataset("dset_1d");
+	auto pdspace = pdset.GetDataspace();
+	std::vector<unsigned long> vvv2(vvv.size());
+	pdset.Read(HDF5::DatatypeOf(vvv2[0]), pdspace, pdspace, vvv2.data());
+	HDF5::FileMetrics::Sample sample;
+	pfm.SampleNow(sample);
+	pfm.ExportJSON("test2_filemetrics.json");
+
+	// timeline of the paged file section; empty unless the library is built with HDF5PP_WITH_TRACE
+	HDF5::Trace::Stop();
+	HDF5::Trace::Dump("test2_trace.json");
+
+	// per-API statistics; empty unless the library is built with HDF5PP_WITH_METRICS
+	HDF5::Metrics::ExportJSON("test2_metrics.json");
+	HDF5::Metrics::ExportPrometheus("test2_metrics.prom");
+
+	// the paged file as an in-memory image: read in place, then modified in a private copy
+	std::vector<char> image((size_t)pf.GetFileImageSize());
+	pf.GetFileImage(image.data(), image.size());
+	HDF5::File mf;
+	mf.OpenImage(image.data(), image.size(), H5F_ACC_RDONLY);
+	auto mdset = mf.OpenDataset("dset_1d");
+	auto mdspace = mdset.GetDataspace();
+	mdset.Read(HDF5::DatatypeOf(vvv2[0]), mdspace, mdspace, vvv2.data());
+	mf.OpenImage(image.data(), image.size(), H5F_ACC_RDWR);
+	mf.AddAttribute("copy", 1);
+	mf.Close();
+
+	// intermediate product built in memory, written to disk in the background
+	HDF5::File sf;
+	sf.CreateScratch("test2_scratch", 4 << 20);
+	sf.AddDataset("dset_1d", vvv);
+	auto persisted = sf.PersistAsync("test2_scratch.h5");
+	sf.AddAttribute("after_persist", 1);
+	sf.Close();
+	persisted.get();
+
+	// a scratch file with a user block, and a version 2 superblock whose checksum Persist recomputes
+	HDF5::FileCreationPropertyList ub_fcpl;
+	ub_fcpl.SetUserblock(512);
+	ub_fcpl.SetFileSpaceStrategy(HDF5::FileCreationPropertyList::FileSpaceStrategy::FreeSpaceManagerAggregator, true, 1);
+	HDF5::File ubf;
+	ubf.CreateScratch("test2_userblock", 1 << 20, ub_fcpl);
+	ubf.AddDataset("dset_1d", vvv);
+	ubf.Persist("test2_userblock.h5");
+	ubf.Close();
+	ubf.Open("test2_userblock.h5", H5F_ACC_RDONLY);
+	auto ubdset = ubf.OpenDataset("dset_1d");
+	auto ubdspace = ubdset.GetDataspace();
+	ubdset.Read(HDF5::DatatypeOf(vvv2[0]), ubdspace, ubdspace, vvv2.data());
+	ubf.Close();
+
+	// the same file through the C++ reference driver
+	HDF5::FileAccessPropertyList vfd_fapl;
+	vfd_fapl.SetDriver(HDF5::Sec2DriverFactory());
+	HDF5::File vf;
+	vf.Open("test2_scratch.h5", H5F_ACC_RDONLY, vfd_fapl);
+	auto vdset = vf.OpenDataset("dset_1d");
+	auto vdspace = vdset.GetDataspace();
+	vdset.Read(HDF5::DatatypeOf(vvv2[0]), vdspace, vdspace, vvv2.data());
+	vf.Close();
+
+	// and through the block cache, which counts how the reads were served
+	HDF5::BlockCacheDriverFactory block_cache;
+	vfd_fapl.SetDriver(block_cache);
+	vf.Open("test2_scratch.h5", H5F_ACC_RDONLY, vfd_fapl);
+	vdset = vf.OpenDataset("dset_1d");
+	vdset.Read(HDF5::DatatypeOf(vvv2[0]), vdspace, vdspace, vvv2.data());
+	vf.Close();
+	auto cache_stats = block_cache.GetStats();
+
+	// rewrite the dataset through the coalescing driver, which merges the writes until the file is flushed
+	HDF5::CoalescingDriverFactory coalescing;
+	vfd_fapl.SetDriver(coalescing);
+	vf.Open("test2_scratch.h5", H5F_ACC_RDWR, vfd_fapl);
+	vdset = vf.OpenDataset("dset_1d");
+	vdset.Write(HDF5::DatatypeOf(vvv2[0]), vdspace, vdspace, vvv2.data());
+	vf.FlushFile(HDF5::Location::FlushScope::Local);
+	vf.Close();
+	auto coalescing_stats = coalescing.GetStats();
+
+	// virtual dataset: dset_2d and ddset_2d stacked into one array, without copying data
+	HDF5::DatasetCreationPropertyList vdcpl;
+	vdcpl.AddVirtualMapping({ 2 * 3, 4 * 5 }, { 0, 0 }, ".", "/group1/dset_2d", { 3, 4 * 5 });
+	vdcpl.AddVirtualMapping({ 2 * 3, 4 * 5 }, { 3, 0 }, ".", "/group1/ddset_2d", { 3, 4 * 5 });
+	auto vds = f.CreateDataset("vds", HDF5::DatatypeOf(vvv[0]), HDF5::Dataspace({ 2 * 3, 4 * 5 }), HDF5::PropertyList(), vdcpl);
+	size_t mapping_count{ 0 };
+	vdcpl.GetVirtualCount(mapping_count);
+	std::string src_file, src_dset;
+	HDF5::Dataspace mapped_vspace, mapped_src_space;
+	vdcpl.GetVirtualMapping(1, src_file, src_dset, mapped_vspace, mapped_src_space);
+
+	// one day per source file, as many as exist: day_0.h5, day_1.h5, ...
+	HDF5::DatasetCreationPropertyList series_dcpl;
+	series_dcpl.AddVirtualSeries(HDF5::Dataspace({ 0, 24 }, { H5S_UNLIMITED, 24 }), "day_%b.h5", "samples", { 24 });
+	HDF5::DatasetAccessPropertyList series_dapl;
+	series_dapl.SetVirtualView(HDF5::DatasetAccessPropertyList::VirtualView::LastAvailable);
+	series_dapl.SetVirtualPrintfGap(2);
+	f.CreateDataset("days", HDF5::FloatPDT::Native_DOUBLE, HDF5::Dataspace({ 0, 24 }, { H5S_UNLIMITED, 24 }), HDF5::PropertyList(), series_dcpl, series_dapl);
+
+	// rows of 4 * 5 written by two worker processes in blocks of 2 rows; test2_sharded.h5 shows them as one dataset
+	HDF5::ShardedWriter::Config shard_cfg;
+	shard_cfg.workers = 2;
+	shard_cfg.block_size = 2 * 4 * 5 * sizeof(vvv[0]);
+	HDF5::ShardedWriter sharded;
+	sharded.Start("test2_sharded.h5", "rows", HDF5::DatatypeOf(vvv[0]), { 4 * 5 }, HDF5::PropertyList(), shard_cfg);
+	for (int i = 0; i < 3; ++i) {
+		sharded.Append(vvv.data(), 3);
+	}
+	sharded.Finish();
+
+	// rows appended under SWMR reach the callback of a tail reader; here writer and reader share the process
+	HDF5::FileAccessPropertyList swmr_fapl;
+	swmr_fapl.SetLibraryVersionBounds(H5F_LIBVER_LATEST, H5F_LIBVER_LATEST);
+	HDF5::File wf;
+	wf.Create("test2_swmr.h5", H5F_ACC_TRUNC, HDF5::PropertyList(), swmr_fapl);
+	HDF5::DatasetCreationPropertyList swmr_dcpl;
+	swmr_dcpl.SetChunk({ 16 });
+	auto series = wf.CreateDataset("series", HDF5::DatatypeOf(vvv[0]), HDF5::Dataspace({ 0 }, { H5S_UNLIMITED }), HDF5::PropertyList(), swmr_dcpl);
+	wf.StartSWMRWrite();
+	HDF5::TailReader tail(wf);
+	size_t tailed{ 0 };
+	tail.Watch("series", HDF5::DatatypeOf(vvv[0]), [](const char*, hsize_t, hsize_t rows, const void*, void* data) { *(size_t*)data += (size_t)rows; }, &tailed);
+	series.SetExtent({ vvv.size() });
+	series.Write(HDF5::DatatypeOf(vvv[0]), HDF5::Dataspace(std::vector<hsize_t>{ vvv.size() }), series.GetDataspace(), vvv.data());
+	series.Flush();
+	tail.Poll();
+	wf.Close();
+
+	// rows appended from memory buffers, written to the dataset on a background thread
+	HDF5::DatasetCreationPropertyList rows_dcpl;
+	rows_dcpl.SetChunk({ 16, 4 * 5 });
+	auto acquired = f.CreateDataset("acquired", HDF5::DatatypeOf(vvv[0]), HDF5::Dataspace({ 0, 4 * 5 }, { H5S_UNLIMITED, 4 * 5 }), HDF5::PropertyList(), rows_dcpl);
+	HDF5::BufferedAppender::Config appender_cfg;
+	appender_cfg.buffer_rows = 16;
+	HDF5::BufferedAppender appender(acquired, HDF5::DatatypeOf(vvv[0]), appender_cfg);
+	appender.Start();
+	for (int i = 0; i < 20; ++i) {
+		appender.Append(vvv.data(), 3);
+	}
+	appender.Stop();
+	auto appender_stats = appender.GetStats();
+
+	// AddDataset picks the layout from the size: compact, contiguous or, here, chunked and compressed
+	HDF5::LayoutPolicy::Thresholds layout;
+	layout.chunked_min_bytes = 1024;
+	layout.chunk_bytes = 512;
+	layout.deflate_level = 6;
+	layout.shuffle = true;
+	f.SetLayoutPolicy(std::make_shared<HDF5::LayoutPolicy>(layout));
+	std::vector<double> samples(1000, 0.5);
+	f.AddDataset("samples", samples);
+	f.SetLayoutPolicy(nullptr);
+
+	// chunks planned for reads of whole rows, three times as frequent as reads of whole columns
+	HDF5::ChunkPlanner planner({ 1000, 200 }, sizeof(double), 64 * 1024);
+	planner.AddRowScan(3);
+	planner.AddColumnScan(1);
+	planner.Print(planner.Plan());
+	HDF5::DatasetCreationPropertyList planned_dcpl;
+	planned_dcpl.SetChunk(planner);
+	f.CreateDataset("planned", HDF5::FloatPDT::Native_DOUBLE, HDF5::Dataspace({ 1000, 200 }), HDF5::PropertyList(), planned_dcpl);
+
+	// chunks compressed by a filter written in C++, here Zstandard when the library is built with it
+	if (HDF5::ZstdFilter::IsAvailable() && HDF5::Library::RegisterFilter(std::make_shared<HDF5::ZstdFilter>())) {
+		HDF5::DatasetCreationPropertyList zstd_dcpl;
+		zstd_dcpl.SetChunk({ 250 });
+		zstd_dcpl.SetZstd(3);
+		auto packed = f.CreateDataset("packed", HDF5::FloatPDT::Native_DOUBLE, HDF5::Dataspace(std::vector<hsize_t>{ samples.size() }), HDF5::PropertyList(), zstd_dcpl);
+		packed.Write(HDF5::FloatPDT::Native_DOUBLE, packed.GetDataspace(), packed.GetDataspace(), samples.data());
+	}
+
+	// bits transposed in front of deflate
+	if (HDF5::Library::RegisterFilter(std::make_shared<HDF5::ShuffleFilter>(HDF5::ShuffleFilter::Mode::Bit))) {
+		HDF5::DatasetCreationPropertyList bits_dcpl;
+		bits_dcpl.SetChunk({ 256 });
+		bits_dcpl.SetBitShuffle();
+		bits_dcpl.SetDeflate(1);
+		auto bits = f.CreateDataset("bitshuffled", HDF5::FloatPDT::Native_DOUBLE, HDF5::Dataspace(std::vector<hsize_t>{ samples.size() }), HDF5::PropertyList(), bits_dcpl);
+		bits.Write(HDF5::FloatPDT::Native_DOUBLE, bits.GetDataspace(), bits.GetDataspace(), samples.data());
+	}
+
+	// 4 significant digits kept, lossy, in front of shuffle and deflate; the bound is read back from the dataset
+	if (HDF5::Library::RegisterFilter(std::make_shared<HDF5::QuantizeFilter>())) {
+		HDF5::DatasetCreationPropertyList rounded_dcpl;
+		rounded_dcpl.SetChunk({ 256 });
+		rounded_dcpl.SetBitRound(HDF5::QuantizeFilter::GetSignificantBits(4));
+		rounded_dcpl.SetShuffle();
+		rounded_dcpl.SetDeflate(1);
+		auto rounded = f.CreateDataset("rounded", HDF5::FloatPDT::Native_DOUBLE, HDF5::Dataspace(std::vector<hsize_t>{ samples.size() }), HDF5::PropertyList(), rounded_dcpl);
+		rounded.Write(HDF5::FloatPDT::Native_DOUBLE, rounded.GetDataspace(), rounded.GetDataspace(), samples.data());
+		HDF5::QuantizeFilter::Method method;
+		double nsb;
+		if (HDF5::QuantizeFilter::GetBound((hid_t)rounded.GetCreationPropertyList(), method, nsb)) {
+			std::cout << "rounded: relative error at most " << HDF5::QuantizeFilter::GetMaxError(method, nsb) << std::endl;
+		}
+	}
+
+	// timestamps appended through the delta-of-delta filter, packed by frame of reference, then deflated
+	if (HDF5::Library::RegisterFilter(std::make_shared<HDF5::DeltaFilter>())) {
+		HDF5::DatasetCreationPropertyList ts_dcpl;
+		ts_dcpl.SetChunk({ 1024 });
+		ts_dcpl.SetDeltaOfDelta();
+		ts_dcpl.SetDeflate(1);
+		auto timestamps = f.CreateDataset("timestamps", HDF5::IntegerPDT::Native_INT64, HDF5::Dataspace({ 0 }, { H5S_UNLIMITED }), HDF5::PropertyList(), ts_dcpl);
+		HDF5::BufferedAppender::Config ts_cfg;
+		ts_cfg.buffer_rows = 4096;
+		ts_cfg.chunk_aligned = true;
+		HDF5::BufferedAppender ts_appender(timestamps, HDF5::IntegerPDT::Native_INT64, ts_cfg);
+		ts_appender.Start();
+		for (int64_t t = 0; t < 10000; ++t) {
+			int64_t us = 1700000000000000 + 1000 * t;
+			ts_appender.Append(&us, 1);
+		}
+		ts_appender.Stop();
+	}
+
 }
 
 // Run program: Ctrl + F5 or Debug > Start Without Debugging menu